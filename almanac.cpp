@@ -0,0 +1,476 @@
+#include "almanac.hpp"
+#include "format.hpp"
+#include "input.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>   // for EXIT_XXXX
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sun_moon {
+
+// 定数
+static constexpr unsigned int kSecDay  = 86400;                // Seconds in a day (secs)
+static constexpr double       kPi      = atan(1.0) * 4.0;      // 円周率
+static constexpr double       kPi180   = kPi / 180.0;          // 円周率 / 180
+static constexpr double       kRotSid  = 360.9856 / 86400.0;   // 天球の回転速度(度/秒)
+static constexpr double       kVelSun  = 2.0e-5;   // 太陽の天球上の速さの上限(度/秒, 実際は 1.1e-5)
+static constexpr double       kVelMoon = 2.2e-4;   // 月の天球上の速さの上限(度/秒, 実際は 1.8e-4)
+static constexpr double       kVelPh   = 1.6e-4;   // 位相角の変化の上限(度/秒)
+static constexpr double       kVelLimb = 1.0e-3;   // 明縁の位置角の変化の上限(度/秒, 新月・満月付近を除く)
+static constexpr double       kMinDen  = 0.05;     // 出入: cos(緯度)|sin(方位角)| の下限（未満は常に再計算）
+static constexpr double       kSafe    = 2.0;      // 安全係数
+static constexpr double       kHtRad   = 1.396;    // ラドーの式で視高度が最小となる高度(度, これ未満は減少)
+static constexpr double       kDecSun  = 23.5;     // 太陽の赤緯の上限(度)
+static constexpr double       kDecMoon = 29.0;     // 月の赤緯の上限(度)
+
+/*
+ * @brief       読込: 地点一覧
+ *              (1 行 1 地点 "ID,LATITUDE,LONGITUDE,HEIGHT"（区切りはカンマ・空白・タブ）,
+ *               空行・'#' で始まる行は無視。ID は 23 文字以内で重複不可)
+ *
+ * @param[in]   ファイル名 (string)
+ * @param[ref]  地点一覧 (vector<AlmSite>)
+ * @return      成否 (bool)
+ */
+bool load_sites(const std::string& f, std::vector<AlmSite>& sites) {
+  std::string ln;
+  unsigned int n_ln = 0;
+  const char* p;
+  const char* q;
+  const char* e;
+  double v[3];
+  unsigned int i;
+  AlmSite st;
+
+  try {
+    std::ifstream ifs(f);
+    if (!ifs) return false;
+    while (std::getline(ifs, ln)) {
+      ++n_ln;
+      if (ln.empty() || ln[0] == '#' || ln == "\r") continue;
+      p = ln.data();
+      e = p + ln.size();
+      while (p < e && (*p == ' ' || *p == '\t')) ++p;
+      for (q = p; q < e && *q != ',' && *q != ' ' && *q != '\t'; ++q) {}
+      bool ok = q > p && std::size_t(q - p) < kAlmIdLen;
+      if (ok) {
+        std::memset(st.id, 0, kAlmIdLen);
+        std::memcpy(st.id, p, q - p);
+        p = q;
+      }
+      for (i = 0; ok && i < 3; ++i) {
+        while (p < e && (*p == ',' || *p == ' ' || *p == '\t')) ++p;
+        ok = parse_num(p, e, v[i]);
+      }
+      while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+      if (!ok || p != e || std::abs(v[0]) > 90.0 || std::abs(v[1]) > 360.0 || v[2] < 0.0) {
+        std::cerr << "[ERROR] " << f << " line " << n_ln
+                  << ": malformed site" << std::endl;
+        return false;
+      }
+      st.lat = v[0];
+      st.lng = v[1];
+      st.ht  = v[2];
+      sites.push_back(st);
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return !sites.empty() && sites.size() < UINT32_MAX;
+}
+
+/*
+ * @brief      計算: 索引のバケット数（地点数の 2 倍以上の 2 の冪）
+ *
+ * @param[in]  地点数 (uint32_t)
+ * @return     バケット数 (uint32_t)
+ */
+std::uint32_t alm_bkt_size(std::uint32_t n_site) {
+  std::uint32_t n = 16;
+
+  while (n < std::uint64_t(n_site) * 2) n <<= 1;
+
+  return n;
+}
+
+/*
+ * @brief      計算: 地点 ID のハッシュ値（FNV-1a）
+ *
+ * @param[in]  地点 ID（NUL 終端） (const char*)
+ * @return     ハッシュ値 (uint64_t)
+ */
+std::uint64_t alm_hash(const char* id) {
+  std::uint64_t h = 14695981039346656037ULL;
+
+  for (; *id != '\0'; ++id) {
+    h ^= static_cast<unsigned char>(*id);
+    h *= 1099511628211ULL;
+  }
+
+  return h;
+}
+
+/*
+ * @brief       変換: 計算結果 -> レコード
+ *              (正常以外のイベントは時刻の代わりに状態（kAlmNone, kAlmNoConv）を保持)
+ *
+ * @param[in]   計算結果 (Result)
+ * @param[in]   計算状態 (ResSt, 件は正常であること)
+ * @param[in]   当日 00:00:00 (time_t)
+ * @param[ref]  レコード (AlmRec)
+ * @return      none
+ */
+void to_rec(const Result& res, const ResSt& rs, time_t jst, AlmRec& rec) {
+  auto cnv = [jst](const TmAh& ev, CalcSt st, AlmEv& a) {
+    bool ok = st == kStOk;
+    a.sec  = ok ? std::int32_t(ev.time.tv_sec - jst) : st == kStNoConv ? kAlmNoConv : kAlmNone;
+    a.nsec = ok ? std::int32_t(ev.time.tv_nsec) : 0;
+    a.ah   = ev.ah;
+  };
+
+  for (unsigned int i = 0; i < 3; ++i) {
+    cnv(res.sun[i], rs.ev[i], rec.sun[i]);
+    cnv(res.moon[i], rs.ev[3 + i], rec.moon[i]);
+  }
+  rec.phase = res.phase;
+}
+
+/*
+ * @brief       変換: レコード -> 計算結果（EOP 一覧の版数を除く）
+ *              (ResSt の f_eop は保持しないため false)
+ *
+ * @param[in]   レコード (AlmRec)
+ * @param[in]   当日の JST 00:00:00 (time_t)
+ * @param[ref]  計算結果 (Result)
+ * @param[ref]  計算状態 (ResSt)
+ * @return      none
+ */
+void from_rec(const AlmRec& rec, time_t jst, Result& res, ResSt& rs) {
+  auto cnv = [jst](const AlmEv& a, TmAh& ev, CalcSt& st) {
+    bool ok = a.sec != kAlmNone && a.sec != kAlmNoConv;
+    st = ok ? kStOk : a.sec == kAlmNoConv ? kStNoConv : kStNoEvent;
+    ev.time.tv_sec  = ok ? jst + a.sec : 0;
+    ev.time.tv_nsec = a.nsec;
+    ev.ah = a.ah;
+  };
+
+  rs.st    = kStOk;
+  rs.f_eop = false;
+  for (unsigned int i = 0; i < 3; ++i) {
+    cnv(rec.sun[i], res.sun[i], rs.ev[i]);
+    cnv(rec.moon[i], res.moon[i], rs.ev[3 + i]);
+  }
+  res.phase = rec.phase;
+}
+
+/*
+ * @brief      計算: 高度 -> 視高度（Calc と同じラドーの式）
+ *
+ * @param[in]  高度(度) (double)
+ * @return     視高度(度) (double)
+ */
+static double radau(double ht) {
+  double tan_ht = std::tan(kPi180 * (90.0 - ht));
+
+  return ht + (58.76 - (0.406 - 0.0192 * tan_ht) * tan_ht) * tan_ht / 3600.0;
+}
+
+/*
+ * @brief      計算: 南中高度（視高度）の高度に対する変化率の上限
+ *             (ラドーの式は高度 kHtRad 度未満で急減し、視高度 ht_a は 0 〜 kHtRad 度の
+ *              高度からも生じ得る。緯度から南中高度が kHtRad 度未満となり得る場合は、
+ *              その高度での変化率（二分法で逆算）を返す。視高度が負・90 度超は
+ *              式の適用範囲外のため無限大)
+ *
+ * @param[in]  南中高度（視高度, 度） (double)
+ * @param[in]  緯度(度) (double)
+ * @param[in]  天体の赤緯の上限(度) (double)
+ * @return     変化率の上限 (double)
+ */
+static double radau_slope(double ht_a, double lat, double dec) {
+  double h_0 = 0.0;
+  double h_1 = kHtRad;
+  double h;
+
+  if (!(ht_a >= 0.0 && ht_a <= 90.0)) return HUGE_VAL;
+  if (std::abs(lat) < 90.0 - kHtRad - dec || ht_a < radau(kHtRad)) return 1.0;
+  while (h_1 - h_0 > 1.0e-9) {
+    h = 0.5 * (h_0 + h_1);
+    if (radau(h) > ht_a) h_0 = h; else h_1 = h;
+  }
+  h = 0.5 * (h_0 + h_1);
+  return std::max(1.0, (radau(h - 1.0e-7) - radau(h + 1.0e-7)) / 2.0e-7);
+}
+
+/*
+ * @brief      判定: 出力の丸め位置に近いか
+ *             (値の絶対値を scale 倍した小数部が 0.5 から m × scale 以内、
+ *              または符号が変わり得る場合に true)
+ *
+ * @param[in]  値 (double)
+ * @param[in]  丸めの倍率（小数 2 桁なら 100） (double)
+ * @param[in]  値の変化の上限 (double)
+ * @return     丸め位置に近い (bool)
+ */
+static bool near_round(double x, double scale, double m) {
+  double y = std::abs(x) * scale;
+
+  return std::abs(y - std::floor(y) - 0.5) < m * scale || std::abs(x) < m;
+}
+
+/*
+ * @brief      判定: 時刻の出力（秒未満切り捨て）・日付が変わり得るか
+ *
+ * @param[in]  イベント (AlmEv)
+ * @param[in]  時刻の変化の上限(秒) (double)
+ * @return     変わり得る (bool)
+ */
+static bool near_sec(const AlmEv& a, double m) {
+  double f = a.nsec * 1.0e-9;  // 秒未満
+  double t = a.sec + f;        // 当日 00:00:00 からの秒数
+
+  return f < m || 1.0 - f < m || t < m || t > kSecDay - m;
+}
+
+/*
+ * @brief      判定: ΔT の変化で出力（丸めた値）が変わり得るレコード
+ *             (ΔT が e 秒変わると天体の位置は「天体の速さ × e」だけずれ、出入の時刻は
+ *              その角度を高度の変化率（天球の回転速度 × cos(緯度)|sin(方位角)|）で割った分、
+ *              南中の時刻は天球の回転速度で割った分だけずれる。各値の変化の上限に
+ *              安全係数を掛け、丸め位置（秒・小数桁）に近い値があれば true。
+ *              南中高度は大気差の式の変化率を掛ける（radau_slope）。
+ *              地平線をかすめる出入・新月／満月付近の位相・イベントの有無が変わり得る
+ *              場合（前後の日のイベントが日付の境界付近）は常に true)
+ *
+ * @param[in]  地点 (AlmSite)
+ * @param[in]  レコード (AlmRec)
+ * @param[in]  前日のレコード (AlmRec*, 範囲外は nullptr)
+ * @param[in]  翌日のレコード (AlmRec*, 範囲外は nullptr)
+ * @param[in]  ΔT の変化(秒, 絶対値) (double)
+ * @return     再計算が必要 (bool)
+ */
+bool rec_stale(const AlmSite& st, const AlmRec& rec, const AlmRec* prv, const AlmRec* nxt,
+               double e) {
+  double cos_lat = std::cos(kPi180 * st.lat);
+  double sin_lat = std::abs(std::sin(kPi180 * st.lat));
+  double m_max;    // 時刻の変化の上限の最大値（地平線をかすめる出入を除く）
+  double m_t;      // 時刻の変化の上限(秒)
+  double m_a;      // 角度の変化の上限(度)
+  double m_mt = e; // 月南中（位相の計算時刻）の変化の上限(秒)
+  unsigned int b;
+  unsigned int k;
+
+  for (b = 0; b < 2; ++b) {
+    double v = b == 0 ? kVelSun : kVelMoon;
+    const AlmEv* ev = b == 0 ? rec.sun : rec.moon;
+    m_max = kSafe * v * e / (kRotSid * kMinDen);
+    for (k = 0; k < 3; ++k) {
+      const AlmEv& a = ev[k];
+      if (a.sec == kAlmNoConv) return true;
+      if (a.sec == kAlmNone) {
+        // 前日の遅い時刻・翌日の早い時刻のイベントが日付をまたぎ得るか
+        const AlmEv* p = prv == nullptr ? nullptr : (b == 0 ? prv->sun : prv->moon) + k;
+        const AlmEv* n = nxt == nullptr ? nullptr : (b == 0 ? nxt->sun : nxt->moon) + k;
+        if (p == nullptr || n == nullptr
+            || (p->sec != kAlmNone && p->sec + p->nsec * 1.0e-9 > kSecDay - m_max)
+            || (n->sec != kAlmNone && n->sec + n->nsec * 1.0e-9 < m_max)) return true;
+        continue;
+      }
+      if (!std::isfinite(a.ah)) return true;
+      if (k < 2) {
+        double den = cos_lat * std::abs(std::sin(kPi180 * a.ah));
+        if (den < kMinDen) return true;
+        m_t = kSafe * v * e / (kRotSid * den);
+        m_a = kSafe * (v * e + kRotSid * (sin_lat + kMinDen) * m_t);
+      } else {
+        m_t = kSafe * 1.1 * v * e / kRotSid;
+        m_a = kSafe * v * e * radau_slope(a.ah, st.lat, b == 0 ? kDecSun : kDecMoon);
+        if (b == 1) m_mt += m_t;
+      }
+      if (near_sec(a, m_t) || near_round(a.ah, 100.0, m_a)) return true;
+    }
+  }
+  // 位相（月南中の時刻で計算）
+  if (rec.phase.illum < 0.02 || rec.phase.illum > 0.98) return true;
+  return near_round(rec.phase.ph_ang, 100.0, kSafe * kVelPh * m_mt)
+      || near_round(rec.phase.illum, 1000.0, kSafe * kVelPh * kPi180 * m_mt)
+      || near_round(rec.phase.age, 10.0, kSafe * m_mt / kSecDay)
+      || near_round(rec.phase.limb, 100.0, kSafe * kVelLimb * m_mt)
+      || rec.phase.limb < kSafe * kVelLimb * m_mt
+      || rec.phase.limb > 360.0 - kSafe * kVelLimb * m_mt;
+}
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+Almanac::Almanac() : fd(-1), p_map(nullptr), s_map(0), days(nullptr), sites(nullptr),
+                     bkts(nullptr), recs(nullptr) {}
+
+/*
+ * @brief  デストラクタ
+ */
+Almanac::~Almanac() {
+  if (p_map != nullptr) munmap(p_map, s_map);
+  if (fd >= 0) close(fd);
+}
+
+/*
+ * @brief      OPEN
+ *             (ヘッダを照合し、各領域がファイル内に収まることを確かめる。
+ *              参照は日付・地点に対してランダムのため MADV_RANDOM)
+ *
+ * @param[in]  ファイル名 (string)
+ * @param[in]  更新用（読み書き可能でマップ） (bool)
+ * @return     成否 (bool)
+ */
+bool Almanac::open(const std::string& f, bool f_rw) {
+  struct stat st;
+  void* p;
+
+  try {
+    fd = ::open(f.c_str(), f_rw ? O_RDWR : O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) return false;
+    s_map = st.st_size;
+    if (s_map < sizeof(head)) return false;
+    p = mmap(nullptr, s_map, f_rw ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    p_map = static_cast<char*>(p);
+    madvise(p, s_map, MADV_RANDOM);
+    std::memcpy(&head, p_map, sizeof(head));
+    if (std::memcmp(head.magic, kAlmMagic, sizeof(kAlmMagic)) != 0
+        || head.s_rec != sizeof(AlmRec) || head.n_bkt != alm_bkt_size(head.n_site)
+        || head.off_day + std::uint64_t(head.n_day) * sizeof(AlmDay) > head.off_site
+        || head.off_site + std::uint64_t(head.n_site) * sizeof(AlmSite) > head.off_bkt
+        || head.off_bkt + std::uint64_t(head.n_bkt) * sizeof(std::uint32_t) > head.off_rec
+        || head.off_rec % 4096 != 0
+        || head.off_rec + std::uint64_t(head.n_site) * head.n_day * sizeof(AlmRec) != s_map)
+      return false;
+    days  = reinterpret_cast<AlmDay*>(p_map + head.off_day);
+    sites = reinterpret_cast<const AlmSite*>(p_map + head.off_site);
+    bkts  = reinterpret_cast<const std::uint32_t*>(p_map + head.off_bkt);
+    recs  = reinterpret_cast<AlmRec*>(p_map + head.off_rec);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief       参照: 地点 ID・日付の計算結果
+ *
+ * @param[in]   地点 ID（NUL 終端） (const char*)
+ * @param[in]   日付(JST 00:00:00) (timespec)
+ * @param[ref]  問い合わせ (Query, 地点の緯度・経度・標高と日付)
+ * @param[ref]  計算結果 (Result)
+ * @param[ref]  計算状態 (ResSt)
+ * @return      成否（地点・日付が範囲外の場合は false） (bool)
+ */
+bool Almanac::find(const char* id, const struct timespec& jst, Query& q, Result& res,
+                   ResSt& rs) const {
+  std::uint32_t msk = head.n_bkt - 1;
+  std::uint32_t b;
+  std::uint32_t s;
+  std::int64_t  d;
+
+  // 日付（JST は夏時間がないため 86400 秒毎）
+  d = (std::int64_t(jst.tv_sec) - head.day_0) / std::int64_t(kSecDay);
+  if (jst.tv_sec < head.day_0 || d >= std::int64_t(head.n_day)) return false;
+  // 地点（線形探索）
+  for (b = alm_hash(id) & msk;; b = (b + 1) & msk) {
+    if ((s = bkts[b]) == 0) return false;
+    if (std::strncmp(sites[s - 1].id, id, kAlmIdLen) == 0) break;
+  }
+  const AlmSite& st = sites[s - 1];
+  q.jst = jst;
+  q.lat = st.lat;
+  q.lng = st.lng;
+  q.ht  = st.ht;
+  from_rec(recs[std::uint64_t(s - 1) * head.n_day + d], jst.tv_sec, res, rs);
+  res.eop_ver = head.eop_ver;
+
+  return true;
+}
+
+/*
+ * @brief      更新: EOP 一覧の版数（ヘッダ）
+ *
+ * @param[in]  版数 (uint64_t)
+ * @return     none
+ */
+void Almanac::set_eop_ver(std::uint64_t ver) {
+  head.eop_ver = ver;
+  std::memcpy(p_map, &head, sizeof(head));
+}
+
+/*
+ * @brief      書出: 更新内容（msync）
+ *
+ * @param      none
+ * @return     成否 (bool)
+ */
+bool Almanac::sync() {
+  return msync(p_map, s_map, MS_SYNC) == 0;
+}
+
+/*
+ * @brief      実行: 暦ファイルの参照
+ *             (標準入力の "SITE_ID YYYYMMDD" に 1 行ずつ、常駐モードと同じ
+ *              "OK " + 1 件 1 行形式で応答する。天文計算は行わない)
+ *
+ * @param[in]  暦ファイル名 (string)
+ * @return     終了コード (int)
+ */
+int run_lookup(const std::string& f) {
+  Almanac o_alm;
+  Formatter o_fmt(1, kLyLine);
+  std::string ln;
+  std::string id;
+  std::string dt;
+  struct timespec jst;
+  Query  q;
+  Result res;
+  ResSt  rs;
+
+  try {
+    if (!o_alm.open(f)) {
+      std::cerr << "[ERROR] Cannot open " << f << std::endl;
+      return EXIT_FAILURE;
+    }
+    while (std::getline(std::cin, ln)) {
+      std::size_t p = ln.find_first_of(" ,\t");
+      id = ln.substr(0, p);
+      p  = p == std::string::npos ? p : ln.find_first_not_of(" ,\t", p);
+      dt = p == std::string::npos ? "" : ln.substr(p);
+      if (!dt.empty() && dt.back() == '\r') dt.pop_back();
+      if (!parse_date(dt, jst)) {
+        o_fmt.put_str("ERR bad request\n");
+      } else if (!o_alm.find(id.c_str(), jst, q, res, rs)) {
+        o_fmt.put_str("ERR not found\n");
+      } else {
+        o_fmt.put_str("OK ", 3);
+        o_fmt.put(q, res, &rs);
+      }
+      // 対話的に使えるよう、入力が途切れたら応答を書き出す
+      if (std::cin.rdbuf()->in_avail() <= 0 && !o_fmt.flush()) return EXIT_FAILURE;
+    }
+    if (!o_fmt.flush()) return EXIT_FAILURE;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace sun_moon
+
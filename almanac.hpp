@@ -0,0 +1,104 @@
+#ifndef SUN_MOON_ALMANAC_HPP_
+#define SUN_MOON_ALMANAC_HPP_
+
+#include "engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 暦ファイル（地点一覧 × 日付範囲の計算結果）
+// * ヘッダ:   AlmHead
+// * 日付一覧: AlmDay × 日数（各日の計算に使用した ΔT）
+// * 地点一覧: AlmSite × 地点数（地点一覧ファイルの順）
+// * 索引:     地点 ID のハッシュ表（uint32 × バケット数, 地点番号 + 1, 0 は空き, 線形探索）
+// * レコード: AlmRec × 地点数 × 日数（地点 → 日付 の順, 4096 バイト境界から）
+// * 数値はホストのバイト順（リトルエンディアン前提）
+// * (地点, 日付) の参照はハッシュ表の探索と 128 バイトのレコード 1 件の読込のみで、
+//   レコードはページをまたがない
+static constexpr char kAlmMagic[8] = {'S', 'M', 'A', 'L', 'M', '0', '2', '\0'};
+static constexpr std::size_t  kAlmIdLen = 24;      // 地点 ID の最大長(NUL 終端を含む)
+static constexpr std::int32_t kAlmNone   = INT32_MAX;      // イベントなし（月の出入がない日）
+static constexpr std::int32_t kAlmNoConv = INT32_MAX - 1;  // 反復が収束しない
+
+struct AlmHead {
+  char          magic[8];  // "SMALM02\0"
+  std::uint32_t n_site;    // 地点数
+  std::uint32_t n_day;     // 日数
+  std::int64_t  day_0;     // 先頭日の JST 00:00:00
+  std::uint32_t n_bkt;     // 索引のバケット数（2 の冪）
+  std::uint32_t s_rec;     // レコードサイズ
+  std::uint64_t off_day;   // 日付一覧の位置
+  std::uint64_t off_site;  // 地点一覧の位置
+  std::uint64_t off_bkt;   // 索引の位置
+  std::uint64_t off_rec;   // レコードの位置
+  std::uint64_t eop_ver;   // 計算に使用した EOP 一覧の版数
+};
+struct AlmDay {
+  float dlt_t;             // ΔT(秒, Calc と同じく JST 00:00:00 の 9 時間前で求めた値)
+  float drift;             // 再計算を省いたレコードに残る ΔT の差の上限(秒)
+};
+struct AlmSite {
+  char   id[kAlmIdLen];    // 地点 ID（NUL 終端）
+  double lat;              // 緯度
+  double lng;              // 経度
+  double ht;               // 標高
+};
+struct AlmEv {
+  std::int32_t sec;        // 当日 00:00:00 からの秒数（kAlmNone: イベントなし, kAlmNoConv: 収束しない）
+  std::int32_t nsec;       // ナノ秒
+  double       ah;         // 方位角／高度
+};
+struct AlmRec {
+  struct AlmEv sun[3];     // 日の出・入・南中
+  struct AlmEv moon[3];    // 月の出・入・南中
+  struct MoonPhase phase;  // 月の位相
+};
+static_assert(sizeof(AlmRec) == 128, "AlmRec must be 128 bytes");
+
+bool load_sites(const std::string&, std::vector<AlmSite>&);  // 読込: 地点一覧
+std::uint32_t alm_bkt_size(std::uint32_t);                   // 計算: 索引のバケット数
+std::uint64_t alm_hash(const char*);                         // 計算: 地点 ID のハッシュ値
+void to_rec(const Result&, const ResSt&, time_t, AlmRec&);   // 変換: 計算結果 -> レコード
+void from_rec(const AlmRec&, time_t, Result&, ResSt&);       // 変換: レコード -> 計算結果
+bool rec_stale(const AlmSite&, const AlmRec&, const AlmRec*, const AlmRec*, double);
+                                  // 判定: ΔT の変化で出力（丸めた値）が変わり得るレコード
+
+// 参照: 暦ファイル（メモリマップ）
+class Almanac {
+  int            fd;     // ファイルディスクリプタ
+  char*          p_map;  // マップ先頭
+  std::size_t    s_map;  // マップサイズ
+  AlmHead        head;   // ヘッダ
+  AlmDay*        days;   // 日付一覧
+  const AlmSite* sites;  // 地点一覧
+  const std::uint32_t* bkts;  // 索引
+  AlmRec*        recs;   // レコード
+
+public:
+  Almanac();   // コンストラクタ
+  ~Almanac();  // デストラクタ
+  bool open(const std::string&, bool = false);
+                                  // OPEN（ヘッダ・各領域の大きさを照合, true: 更新用）
+  bool find(const char*, const struct timespec&, Query&, Result&, ResSt&) const;
+                                  // 参照: 地点 ID・日付(JST) の計算結果
+  const AlmHead& get_head() const { return head; }  // 取得: ヘッダ
+  AlmDay& get_day(std::uint32_t d) { return days[d]; }  // 取得: 日付一覧の 1 件
+  const AlmSite& get_site(std::uint32_t s) const { return sites[s]; }  // 取得: 地点
+  AlmRec& get_rec(std::uint32_t s, std::uint32_t d) {   // 取得: レコード
+    return recs[std::uint64_t(s) * head.n_day + d];
+  }
+  void set_eop_ver(std::uint64_t);  // 更新: EOP 一覧の版数
+  bool sync();                      // 書出: 更新内容
+};
+
+int run_lookup(const std::string&);  // 実行: 暦ファイルの参照（標準入力の問い合わせを 1 行ずつ）
+
+}  // namespace sun_moon
+
+#endif
+
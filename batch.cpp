@@ -0,0 +1,1397 @@
+#include "batch.hpp"
+#include "almanac.hpp"
+#include "colfile.hpp"
+#include "contour.hpp"
+#include "engine.hpp"
+#include "eop.hpp"
+#include "grid.hpp"
+#include "lunar.hpp"
+#include "poa.hpp"
+#include "queue.hpp"
+#include "sched.hpp"
+#include "search.hpp"
+#include "time.hpp"
+#include "track.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstdio>    // for rename
+#include <cstdlib>   // for EXIT_XXXX
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace sun_moon {
+
+// 定数
+static constexpr std::size_t kBlk      = 16384;  // 計算単位(行数)
+static constexpr std::size_t kDepth    = 4;      // 段間キューの上限(ブロック数)
+static constexpr std::size_t kTrkChunk = 16384;  // 時系列: 並列計算・出力の単位(点)
+static constexpr std::size_t kTwiChunk = 1024;   // 薄明等: 並列計算・出力の単位(行数)
+static constexpr std::size_t kInvChunk = 1024;   // 逆算: 並列計算・出力の単位(行数)
+static constexpr std::uint64_t kPoaMax = 1 << 23; // 入射角: 太陽の時系列の上限(点)
+static constexpr std::size_t kPhBlk    = 1024;   // 月相一覧: 並列計算・出力の単位(朔望月数)
+static constexpr std::size_t kAlmBlk   = 16384;  // 暦ファイル: 並列計算・書出の単位(レコード数)
+static constexpr time_t      kSrchChunk = Search::kStep * 24 * 32;
+                                                 // 出入探索: 並列計算・出力の単位(秒)
+
+// 段間で受け渡すブロック
+struct Block {
+  std::uint64_t              id;    // ブロック番号（出力順）
+  std::size_t                n;     // 行数
+  std::vector<Row>           rows;  // 入力行
+  std::vector<struct Result> res;   // 計算結果
+  std::vector<struct ResSt>  st;    // 計算状態
+  std::string                out;   // 整形結果
+};
+using BlockPtr = std::unique_ptr<Block>;
+
+// 出力先（テキストはファイルディスクリプタ、列形式バイナリは ColWriter。破棄時に閉じる）
+class OutFile {
+  int                        fd;     // ファイルディスクリプタ（1: 標準出力, -1: なし）
+  std::unique_ptr<ColWriter> o_col;  // 列形式バイナリ（nullptr: テキスト）
+
+public:
+  OutFile() : fd(-1) {}               // コンストラクタ
+  ~OutFile() { close(); }             // デストラクタ
+  OutFile(const OutFile&) = delete;
+  OutFile& operator=(const OutFile&) = delete;
+  bool open(const std::string&, bool = false);  // OPEN（"-" は標準出力）
+  bool write(const void*, std::size_t);         // 書出: 全バイト（テキストのみ）
+  bool write(const std::string&);               // 書出: 整形結果・生成済みチャンク
+  bool sync();                                  // 書出: ディスクへの反映
+  void close();                                 // CLOSE
+};
+
+/*
+ * @brief      OPEN
+ *             (失敗時は "[ERROR] Cannot open" を出力)
+ *
+ * @param[in]  ファイル名 ("-" は標準出力) (string)
+ * @param[in]  列形式バイナリ (bool, 既定: テキスト)
+ * @return     成否 (bool)
+ */
+bool OutFile::open(const std::string& f, bool f_col) {
+  bool ok;
+
+  try {
+    close();
+    if (f_col) {
+      o_col.reset(new ColWriter);
+      ok = o_col->open(f);
+    } else {
+      fd = (f == "-") ? 1 : ::open(f.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      ok = fd >= 0;
+    }
+    if (!ok) std::cerr << "[ERROR] Cannot open " << f << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return ok;
+}
+
+/*
+ * @brief      書出: 全バイト（テキストのみ）
+ *
+ * @param[in]  データ (const void*)
+ * @param[in]  バイト数 (size_t)
+ * @return     成否 (bool)
+ */
+bool OutFile::write(const void* p, std::size_t n) {
+  return fd >= 0 && write_all(fd, p, n);
+}
+
+/*
+ * @brief      書出: 整形結果・生成済みチャンク（列形式バイナリは ColWriter::put_raw）
+ *
+ * @param[in]  データ (string)
+ * @return     成否 (bool)
+ */
+bool OutFile::write(const std::string& s) {
+  return o_col ? o_col->put_raw(s) : write(s.data(), s.size());
+}
+
+/*
+ * @brief   書出: ディスクへの反映（テキストのファイルのみ）
+ *
+ * @param   none
+ * @return  成否 (bool)
+ */
+bool OutFile::sync() {
+  return fd > 1 && fsync(fd) == 0;
+}
+
+/*
+ * @brief   CLOSE（標準出力は閉じない）
+ *
+ * @param   none
+ * @return  none
+ */
+void OutFile::close() {
+  if (fd > 1) ::close(fd);
+  fd = -1;
+  o_col.reset();
+}
+
+/*
+ * @brief      実行: 一括計算
+ *             (解析 → 計算 → 整形 → 書出 を上限付きキューでつないだパイプライン。
+ *              各段は上流が詰まれば待つため、入力の大きさによらずメモリ使用量は
+ *              一定で、全体の速度は最も遅い段の速度となる)
+ *             * 解析: 1 スレッド（供給元から kBlk 件ずつ）
+ *             * 計算: ワークスティーリングで並列（ブロック単位で投入）
+ *             * 整形: 複数スレッド（ブロック毎にバッファへ整形）
+ *             * 書出: 1 スレッド（ブロック番号順に並べ直して書き出し）
+ *
+ * @param[in]  問い合わせの供給元 (Source)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_batch(Source& src, const BatchOpt& opt) {
+  Queue<BlockPtr> q_prs(kDepth);   // 解析済み
+  Queue<BlockPtr> q_cmp(kDepth);   // 計算済み
+  Queue<BlockPtr> q_fmt(kDepth);   // 整形済み
+  std::vector<std::thread> ths;    // 各段のスレッド（解析・計算・整形）
+  std::exception_ptr ex;           // 最初に発生した例外
+  std::mutex mtx_ex;               // 例外記録用
+  std::uint64_t n_row = 0;         // 計算件数
+  std::atomic<std::uint64_t> n_err(0);   // 計算できなかった件数
+  std::atomic<std::uint64_t> n_ncv(0);   // 収束しなかったイベント数
+  unsigned int n_fmt;              // 整形スレッド数
+  std::atomic<unsigned int> n_fmt_run(0);  // 実行中の整形スレッド数
+  unsigned int i;
+
+  // 例外発生時は全キューを閉じて各段を止める
+  auto fail = [&](std::exception_ptr e) {
+    {
+      std::lock_guard<std::mutex> lk(mtx_ex);
+      if (!ex) ex = e;
+    }
+    q_prs.close();
+    q_cmp.close();
+    q_fmt.close();
+  };
+
+  try {
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    OutFile o_out;
+    if (!o_out.open(opt.f_out, opt.ly == kLyBin)) return EXIT_FAILURE;
+    // 合流: 例外で抜ける場合も全キューを閉じて各段を止め、全スレッドを合流する
+    // (joinable のまま std::thread を破棄すると std::terminate となるため。
+    //  各段が参照する o_s 等より後に宣言し、先に破棄されるようにする)
+    struct Joiner {
+      std::vector<std::thread>& ths;
+      Queue<BlockPtr>* qs[3];
+      void join() {
+        for (auto& th : ths) {
+          if (th.joinable()) th.join();
+        }
+      }
+      ~Joiner() {
+        for (auto q : qs) q->close();
+        join();
+      }
+    } o_join{ths, {&q_prs, &q_cmp, &q_fmt}};
+
+    // 解析
+    ths.emplace_back([&] {
+      try {
+        for (std::uint64_t id = 0;; ++id) {
+          BlockPtr b(new Block);
+          b->id = id;
+          b->rows.reserve(kBlk);
+          if ((b->n = src.read(b->rows, kBlk)) == 0) break;
+          if (!q_prs.push(std::move(b))) break;
+        }
+        q_prs.close();
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    });
+    // 計算
+    ths.emplace_back([&] {
+      try {
+        BlockPtr b;
+        while (q_prs.pop(b)) {
+          b->res.resize(b->rows.size());
+          b->st.resize(b->rows.size());
+          Block* p = b.get();
+          const HorizonSet* hzs = opt.hz.get();
+          o_s.run(p->rows.size(), [p, &eop, hzs, &n_err, &n_ncv](std::size_t j) {
+            const Query& q = p->rows[j].q;
+            ResSt& rs = p->st[j];
+            // 1 件の失敗は巻き戻さず状態とともに出力し、件数を数える
+            if (calc_all_st(q, eop, hzs ? hzs->find(q.lat, q.lng) : nullptr,
+                            p->res[j], rs) != kStOk) {
+              n_err.fetch_add(1, std::memory_order_relaxed);
+              return;
+            }
+            for (CalcSt e : rs.ev) {
+              if (e == kStNoConv) n_ncv.fetch_add(1, std::memory_order_relaxed);
+            }
+          });
+          if (!q_cmp.push(std::move(b))) break;
+        }
+        q_cmp.close();
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    });
+    // 整形
+    n_fmt = std::max(1u, o_s.size() / 4);
+    n_fmt_run = n_fmt;
+    for (i = 0; i < n_fmt; ++i) {
+      ths.emplace_back([&] {
+        try {
+          Formatter o_fmt(-1, opt.ly);
+          ColWriter o_chk;
+          BlockPtr b;
+          while (q_cmp.pop(b)) {
+            for (std::size_t j = 0; j < b->rows.size(); ++j) {
+              if (opt.ly == kLyBin) {
+                o_chk.put(b->rows[j].seq, b->rows[j].q, b->res[j], &b->st[j]);
+              } else {
+                o_fmt.put(b->rows[j].q, b->res[j], &b->st[j]);
+              }
+            }
+            b->out = opt.ly == kLyBin ? o_chk.take() : o_fmt.take();
+            std::vector<Row>().swap(b->rows);  // 書出待ちの間は整形結果のみ保持
+            std::vector<struct Result>().swap(b->res);
+            std::vector<struct ResSt>().swap(b->st);
+            if (!q_fmt.push(std::move(b))) break;
+          }
+        } catch (...) {
+          fail(std::current_exception());
+        }
+        if (--n_fmt_run == 0) q_fmt.close();
+      });
+    }
+    // 書出（呼び出し元スレッド）
+    {
+      Formatter o_head(-1, opt.ly);
+      std::map<std::uint64_t, BlockPtr> pend;  // 順番待ち
+      std::uint64_t id_nxt = 0;                // 次に書き出すブロック番号
+      BlockPtr b;
+      bool ok = true;
+      o_head.put_head();
+      std::string head = o_head.take();
+      if (!head.empty()) ok = o_out.write(head);
+      while (ok && q_fmt.pop(b)) {
+        pend.emplace(b->id, std::move(b));
+        for (auto it = pend.begin();
+             ok && it != pend.end() && it->first == id_nxt;
+             it = pend.erase(it), ++id_nxt) {
+          const std::string& s = it->second->out;
+          ok = o_out.write(s);
+          n_row += it->second->n;
+        }
+      }
+      if (!ok) fail(std::make_exception_ptr(std::runtime_error("write error")));
+    }
+    o_join.join();
+    o_out.close();
+    if (ex) std::rethrow_exception(ex);
+    std::cerr << "[INFO] " << n_row << " rows, "
+              << src.get_bad() << " malformed";
+    if (n_err) std::cerr << ", " << n_err << " failed";
+    if (n_ncv) std::cerr << ", " << n_ncv << " events not converged";
+    std::cerr << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 格子点の適応補間
+ *             (日毎に、緯度方向 GridAdapt::kCell 行の帯を経度方向 kCell 点のタイルに分け、
+ *              タイル単位でワークスティーリングにより並列に計算する。帯の結果は
+ *              緯度の行単位で並列に整形し、通常の格子点モードと同じ順に書き出す)
+ *
+ * @param[in]  格子点 (Grid)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_grid_adapt(Grid& grid, const BatchOpt& opt) {
+  std::uint64_t n_lat = grid.get_n_lat();
+  std::uint64_t n_lng = grid.get_n_lng();
+  std::uint64_t n_tile = (n_lng + GridAdapt::kCell - 1) / GridAdapt::kCell;  // 帯内のタイル数
+  std::uint64_t n_row = 0;             // 出力件数
+  std::uint64_t d;
+  std::uint64_t i_0;
+  bool ok = true;
+
+  try {
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    GridAdapt o_ad(grid, opt.tol_ad, eop);
+    OutFile o_out;
+    std::vector<std::string> outs(GridAdapt::kCell);            // 整形結果（行毎）
+    if (!o_out.open(opt.f_out, opt.ly == kLyBin)) return EXIT_FAILURE;
+    {
+      Formatter o_head(-1, opt.ly);
+      o_head.put_head();
+      std::string head = o_head.take();
+      if (!head.empty()) ok = o_out.write(head);
+    }
+    for (d = 0; ok && d < grid.get_n_day(); ++d) {
+      for (i_0 = 0; ok && i_0 < n_lat; i_0 += GridAdapt::kCell) {
+        std::uint64_t n_r = std::min(GridAdapt::kCell, n_lat - i_0);  // 帯の行数
+        o_ad.begin_band(d, i_0);
+        o_s.run(n_tile, [&](std::size_t t) { o_ad.calc_tile(t * GridAdapt::kCell); });
+        o_s.run(n_r, [&](std::size_t r) {
+          std::uint64_t seq = (d * n_lat + i_0 + r) * n_lng;  // 行の先頭の行番号
+          Formatter o_fmt(-1, opt.ly);
+          ColWriter o_chk;
+          for (std::uint64_t j = 0; j < n_lng; ++j) {
+            Row row = grid.row(seq + j);
+            if (opt.ly == kLyBin) {
+              o_chk.put(row.seq, row.q, o_ad.get(r, j), &o_ad.get_st(r, j));
+            } else {
+              o_fmt.put(row.q, o_ad.get(r, j), &o_ad.get_st(r, j));
+            }
+          }
+          outs[r] = opt.ly == kLyBin ? o_chk.take() : o_fmt.take();
+        });
+        for (std::uint64_t r = 0; ok && r < n_r; ++r) {
+          ok = o_out.write(outs[r]);
+          std::string().swap(outs[r]);
+        }
+        n_row += n_r * n_lng;
+      }
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_row << " rows, " << o_ad.get_n_ex() << " solved exactly"
+              << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 薄明等の一括計算
+ *             (供給元から kBlk 件ずつ読み込み、kTwiChunk 件単位でワークスティーリングに
+ *              より並列に計算・整形して、入力順に書き出す)
+ *
+ * @param[in]  問い合わせの供給元 (Source)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_twilight(Source& src, const BatchOpt& opt) {
+  std::vector<Row> rows;      // 入力行
+  std::uint64_t n_row = 0;    // 計算件数
+  bool ok = true;
+
+  try {
+    if (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson) {
+      std::cerr << "[ERROR] Invalid format for twilight!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(kBlk / kTwiChunk);  // 整形結果（チャンク毎）
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    {
+      Formatter o_fmt(-1, opt.ly);
+      o_fmt.put_twi_head();
+      std::string h = o_fmt.take();
+      ok = o_out.write(h);
+    }
+    while (ok && src.read(rows, kBlk) > 0) {
+      std::size_t n_chk = (rows.size() + kTwiChunk - 1) / kTwiChunk;
+      o_s.run(n_chk, [&](std::size_t c) {
+        std::size_t r_1 = std::min(rows.size(), (c + 1) * kTwiChunk);
+        Formatter o_fmt(-1, opt.ly);
+        for (std::size_t r = c * kTwiChunk; r < r_1; ++r) {
+          o_fmt.put(rows[r].q, calc_twilight(rows[r].q, eop));
+        }
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+      }
+      n_row += rows.size();
+      rows.clear();
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_row << " rows, " << src.get_bad() << " malformed"
+              << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// 逆算: 結果の枠の名称（区分毎, JSON のキー・CSV の見出しの接尾辞）と値の名称
+static constexpr struct {
+  unsigned int n;        // 枠数
+  const char*  slot[2];  // 枠の名称
+  const char*  val;      // 値の名称
+} kInvSlot[3] = {
+  {2, {"up", "down"},      "az"},   // 高度: 上昇時・下降時の方位角
+  {2, {"first", "second"}, "alt"},  // 方位角: 時刻順の高度
+  {1, {"", ""},            "alt"},  // 日南中の前後: 高度
+};
+
+/*
+ * @brief      出力: 見出し行（逆算, CSV のみ）
+ *             (date,lat,lng,ht,対象名_枠名,対象名_枠名_値名,...,eop_ver)
+ *
+ * @param[ref] 出力先 (Formatter)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     none
+ */
+static void put_inv_head(Formatter& o_fmt, const BatchOpt& opt) {
+  std::size_t i;
+  unsigned int j;
+
+  if (opt.ly != kLyCsv) return;
+  o_fmt.put_str("date,lat,lng,ht");
+  for (i = 0; i < opt.tgts.size(); ++i) {
+    const auto& sl = kInvSlot[opt.tgts[i].kd];
+    for (j = 0; j < sl.n; ++j) {
+      for (unsigned int f_v = 0; f_v < 2; ++f_v) {
+        o_fmt.put_chr(',');
+        o_fmt.put_str(opt.tgt_names[i]);
+        if (sl.n > 1) {
+          o_fmt.put_chr('_');
+          o_fmt.put_str(sl.slot[j]);
+        }
+        if (f_v == 1) {
+          o_fmt.put_chr('_');
+          o_fmt.put_str(sl.val);
+        }
+      }
+    }
+  }
+  o_fmt.put_str(",eop_ver\n");
+}
+
+/*
+ * @brief      出力: 逆算 1 件
+ *             (line: "YYYYMMDD 緯度 経度 標高" に続けて対象毎・枠毎に "HH:MM:SS 値"
+ *              (該当なしは "--:--:-- ---.--"), 最後に EOP 版数。csv: 同じ並びをカンマ区切り
+ *              (該当なしは空欄), jsonl: 対象名をキーとし、枠毎に {"time":..,値名:..} または null。
+ *              日南中の前後は枠を置かず {"time":..,"alt":..} とする。
+ *              時刻は日付をまたぐ場合も時刻のみ)
+ *
+ * @param[ref] 出力先 (Formatter)
+ * @param[in]  出力指定 (BatchOpt)
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  結果 (InvRes[対象数])
+ * @param[in]  EOP 一覧の版数 (uint64_t)
+ * @return     none
+ */
+static void put_inverse(Formatter& o_fmt, const BatchOpt& opt, const Query& q,
+                        const struct InvRes* res, std::uint64_t ver) {
+  Layout ly = opt.ly;
+  char sep = ly == kLyCsv ? ',' : ' ';
+  std::size_t i;
+  unsigned int j;
+
+  if (ly == kLyJson) {
+    o_fmt.put_str("{\"date\":\"");
+    o_fmt.put_date(q.jst.tv_sec, '-');
+    o_fmt.put_str("\",\"lat\":");
+  } else {
+    o_fmt.put_date(q.jst.tv_sec, '\0');
+    o_fmt.put_chr(sep);
+  }
+  o_fmt.put_fixed(q.lat, 4);
+  o_fmt.put_str(ly == kLyJson ? ",\"lng\":" : &sep, ly == kLyJson ? 7 : 1);
+  o_fmt.put_fixed(q.lng, 4);
+  o_fmt.put_str(ly == kLyJson ? ",\"ht\":" : &sep, ly == kLyJson ? 6 : 1);
+  o_fmt.put_fixed(q.ht, 4);
+  for (i = 0; i < opt.tgts.size(); ++i) {
+    const auto& sl = kInvSlot[opt.tgts[i].kd];
+    if (ly == kLyJson) {
+      o_fmt.put_str(",\"");
+      o_fmt.put_str(opt.tgt_names[i]);
+      o_fmt.put_str(sl.n > 1 ? "\":{" : "\":");
+    }
+    for (j = 0; j < sl.n; ++j) {
+      const struct InvEv& ev = res[i].ev[j];
+      if (ly == kLyJson) {
+        if (j > 0) o_fmt.put_chr(',');
+        if (sl.n > 1) {
+          o_fmt.put_chr('"');
+          o_fmt.put_str(sl.slot[j]);
+          o_fmt.put_str("\":");
+        }
+        if (!ev.f) {
+          o_fmt.put_str("null");
+          continue;
+        }
+        o_fmt.put_str("{\"time\":\"");
+        o_fmt.put_hms(ev.time);
+        o_fmt.put_str("\",\"");
+        o_fmt.put_str(sl.val);
+        o_fmt.put_str("\":");
+        o_fmt.put_fixed(ev.val, 2);
+        o_fmt.put_chr('}');
+      } else if (!ev.f) {
+        o_fmt.put_str(ly == kLyCsv ? ",," : " --:--:-- ---.--", ly == kLyCsv ? 2 : 16);
+      } else {
+        o_fmt.put_chr(sep);
+        o_fmt.put_hms(ev.time);
+        o_fmt.put_chr(sep);
+        o_fmt.put_fixed(ev.val, 2);
+      }
+    }
+    if (ly == kLyJson && sl.n > 1) o_fmt.put_chr('}');
+  }
+  o_fmt.put_str(ly == kLyJson ? ",\"eop_ver\":" : &sep, ly == kLyJson ? 11 : 1);
+  o_fmt.put_uint(ver, 1);
+  o_fmt.put_str(ly == kLyJson ? "}\n" : "\n");
+}
+
+/*
+ * @brief      実行: 指定高度・方位角の時刻等の一括逆算
+ *             (run_twilight と同じく kInvChunk 件単位で並列に計算・整形し、入力順に
+ *              書き出す。結果の領域はチャンク毎に確保して使い回す)
+ *
+ * @param[in]  問い合わせの供給元 (Source)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_inverse(Source& src, const BatchOpt& opt) {
+  std::vector<Row> rows;      // 入力行
+  std::uint64_t n_row = 0;    // 計算件数
+  std::size_t n_tg = opt.tgts.size();  // 対象数
+  bool ok = true;
+
+  try {
+    if (n_tg == 0 || (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson)) {
+      std::cerr << "[ERROR] Invalid targets or format!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(kBlk / kInvChunk);             // 整形結果（チャンク毎）
+    std::vector<struct InvRes> res(kBlk / kInvChunk * n_tg);     // 計算結果（チャンク毎）
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    {
+      Formatter o_fmt(-1, opt.ly);
+      put_inv_head(o_fmt, opt);
+      std::string h = o_fmt.take();
+      ok = o_out.write(h);
+    }
+    while (ok && src.read(rows, kBlk) > 0) {
+      std::size_t n_chk = (rows.size() + kInvChunk - 1) / kInvChunk;
+      o_s.run(n_chk, [&](std::size_t c) {
+        std::size_t r_1 = std::min(rows.size(), (c + 1) * kInvChunk);
+        struct InvRes* p = &res[c * n_tg];
+        Formatter o_fmt(-1, opt.ly);
+        for (std::size_t r = c * kInvChunk; r < r_1; ++r) {
+          std::uint64_t ver = calc_inverse(rows[r].q, opt.tgts, eop, p);
+          put_inverse(o_fmt, opt, rows[r].q, p, ver);
+        }
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+      }
+      n_row += rows.size();
+      rows.clear();
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_row << " rows x " << n_tg << " targets, "
+              << src.get_bad() << " malformed" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      出力: 時系列 1 点
+ *             (line: "YYYYMMDD HH:MM:SS[.f] ALT AZ", csv: 同じ並びをカンマ区切り,
+ *              jsonl: {"date":..,"time":..,"alt":..,"az":..})
+ *
+ * @param[ref] 出力先 (Formatter)
+ * @param[in]  出力形式 (Layout)
+ * @param[in]  時刻 (timespec)
+ * @param[in]  秒未満の桁数 (unsigned int)
+ * @param[in]  視位置 (AltAz)
+ * @return     none
+ */
+static void put_sample(Formatter& o_fmt, Layout ly, const struct timespec& ts,
+                       unsigned int n_frac, const struct AltAz& aa) {
+  char sep = ly == kLyCsv ? ',' : ' ';
+
+  if (ly == kLyJson) o_fmt.put_str("{\"date\":\"");
+  o_fmt.put_date(ts.tv_sec, ly == kLyJson ? '-' : '\0');
+  o_fmt.put_str(ly == kLyJson ? "\",\"time\":\"" : &sep, ly == kLyJson ? 10 : 1);
+  o_fmt.put_hms(ts);
+  if (n_frac > 0) {
+    o_fmt.put_chr('.');
+    o_fmt.put_uint(ts.tv_nsec / (n_frac == 3 ? 1000000 : 1000), n_frac);
+  }
+  o_fmt.put_str(ly == kLyJson ? "\",\"alt\":" : &sep, ly == kLyJson ? 8 : 1);
+  o_fmt.put_fixed(aa.alt, 4);
+  o_fmt.put_str(ly == kLyJson ? ",\"az\":" : &sep, ly == kLyJson ? 6 : 1);
+  o_fmt.put_fixed(aa.az, 4);
+  o_fmt.put_str(ly == kLyJson ? "}\n" : "\n");
+}
+
+/*
+ * @brief      判定: 時系列の観測地点（check_query と同じ範囲）
+ *
+ * @param[in]  範囲 (TrackSpec)
+ * @return     適否 (bool)
+ */
+static bool check_pos(const TrackSpec& spec) {
+  return std::isfinite(spec.lat) && std::isfinite(spec.lng)
+      && std::abs(spec.lat) <= 90.0 && std::abs(spec.lng) <= 360.0;
+}
+
+/*
+ * @brief      実行: 時系列出力
+ *             (kTrkChunk 点単位でワークスティーリングにより並列に計算・整形し、
+ *              時刻順に書き出す)
+ *
+ * @param[in]  範囲 (TrackSpec)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_track(const TrackSpec& spec, const BatchOpt& opt) {
+  std::int64_t span_ns;       // 範囲(ns)
+  std::uint64_t n;            // 総点数
+  std::uint64_t n_done = 0;   // 出力済み点数
+  unsigned int n_frac;        // 秒未満の桁数
+  bool ok = true;
+
+  try {
+    if (spec.step_ns <= 0 || spec.t_1.tv_sec <= spec.t_0.tv_sec
+        || spec.t_1.tv_sec - spec.t_0.tv_sec > 9000000000LL
+        || (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson)) {
+      std::cerr << "[ERROR] Invalid track range or format!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!check_pos(spec)) {
+      std::cerr << "[ERROR] Invalid latitude or longitude!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    span_ns = (spec.t_1.tv_sec - spec.t_0.tv_sec) * 1000000000LL;
+    n = (span_ns + spec.step_ns - 1) / spec.step_ns;
+    n_frac = spec.step_ns % 1000000000 == 0 ? 0
+           : spec.step_ns % 1000000 == 0 ? 3 : 6;
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(o_s.size() * 4);  // 整形結果（チャンク毎）
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    if (opt.ly == kLyCsv) ok = o_out.write("date,time,alt,az\n", 17);
+    while (ok && n_done < n) {
+      std::uint64_t n_chk = std::min<std::uint64_t>(
+          outs.size(), (n - n_done + kTrkChunk - 1) / kTrkChunk);
+      o_s.run(n_chk, [&](std::size_t c) {
+        std::uint64_t k_0 = n_done + c * kTrkChunk;  // 先頭の点番号
+        std::size_t m = std::min<std::uint64_t>(kTrkChunk, n - k_0);
+        std::vector<struct AltAz> aa(m);
+        struct timespec ts;
+        Track o_tr(spec.bd, spec.lat, spec.lng, eop);
+        Formatter o_fmt(-1, opt.ly);
+        ts.tv_sec  = spec.t_0.tv_sec + std::int64_t(k_0) * spec.step_ns / 1000000000;
+        ts.tv_nsec = std::int64_t(k_0) * spec.step_ns % 1000000000;
+        o_tr.run(ts, spec.step_ns, m, aa.data());
+        for (std::size_t j = 0; j < m; ++j) {
+          std::int64_t ns = std::int64_t(k_0 + j) * spec.step_ns;
+          ts.tv_sec  = spec.t_0.tv_sec + ns / 1000000000;
+          ts.tv_nsec = ns % 1000000000;
+          put_sample(o_fmt, opt.ly, ts, n_frac, aa[j]);
+        }
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+      }
+      n_done = std::min<std::uint64_t>(n, n_done + n_chk * kTrkChunk);
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_done << " samples" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      出力: 入射角 1 件
+ *
+ * @param[ref] 出力先 (Formatter)
+ * @param[in]  出力形式 (Layout)
+ * @param[in]  受光面番号 (size_t)
+ * @param[in]  時刻 (timespec)
+ * @param[in]  秒未満の桁数 (unsigned int)
+ * @param[in]  入射角計算結果 (Poa)
+ * @return     none
+ */
+static void put_poa(Formatter& o_fmt, Layout ly, std::size_t id,
+                    const struct timespec& ts, unsigned int n_frac,
+                    const struct Poa& pa) {
+  char sep = ly == kLyCsv ? ',' : ' ';
+
+  if (ly == kLyJson) o_fmt.put_str("{\"surface\":");
+  o_fmt.put_int(id);
+  o_fmt.put_str(ly == kLyJson ? ",\"date\":\"" : &sep, ly == kLyJson ? 9 : 1);
+  o_fmt.put_date(ts.tv_sec, ly == kLyJson ? '-' : '\0');
+  o_fmt.put_str(ly == kLyJson ? "\",\"time\":\"" : &sep, ly == kLyJson ? 10 : 1);
+  o_fmt.put_hms(ts);
+  if (n_frac > 0) {
+    o_fmt.put_chr('.');
+    o_fmt.put_uint(ts.tv_nsec / (n_frac == 3 ? 1000000 : 1000), n_frac);
+  }
+  o_fmt.put_str(ly == kLyJson ? "\",\"cos_aoi\":" : &sep, ly == kLyJson ? 12 : 1);
+  o_fmt.put_fixed(pa.cos_aoi, 6);
+  o_fmt.put_str(ly == kLyJson ? ",\"rot\":" : &sep, ly == kLyJson ? 7 : 1);
+  o_fmt.put_fixed(pa.rot, 4);
+  o_fmt.put_str(ly == kLyJson ? "}\n" : "\n");
+}
+
+/*
+ * @brief      実行: 受光面の入射角
+ *             (太陽の時系列を kTrkChunk 点単位で並列に一度だけ計算して保持し、
+ *              受光面 × 時刻チャンク を単位に並列に計算・整形して、
+ *              受光面 → 時刻 の順に書き出す)
+ *
+ * @param[in]  範囲 (TrackSpec, 天体は太陽)
+ * @param[in]  受光面一覧 (vector<Surface>)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_poa(const TrackSpec& spec, const std::vector<Surface>& sfs,
+            const BatchOpt& opt) {
+  std::int64_t span_ns;       // 範囲(ns)
+  std::uint64_t n;            // 時系列の点数
+  std::uint64_t n_tc;         // 時刻チャンク数
+  std::uint64_t n_u;          // 計算単位数（受光面 × 時刻チャンク）
+  std::uint64_t u_done = 0;   // 出力済み単位数
+  unsigned int n_frac;        // 秒未満の桁数
+  bool ok = true;
+
+  try {
+    if (spec.step_ns <= 0 || spec.t_1.tv_sec <= spec.t_0.tv_sec
+        || spec.t_1.tv_sec - spec.t_0.tv_sec > 9000000000LL
+        || (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson)) {
+      std::cerr << "[ERROR] Invalid track range or format!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!check_pos(spec)) {
+      std::cerr << "[ERROR] Invalid latitude or longitude!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    span_ns = (spec.t_1.tv_sec - spec.t_0.tv_sec) * 1000000000LL;
+    n = (span_ns + spec.step_ns - 1) / spec.step_ns;
+    if (n > kPoaMax) {
+      std::cerr << "[ERROR] Too many samples (max " << kPoaMax << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+    n_frac = spec.step_ns % 1000000000 == 0 ? 0
+           : spec.step_ns % 1000000 == 0 ? 3 : 6;
+    n_tc = (n + kTrkChunk - 1) / kTrkChunk;
+    n_u  = n_tc * sfs.size();
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(o_s.size() * 4);  // 整形結果（計算単位毎）
+    std::vector<struct AltAz> aa(n);                // 太陽の時系列
+    PoaKernel o_k;
+
+    // 太陽の時系列（全受光面で共用）
+    o_s.run(n_tc, [&](std::size_t c) {
+      std::uint64_t k_0 = c * kTrkChunk;
+      struct timespec ts;
+      Track o_tr(kBdSun, spec.lat, spec.lng, eop);
+      ts.tv_sec  = spec.t_0.tv_sec + std::int64_t(k_0) * spec.step_ns / 1000000000;
+      ts.tv_nsec = std::int64_t(k_0) * spec.step_ns % 1000000000;
+      o_tr.run(ts, spec.step_ns, std::min<std::uint64_t>(kTrkChunk, n - k_0),
+               aa.data() + k_0);
+    });
+    o_k.set_sun(aa.data(), n);
+    std::vector<struct AltAz>().swap(aa);
+
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    if (opt.ly == kLyCsv) ok = o_out.write("surface,date,time,cos_aoi,rot\n", 30);
+    while (ok && u_done < n_u) {
+      std::uint64_t n_chk = std::min<std::uint64_t>(outs.size(), n_u - u_done);
+      o_s.run(n_chk, [&](std::size_t c) {
+        std::uint64_t u = u_done + c;
+        std::size_t j = u / n_tc;                    // 受光面番号
+        std::uint64_t k_0 = u % n_tc * kTrkChunk;    // 先頭の点番号
+        std::size_t m = std::min<std::uint64_t>(kTrkChunk, n - k_0);
+        std::vector<struct Poa> pa(m);
+        struct timespec ts;
+        Formatter o_fmt(-1, opt.ly);
+        o_k.run(sfs[j], k_0, m, pa.data());
+        for (std::size_t i = 0; i < m; ++i) {
+          std::int64_t ns = std::int64_t(k_0 + i) * spec.step_ns;
+          ts.tv_sec  = spec.t_0.tv_sec + ns / 1000000000;
+          ts.tv_nsec = ns % 1000000000;
+          put_poa(o_fmt, opt.ly, j, ts, n_frac, pa[i]);
+        }
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+      }
+      u_done += n_chk;
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n << " samples x " << sfs.size() << " surfaces"
+              << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      変換: 年月日(先発グレゴリオ暦) -> 1970年1月1日からの日数
+ *
+ * @param[in]  年（天文学的年: 紀元前 1 年 = 0） (int)
+ * @param[in]  月 (unsigned int)
+ * @param[in]  日 (unsigned int)
+ * @return     日数 (int64_t)
+ */
+static std::int64_t days_from_civil(int y, unsigned int m, unsigned int d) {
+  std::int64_t era;
+  unsigned int yoe;  // 400 年周期内の年
+  unsigned int doy;  // 3 月起算の年内日数
+  unsigned int doe;  // 400 年周期内の日数
+
+  y  -= m <= 2;
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = unsigned(y - era * 400);
+  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + std::int64_t(doe) - 719468;
+}
+
+/*
+ * @brief      実行: 月相一覧（FROM 年 〜 TO 年（JST, 両端を含む）の朔・上弦・望・下弦）
+ *             (kPhBlk 朔望月単位でワークスティーリングにより並列に計算・整形し、
+ *              時刻順に書き出す)
+ *
+ * @param[in]  開始年 (int)
+ * @param[in]  終了年 (int)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_phases(int y_0, int y_1, const BatchOpt& opt) {
+  static constexpr const char* kName[4] = {"new", "first", "full", "last"};
+  double u_0;                 // 範囲: 開始(UNIX 秒)
+  double u_1;                 // 範囲: 終了(UNIX 秒, 含まない)
+  std::int64_t k_0;           // 先頭の朔望月番号
+  std::uint64_t n;            // 朔望月数
+  std::uint64_t n_done = 0;   // 出力済み朔望月数
+  std::uint64_t n_ev = 0;     // 出力件数
+  bool ok = true;
+
+  try {
+    if (y_0 > y_1 || y_0 < -9999 || y_1 > 9999
+        || (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson)) {
+      std::cerr << "[ERROR] Invalid year range or format!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    u_0 = days_from_civil(y_0, 1, 1) * 86400.0 - 32400.0;
+    u_1 = days_from_civil(y_1 + 1, 1, 1) * 86400.0 - 32400.0;
+    // ΔT は最大でも数日程度のため、前後 1 朔望月ずつ余分に計算して範囲で絞る
+    k_0 = lunation_of((u_0 - 946728000.0) / 86400.0) - 1;
+    n   = lunation_of((u_1 - 946728000.0) / 86400.0) + 2 - k_0;
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(o_s.size() * 4);  // 整形結果（チャンク毎）
+    std::vector<std::uint64_t> cnts(outs.size());   // 出力件数（チャンク毎）
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    if (opt.ly == kLyCsv) ok = o_out.write("date,time,phase,delta_t\n", 24);
+    while (ok && n_done < n) {
+      std::uint64_t n_chk = std::min<std::uint64_t>(
+          outs.size(), (n - n_done + kPhBlk - 1) / kPhBlk);
+      o_s.run(n_chk, [&](std::size_t c) {
+        std::uint64_t l_0 = n_done + c * kPhBlk;  // 先頭の朔望月（k_0 からの番号）
+        std::size_t m = std::min<std::uint64_t>(kPhBlk, n - l_0);
+        std::vector<PhaseEv> evs(m * 4);
+        Formatter o_fmt(-1, opt.ly);
+        struct timespec ts;
+        find_phases(k_0 + std::int64_t(l_0), m, eop, evs.data());
+        cnts[c] = 0;
+        for (const PhaseEv& ev : evs) {
+          if (ev.unix < u_0 || ev.unix >= u_1) continue;
+          ts.tv_sec  = time_t(std::floor(ev.unix + 0.5));
+          ts.tv_nsec = 0;
+          if (opt.ly == kLyJson) o_fmt.put_str("{\"date\":\"");
+          o_fmt.put_date(ts.tv_sec, opt.ly == kLyJson ? '-' : '\0');
+          o_fmt.put_str(opt.ly == kLyJson ? "\",\"time\":\""
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_hms(ts);
+          o_fmt.put_str(opt.ly == kLyJson ? "\",\"phase\":\""
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_str(kName[ev.q]);
+          o_fmt.put_str(opt.ly == kLyJson ? "\",\"delta_t\":"
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_fixed(ev.dlt_t, 1);
+          o_fmt.put_str(opt.ly == kLyJson ? "}\n" : "\n");
+          ++cnts[c];
+        }
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+        n_ev += cnts[c];
+      }
+      n_done = std::min<std::uint64_t>(n, n_done + n_chk * kPhBlk);
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_ev << " phases" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      計算: 日付の ΔT（Calc と同じく JST 00:00:00 の 9 時間前の UTC で求める）
+ *
+ * @param[in]  時刻 (Time)
+ * @param[in]  JST 00:00:00 (time_t)
+ * @return     ΔT(秒) (float)
+ */
+static float calc_day_dlt_t(Time& o_tm, time_t jst) {
+  struct timespec utc = {jst - 32400, 0};
+
+  return o_tm.calc_dlt_t(utc, o_tm.get_utc_tai(utc), o_tm.get_dut1(utc));
+}
+
+/*
+ * @brief      実行: 暦ファイルの作成
+ *             (地点一覧 × 日付範囲の計算結果を、地点 → 日付 の順に固定長レコードで書き出す。
+ *              kAlmBlk 件単位でワークスティーリングにより並列に計算し、順に追記する。
+ *              一時ファイルに書き出してから置き換えるため、参照中のファイルは壊れない)
+ *
+ * @param[in]  地点一覧 (vector<AlmSite>)
+ * @param[in]  開始日(JST) (timespec)
+ * @param[in]  終了日(JST, 当日を含む) (timespec)
+ * @param[in]  出力指定 (BatchOpt, 出力先・スレッド数のみ使用)
+ * @return     終了コード (int)
+ */
+int run_almanac(const std::vector<AlmSite>& sites, const struct timespec& d_0,
+                const struct timespec& d_1, const BatchOpt& opt) {
+  AlmHead head = {};
+  std::vector<std::uint32_t> bkts;  // 索引
+  std::vector<AlmRec> recs;         // レコード（1 ブロック分）
+  std::string f_tmp = opt.f_out + ".tmp";  // 一時ファイル
+  std::uint64_t n;                  // 総レコード数
+  std::uint64_t k;
+  std::uint32_t b;
+  std::uint32_t i;
+  bool ok;
+
+  try {
+    if (opt.f_out == "-" || d_1.tv_sec < d_0.tv_sec) {
+      std::cerr << "[ERROR] Invalid date range or output file!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    // ヘッダ（JST は夏時間がないため日付は 86400 秒毎）
+    std::memcpy(head.magic, kAlmMagic, sizeof(kAlmMagic));
+    head.n_site   = sites.size();
+    head.n_day    = (d_1.tv_sec - d_0.tv_sec) / 86400 + 1;
+    head.day_0    = d_0.tv_sec;
+    head.n_bkt    = alm_bkt_size(head.n_site);
+    head.s_rec    = sizeof(AlmRec);
+    head.off_day  = sizeof(AlmHead);
+    head.off_site = head.off_day + sizeof(AlmDay) * head.n_day;
+    head.off_bkt  = head.off_site + sizeof(AlmSite) * head.n_site;
+    head.off_rec  = (head.off_bkt + sizeof(std::uint32_t) * head.n_bkt + 4095) / 4096 * 4096;
+    head.eop_ver  = eop->ver;
+    n = std::uint64_t(head.n_site) * head.n_day;
+    // 索引（線形探索のハッシュ表）
+    bkts.assign(head.n_bkt, 0);
+    for (i = 0; i < head.n_site; ++i) {
+      for (b = alm_hash(sites[i].id) & (head.n_bkt - 1); bkts[b] != 0;
+           b = (b + 1) & (head.n_bkt - 1)) {
+        if (std::strncmp(sites[bkts[b] - 1].id, sites[i].id, kAlmIdLen) == 0) {
+          std::cerr << "[ERROR] Duplicate site ID: " << sites[i].id << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+      bkts[b] = i + 1;
+    }
+    OutFile o_out;
+    if (!o_out.open(f_tmp)) return EXIT_FAILURE;
+    std::string pre(head.off_rec, '\0');  // ヘッダ 〜 索引（レコード位置までの詰め物を含む）
+    std::memcpy(&pre[0], &head, sizeof(head));
+    // 日付一覧（Calc と同じく JST 00:00:00 の 9 時間前で求めた ΔT）
+    Time o_tm(eop);
+    for (i = 0; i < head.n_day; ++i) {
+      AlmDay dy;
+      dy.dlt_t = calc_day_dlt_t(o_tm, head.day_0 + time_t(i) * 86400);
+      dy.drift = 0.0;
+      std::memcpy(&pre[head.off_day + sizeof(AlmDay) * i], &dy, sizeof(dy));
+    }
+    std::memcpy(&pre[head.off_site], sites.data(), sizeof(AlmSite) * head.n_site);
+    std::memcpy(&pre[head.off_bkt], bkts.data(), sizeof(std::uint32_t) * head.n_bkt);
+    ok = o_out.write(pre);
+    // レコード
+    recs.resize(kAlmBlk);
+    for (k = 0; ok && k < n; k += kAlmBlk) {
+      std::size_t m = std::min<std::uint64_t>(kAlmBlk, n - k);
+      o_s.run(m, [&](std::size_t j) {
+        const AlmSite& st = sites[(k + j) / head.n_day];
+        Query q;
+        q.jst.tv_sec  = head.day_0 + time_t((k + j) % head.n_day) * 86400;
+        q.jst.tv_nsec = 0;
+        q.lat = st.lat;
+        q.lng = st.lng;
+        q.ht  = st.ht;
+        Result res;
+        ResSt  rs;
+        // 計算できない件はレコードに保持できないため、作成を中止する
+        if (calc_all_st(q, eop, nullptr, res, rs) != kStOk) {
+          throw std::runtime_error(std::string("Calculation failed: ") + st.id);
+        }
+        to_rec(res, rs, q.jst.tv_sec, recs[j]);
+      });
+      ok = o_out.write(recs.data(), sizeof(AlmRec) * m);
+    }
+    ok = ok && o_out.sync();
+    o_out.close();
+    if (!ok || std::rename(f_tmp.c_str(), opt.f_out.c_str()) != 0) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      unlink(f_tmp.c_str());
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << head.n_site << " sites x " << head.n_day << " days, "
+              << n << " records" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 暦ファイルの部分再計算
+ *             (現行の EOP 一覧で各日の ΔT を求め、記録済みの値から変化した日のみ、
+ *              rec_stale で出力が変わり得ると判定したレコードを再計算してその場で
+ *              書き換える。地点単位でワークスティーリングにより並列に処理する。
+ *              再計算を省いたレコードが残る日は、ΔT の差の上限を drift に記録して
+ *              次回の判定に加える。出力（1 件 1 行形式）が変わったレコード数を報告する)
+ *
+ * @param[in]  暦ファイル名 (string)
+ * @param[in]  出力指定 (BatchOpt, スレッド数のみ使用)
+ * @return     終了コード (int)
+ */
+int run_almanac_update(const std::string& f, const BatchOpt& opt) {
+  Almanac o_alm;
+  std::vector<float>  dlts;   // 新しい ΔT（日毎）
+  std::vector<double> errs;   // ΔT の差の上限（日毎, 0: 変化なし）
+  std::uint64_t n_day = 0;    // ΔT が変化した日数
+  std::uint64_t n_calc = 0;   // 再計算したレコード数
+  std::uint64_t n_chg = 0;    // 出力が変わったレコード数
+  std::uint32_t d;
+
+  try {
+    if (!o_alm.open(f, true)) {
+      std::cerr << "[ERROR] Cannot open " << f << std::endl;
+      return EXIT_FAILURE;
+    }
+    const AlmHead& head = o_alm.get_head();
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Time o_tm(eop);
+    Sched o_s(opt.n_th);
+    dlts.resize(head.n_day);
+    errs.assign(head.n_day, 0.0);
+    for (d = 0; d < head.n_day; ++d) {
+      const AlmDay& dy = o_alm.get_day(d);
+      dlts[d] = calc_day_dlt_t(o_tm, head.day_0 + time_t(d) * 86400);
+      if (dlts[d] == dy.dlt_t) continue;
+      errs[d] = std::abs(double(dlts[d]) - dy.dlt_t) + dy.drift;
+      ++n_day;
+    }
+    if (n_day > 0) {
+      std::vector<std::uint64_t> calcs(head.n_site);  // 再計算したレコード数（地点毎）
+      std::vector<std::uint64_t> chgs(head.n_site);   // 出力が変わったレコード数（地点毎）
+      std::vector<std::atomic<bool>> skips(head.n_day);  // 再計算を省いたレコードがある日
+      for (auto& sk : skips) sk.store(false);
+      o_s.run(head.n_site, [&](std::size_t s) {
+        const AlmSite& st = o_alm.get_site(s);
+        Formatter o_fmt(-1, kLyLine);
+        AlmRec prv;   // 前日のレコード（更新前）
+        AlmRec cur;   // 当日のレコード（更新前）
+        Query  q;
+        Result res;
+        ResSt  rs;
+        q.lat = st.lat;
+        q.lng = st.lng;
+        q.ht  = st.ht;
+        q.jst.tv_nsec = 0;
+        for (std::uint32_t i = 0; i < head.n_day; prv = cur, ++i) {
+          cur = o_alm.get_rec(s, i);
+          if (errs[i] == 0.0) continue;
+          if (!rec_stale(st, cur, i > 0 ? &prv : nullptr,
+                         i + 1 < head.n_day ? &o_alm.get_rec(s, i + 1) : nullptr, errs[i])) {
+            skips[i].store(true, std::memory_order_relaxed);
+            continue;
+          }
+          q.jst.tv_sec = head.day_0 + time_t(i) * 86400;
+          // 変更前後の出力を比較
+          from_rec(cur, q.jst.tv_sec, res, rs);
+          res.eop_ver = eop->ver;
+          o_fmt.put(q, res, &rs);
+          std::string s_old = o_fmt.take();
+          if (calc_all_st(q, eop, nullptr, res, rs) != kStOk) {
+            throw std::runtime_error(std::string("Calculation failed: ") + st.id);
+          }
+          o_fmt.put(q, res, &rs);
+          if (o_fmt.take() != s_old) ++chgs[s];
+          to_rec(res, rs, q.jst.tv_sec, o_alm.get_rec(s, i));
+          ++calcs[s];
+        }
+      });
+      for (std::uint32_t s = 0; s < head.n_site; ++s) {
+        n_calc += calcs[s];
+        n_chg  += chgs[s];
+      }
+      for (d = 0; d < head.n_day; ++d) {
+        if (errs[d] == 0.0) continue;
+        AlmDay& dy = o_alm.get_day(d);
+        dy.dlt_t = dlts[d];
+        dy.drift = skips[d].load() ? errs[d] : 0.0;
+      }
+    }
+    o_alm.set_eop_ver(eop->ver);
+    if (!o_alm.sync()) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_day << " days affected, " << n_calc << " records recomputed, "
+              << n_chg << " records changed" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 期間内の出・入・南中
+ *             (期間を Search::kStep の倍数の位置で kSrchChunk 秒毎に区切り、
+ *              ワークスティーリングにより並列に探索・整形して時刻順に書き出す。
+ *              区切りは標本の位置と一致するため、分割しない場合と結果は同じ)
+ *
+ * @param[in]  範囲 (SearchSpec)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_search(const SearchSpec& spec, const BatchOpt& opt) {
+  static constexpr const char* kName[3] = {"rise", "set", "transit"};
+  time_t t_b;                 // 最初の区切り（開始時刻以下の kSrchChunk の倍数）
+  std::uint64_t n;            // 区切りの数
+  std::uint64_t n_done = 0;   // 出力済みの区切りの数
+  std::uint64_t n_ev = 0;     // 出力件数
+  bool ok = true;
+
+  try {
+    if (spec.t_1 <= spec.t_0 || spec.t_1 - spec.t_0 > 9000000000LL
+        || spec.lat < -90.0 || spec.lat > 90.0 || spec.ht < 0.0
+        || (opt.ly != kLyLine && opt.ly != kLyCsv && opt.ly != kLyJson)) {
+      std::cerr << "[ERROR] Invalid search range or format!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    t_b = spec.t_0 - ((spec.t_0 % kSrchChunk) + kSrchChunk) % kSrchChunk;
+    n   = (spec.t_1 - t_b + kSrchChunk - 1) / kSrchChunk;
+    Eop o_eop;
+    auto eop = o_eop.get();
+    Sched o_s(opt.n_th);
+    std::vector<std::string> outs(o_s.size() * 4);  // 整形結果（チャンク毎）
+    std::vector<std::uint64_t> cnts(outs.size());   // 出力件数（チャンク毎）
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    if (opt.ly == kLyCsv) ok = o_out.write("date,time,event,value\n", 22);
+    while (ok && n_done < n) {
+      std::uint64_t n_chk = std::min<std::uint64_t>(outs.size(), n - n_done);
+      o_s.run(n_chk, [&](std::size_t c) {
+        time_t u_0 = t_b + time_t(n_done + c) * kSrchChunk;
+        std::vector<Event> evs;
+        Search o_sr(spec.bd, spec.lat, spec.lng, spec.ht, eop);
+        Formatter o_fmt(-1, opt.ly);
+        o_sr.run(std::max(u_0, spec.t_0), std::min(u_0 + kSrchChunk, spec.t_1), evs);
+        for (const Event& e : evs) {
+          if (opt.ly == kLyJson) o_fmt.put_str("{\"date\":\"");
+          o_fmt.put_date(e.ev.time.tv_sec, opt.ly == kLyJson ? '-' : '\0');
+          o_fmt.put_str(opt.ly == kLyJson ? "\",\"time\":\""
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_hms(e.ev.time);
+          o_fmt.put_chr('.');
+          o_fmt.put_uint(e.ev.time.tv_nsec / 1000000, 3);
+          o_fmt.put_str(opt.ly == kLyJson ? "\",\"event\":\""
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_str(kName[e.kbn]);
+          o_fmt.put_str(opt.ly == kLyJson ? (e.kbn == 2 ? "\",\"alt\":" : "\",\"az\":")
+                      : opt.ly == kLyCsv ? "," : " ");
+          o_fmt.put_fixed(e.ev.ah, 4);
+          o_fmt.put_str(opt.ly == kLyJson ? "}\n" : "\n");
+        }
+        cnts[c] = evs.size();
+        outs[c] = o_fmt.take();
+      });
+      for (std::size_t c = 0; ok && c < n_chk; ++c) {
+        ok = o_out.write(outs[c]);
+        std::string().swap(outs[c]);
+        n_ev += cnts[c];
+      }
+      n_done += n_chk;
+    }
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << n_ev << " events" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 等高度線（GeoJSON）
+ *             (天体直下点を 1 回だけ計算し、各高度の等高度線を解析的に求める。
+ *              直下点の Point と、高度毎の MultiLineString を FeatureCollection で出力)
+ *
+ * @param[in]  天体 (Body)
+ * @param[in]  時刻 (timespec)
+ * @param[in]  高度一覧(度) (vector<double>)
+ * @param[in]  刻み(度) (double)
+ * @param[in]  出力指定 (BatchOpt)
+ * @return     終了コード (int)
+ */
+int run_contour(Body bd, const struct timespec& ts, const std::vector<double>& hts,
+                double step, const BatchOpt& opt) {
+  std::vector<Polyline> lines;  // 等高度線
+  struct SubPoint sp;           // 天体直下点
+  bool ok;
+
+  try {
+    if (step <= 0.0 || step > 90.0 || hts.empty()) {
+      std::cerr << "[ERROR] Invalid altitude or step!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    Track o_tr(bd, 0.0, 0.0, nullptr);
+    sp = o_tr.sub_point(ts);
+    OutFile o_out;
+    if (!o_out.open(opt.f_out)) return EXIT_FAILURE;
+    Formatter o_fmt(-1, kLyJson);
+    o_fmt.put_str("{\"type\":\"FeatureCollection\",\"features\":[\n");
+    o_fmt.put_str("{\"type\":\"Feature\",\"properties\":{\"kind\":\"subpoint\",\"body\":\"");
+    o_fmt.put_str(bd == kBdSun ? "sun" : "moon");
+    o_fmt.put_str("\",\"date\":\"");
+    o_fmt.put_date(ts.tv_sec, '-');
+    o_fmt.put_str("\",\"time\":\"");
+    o_fmt.put_hms(ts);
+    o_fmt.put_str("\"},\"geometry\":{\"type\":\"Point\",\"coordinates\":[");
+    o_fmt.put_fixed(sp.lng, 4);
+    o_fmt.put_chr(',');
+    o_fmt.put_fixed(sp.lat, 4);
+    o_fmt.put_str("]}}");
+    for (double ht : hts) {
+      calc_contour(sp, ht, step, lines);
+      o_fmt.put_str(",\n{\"type\":\"Feature\",\"properties\":{\"kind\":\"contour\",\"alt\":");
+      o_fmt.put_fixed(ht, 2);
+      o_fmt.put_str("},\"geometry\":{\"type\":\"MultiLineString\",\"coordinates\":[");
+      for (std::size_t l = 0; l < lines.size(); ++l) {
+        if (l > 0) o_fmt.put_chr(',');
+        o_fmt.put_chr('[');
+        for (std::size_t i = 0; i < lines[l].size(); ++i) {
+          if (i > 0) o_fmt.put_chr(',');
+          o_fmt.put_chr('[');
+          o_fmt.put_fixed(lines[l][i].lng, 4);
+          o_fmt.put_chr(',');
+          o_fmt.put_fixed(lines[l][i].lat, 4);
+          o_fmt.put_chr(']');
+        }
+        o_fmt.put_chr(']');
+      }
+      o_fmt.put_str("]}}");
+    }
+    o_fmt.put_str("\n]}\n");
+    std::string out = o_fmt.take();
+    ok = o_out.write(out);
+    o_out.close();
+    if (!ok) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace sun_moon
+
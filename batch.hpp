@@ -0,0 +1,51 @@
+#ifndef SUN_MOON_BATCH_HPP_
+#define SUN_MOON_BATCH_HPP_
+
+#include "almanac.hpp"
+#include "format.hpp"
+#include "grid.hpp"
+#include "horizon.hpp"
+#include "input.hpp"
+#include "poa.hpp"
+#include "search.hpp"
+#include "shard.hpp"
+#include "track.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 一括計算の出力指定
+struct BatchOpt {
+  Layout      ly;     // 出力形式
+  std::string f_out;  // 出力ファイル名（"-" は標準出力）
+  unsigned int n_th;  // 計算スレッド数（0: ハードウェアスレッド数）
+  ShardSpec   sh;     // 分割指定
+  bool        f_twi;  // 計算対象: 日の出／入・薄明等（false: 日・月の出・入・南中）
+  double      tol_ad; // 格子点の適応補間: 許容誤差(秒, 0: 全点を厳密に計算)
+  std::vector<InvTarget>   tgts;       // 逆算の対象（空: 逆算しない）
+  std::vector<std::string> tgt_names;  // 逆算の対象の名称
+  std::shared_ptr<const HorizonSet> hz;  // 地平線プロファイル（nullptr: 海面の地平線のみ）
+};
+
+int run_batch(Source&, const BatchOpt&);           // 実行: 一括計算
+int run_twilight(Source&, const BatchOpt&);        // 実行: 薄明等の一括計算
+int run_inverse(Source&, const BatchOpt&);         // 実行: 指定高度・方位角の時刻等の一括逆算
+int run_grid_adapt(Grid&, const BatchOpt&);        // 実行: 格子点の適応補間
+int run_track(const TrackSpec&, const BatchOpt&);  // 実行: 時系列出力
+int run_contour(Body, const struct timespec&, const std::vector<double>&, double,
+                const BatchOpt&);                  // 実行: 等高度線
+int run_phases(int, int, const BatchOpt&);         // 実行: 月相一覧
+int run_search(const SearchSpec&, const BatchOpt&);  // 実行: 期間内の出・入・南中
+int run_almanac(const std::vector<AlmSite>&, const struct timespec&, const struct timespec&,
+                const BatchOpt&);                  // 実行: 暦ファイルの作成
+int run_almanac_update(const std::string&, const BatchOpt&);  // 実行: 暦ファイルの部分再計算
+int run_poa(const TrackSpec&, const std::vector<Surface>&, const BatchOpt&);
+                                                   // 実行: 受光面の入射角
+
+}  // namespace sun_moon
+
+#endif
+
@@ -1,9 +1,12 @@
 #include "calc.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 namespace sun_moon {
 
 // 定数
-static constexpr unsigned int kJstUtc    = 9;                // JST - UTC (hours)
 static constexpr unsigned int kJstOffset = 32400;            // JST - UTC (secs)
 static constexpr unsigned int kSecDay    = 86400;            // Seconds inf a day (secs)
 static constexpr double       kDipCoef   = 0.0353333;        // 地平線伏角計算用係数
@@ -11,13 +14,44 @@ static constexpr double       kEps       = 0.5e-4;           // ループ処理
 static constexpr double       kPi        = atan(1.0) * 4.0;  // 円周率
 static constexpr double       kPi180     = kPi / 180.0;      // 円周率 / 180
 static constexpr double       kAstrRef   = 0.585556;         // 大気差(astro refract)
+static constexpr unsigned int kMaxIter   = 20;               // 通過時刻: 反復回数の上限
+static constexpr unsigned int kMaxIterEv = 1000;             // 出・入・南中時刻: 反復回数の上限（軽量版と同じ）
+static constexpr double       kTmNone    = -1.0;             // 出・入・南中時刻: 該当しない場合の値
+static constexpr double       kTmNoConv  = -2.0;             // 出・入・南中時刻: 収束しない場合の値
+static constexpr double       kSynMonth  = 29.530589;        // 平均朔望月(日)
+static constexpr double       kAuKm      = 149597870.7;      // 天文単位(km)
+static constexpr double       kEarthR    = 6378.14;          // 地球赤道半径(km)
+static constexpr double       kTrnEdge   = 0.485;            // 日南中: 直接計算する平均南中時刻の範囲(0.5 ± 日)
+static constexpr unsigned int kNdSun     = 3;                // 逆算: 太陽の節点数(0, 12, 24 時)
+static constexpr unsigned int kNdMoon    = 5;                // 逆算: 月の節点数(6 時間毎)
+static constexpr double       kHaRate[2] = {360.0, 347.8};   // 逆算: 時角の変化率(度/日, 太陽・月)
+static constexpr double       kDtInv     = 1.0e-4;           // 逆算: 数値微分の刻み(日)
+static constexpr double       kRefBnt0   = 7.31 / 4.4;       // 地平線: Bennett の大気差の式の 0° での角(度)
+static constexpr double       kHzDtMin   = 1.0e-5;           // 地平線: 探索の刻みの下限(日)
+static constexpr double       kHzDtMax   = 1.0 / 96.0;       // 地平線: 探索の刻みの上限(日)
+static constexpr double       kHzTol     = 1.0e-6;           // 地平線: 時刻の許容誤差(日)
+static constexpr double       kHzAzStep  = 0.25;             // 地平線: 1 刻みの方位角の変化の下限(度)
+static constexpr unsigned int kHzMaxIter = 2000;             // 地平線: 探索の回数の上限
 
 /*
  * @brief  コンストラクタ
  *
  * @param  none
  */
-Calc::Calc(struct timespec jst, double lat, double lng, double ht) {
+Calc::Calc(struct timespec jst, double lat, double lng, double ht)
+    : Calc(jst, lat, lng, ht, nullptr) {}
+
+/*
+ * @brief      コンストラクタ（EOP 一覧指定）
+ *
+ * @param[in]  JST (timespec)
+ * @param[in]  緯度 (double)
+ * @param[in]  経度 (double)
+ * @param[in]  標高 (double)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ */
+Calc::Calc(struct timespec jst, double lat, double lng, double ht,
+           std::shared_ptr<const EopTable> eop) {
   struct timespec utc;  // UTC
   double dut1;          // DUT1
   int    utc_tai;       // UTC - TAI (協定世界時と国際原子時の差 = うるう秒の総和)
@@ -32,54 +66,30 @@ Calc::Calc(struct timespec jst, double lat, double lng, double ht) {
     utc.tv_sec  = jst.tv_sec - kJstOffset;
     utc.tv_nsec = 0;
     // 初期処理
-    Time o_tm;
+    Time o_tm(eop);
     utc_tai = o_tm.get_utc_tai(utc);
     dut1    = o_tm.get_dut1(utc);
     dlt_t   = o_tm.calc_dlt_t(utc, utc_tai, dut1);
     this->dlt_t_d = dlt_t / kSecDay;
     this->dip     = kDipCoef * std::sqrt(ht_o);
-    this->day_p   = calc_day_progress();
+    this->sin_lat = std::sin(kPi180 * lat_o);
+    this->cos_lat = std::cos(kPi180 * lat_o);
+    this->day_p   = day_progress(jst.tv_sec);
+    this->eop_ver = o_tm.get_eop_ver();
+    this->f_mt    = false;
+    this->f_eop   = utc_tai != 0;
+    this->st      = kEvOk;
+    this->hz      = nullptr;
+    this->f_nd[0] = false;
+    this->f_nd[1] = false;
   } catch (...) {
     throw;
   }
 }
 
-/*
- * @brief   計算: 2000年1月1日力学時正午からの経過日数
- *
- * @param   none
- * @return  経過日数 (double)
- */
-double Calc::calc_day_progress() {
-  struct tm    t;
-  int          y;
-  unsigned int m;
-  unsigned int d;
-  double       day_p;
-
-  try {
-    localtime_r(&jst.tv_sec, &t);
-    y = t.tm_year + 1900 - 2000;
-    m = t.tm_mon + 1;
-    d = t.tm_mday;
-    // 1月,2月は前年の13月,14月とする
-    if (m < 3) {
-      --y;
-      m += 12;
-    }
-    day_p = 365.0 * y + 30.0 * m + d
-          - 33.5 - kJstUtc / 24.0
-          + int(3 * (m + 1) / 5.0)
-          + int(y / 4.0);
-  } catch (...) {
-    throw;
-  }
-
-  return day_p;
-}
-
 /*
  * @brief      計算: 日の出／入
+ *             (地平線プロファイルを設定した場合、出入はプロファイル上の出入（calc_time_mask）)
  *
  * @param[in]  区分(0: 日の出, 1: 日の入, 2: 日の南中) (unsigned int)
  * @return     日の出／入／南中の時刻と方位角／南中高度 (struct TmAh)
@@ -92,7 +102,21 @@ struct TmAh Calc::calc_sun(unsigned int kbn) {
   struct TmAh sun;
 
   try {
-    dd = calc_time_sun(kbn);
+    st = kEvOk;
+    if (kbn == 2) {
+      dd = calc_transit_sun();
+    } else if (hz_on()) {
+      dd = calc_time_mask(0, kbn);
+      if (dd < 0.0) dd = kTmNone;
+    } else {
+      dd = calc_time_sun(kbn);
+    }
+    // 出入がない（白夜・極夜, 地平線プロファイル上に出ない）・収束しない場合は
+    // 月の出入がない日と同じ扱い（反復の収束先が前日の時刻(負)の場合は従来どおり出力）
+    if (dd == kTmNone || dd == kTmNoConv) {
+      st = dd == kTmNoConv ? kEvNoConv : kEvNone;
+      return {{0, 0}, -1.0};
+    }
     dd_s = dd * kSecDay;
     sun.time.tv_sec  = jst.tv_sec + int(dd_s);
     sun.time.tv_nsec = jst.tv_nsec + (dd_s - int(dd_s)) * 1.0e9;
@@ -101,7 +125,7 @@ struct TmAh Calc::calc_sun(unsigned int kbn) {
       ++sun.time.tv_sec;
     };
     jy   = (day_p + dd + dlt_t_d) / 365.25;
-    cd_k = {0.0, calc_lmd_sun(jy)};
+    cd_k = {0.0, lmd_sun(jy)};
     if (kbn == 2) {
       sun.ah = calc_height(cd_k, dd, jy);
     } else {
@@ -116,6 +140,7 @@ struct TmAh Calc::calc_sun(unsigned int kbn) {
 
 /*
  * @brief      計算: 月の出／入
+ *             (地平線プロファイルを設定した場合、出入はプロファイル上の出入（calc_time_mask）)
  *
  * @param[in]  区分(0: 月の出, 1: 月の入, 2: 月の南中) (unsigned int)
  * @return     月の出／入／南中の時刻と方位角／南中高度 (struct TmAh)
@@ -128,10 +153,11 @@ struct TmAh Calc::calc_moon(unsigned int kbn) {
   struct TmAh moon;
 
   try {
-    dd = calc_time_moon(kbn);
+    dd = kbn != 2 && hz_on() ? calc_time_mask(1, kbn) : calc_time_moon(kbn);
     dd_s = dd * kSecDay;
+    st   = dd < 0.0 ? (dd == kTmNoConv ? kEvNoConv : kEvNone) : kEvOk;
     if (dd < 0.0) {
-      // 月の出／入がない場合
+      // 月の出／入がない（収束しない場合を含む）場合
       moon.time = {0, 0};
       moon.ah = -1.0;
     } else {
@@ -142,8 +168,12 @@ struct TmAh Calc::calc_moon(unsigned int kbn) {
         ++moon.time.tv_sec;
       };
       jy   = (day_p + dd + dlt_t_d) / 365.25;
-      cd_k = {calc_bet_moon(jy), calc_lmd_moon(jy)};
+      cd_k = {bet_moon(jy), lmd_moon(jy)};
       if (kbn == 2) {
+        // 位相の計算用に保持
+        f_mt  = true;
+        jy_mt = jy;
+        cd_mt = cd_k;
         moon.ah = calc_height(cd_k, dd, jy);
       } else {
         moon.ah = calc_angle(cd_k, dd, jy);
@@ -156,11 +186,325 @@ struct TmAh Calc::calc_moon(unsigned int kbn) {
   return moon;
 }
 
+/*
+ * @brief      計算: 月の位相
+ *             (月南中の計算で求めた月の黄経・黄緯を再利用し、同時刻の太陽の黄経・距離、
+ *              月の視差のみ追加で計算する。南中がない日は正午で計算する)
+ *
+ * @param      none
+ * @return     位相角・輝面比・月齢・明縁の位置角 (struct MoonPhase)
+ */
+struct MoonPhase Calc::calc_phase() {
+  double jy;         // 経過ユリウス年
+  Coord  cd_k;       // 月: 黄道座標
+  Coord  cd_sm;      // 月: 赤道座標
+  Coord  cd_ss;      // 太陽: 赤道座標
+  double lmd_s;      // 太陽: 黄経
+  double r_s;        // 太陽: 距離(km)
+  double r_m;        // 月: 距離(km)
+  double elg;        // 離角
+  double da;         // 赤経差（太陽 - 月）
+  struct MoonPhase ph;
+
+  try {
+    if (f_mt) {
+      jy   = jy_mt;
+      cd_k = cd_mt;
+    } else {
+      jy   = (day_p + 0.5 + dlt_t_d) / 365.25;
+      cd_k = {bet_moon(jy), lmd_moon(jy)};
+    }
+    lmd_s = lmd_sun(jy);
+    r_s   = dist_sun(jy) * kAuKm;
+    r_m   = kEarthR / std::sin(kPi180 * diff_moon(jy));
+    // 月齢（黄経差を平均朔望月で換算）
+    elg = norm_ang(cd_k.lng - lmd_s);
+    if (elg < 0.0) elg += 360.0;
+    ph.age = elg / 360.0 * kSynMonth;
+    // 離角 -> 位相角（太陽 - 月 - 地球のなす角）・輝面比
+    elg = std::acos(std::cos(kPi180 * cd_k.lat)
+                  * std::cos(kPi180 * (cd_k.lng - lmd_s)));
+    ph.ph_ang = std::atan2(r_s * std::sin(elg), r_m - r_s * std::cos(elg)) / kPi180;
+    ph.illum  = (1.0 + std::cos(kPi180 * ph.ph_ang)) / 2.0;
+    // 明縁の位置角
+    cd_sm = ko2se(jy, cd_k);
+    cd_ss = ko2se(jy, {0.0, lmd_s});
+    da    = kPi180 * (cd_ss.lng - cd_sm.lng);
+    ph.limb = std::atan2(
+        std::cos(kPi180 * cd_ss.lat) * std::sin(da),
+        std::sin(kPi180 * cd_ss.lat) * std::cos(kPi180 * cd_sm.lat)
+      - std::cos(kPi180 * cd_ss.lat) * std::sin(kPi180 * cd_sm.lat) * std::cos(da))
+      / kPi180;
+    if (ph.limb < 0.0) ph.limb += 360.0;
+  } catch (...) {
+    throw;
+  }
+
+  return ph;
+}
+
+/*
+ * @brief      補間: 節点(0.0, 0.5, 1.0 日)の値から時刻 tm の値（2 次の Lagrange 補間）
+ *
+ * @param[in]  節点の値 (double[3])
+ * @param[in]  時刻(日) (double)
+ * @return     補間値 (double)
+ */
+static double interp3(const double* v, double tm) {
+  return v[0] * (2.0 * tm - 1.0) * (tm - 1.0)
+       - v[1] * 4.0 * tm * (tm - 1.0)
+       + v[2] * tm * (2.0 * tm - 1.0);
+}
+
+/*
+ * @brief       計算: 日の出／入と指定高度の通過（一括）
+ *              (太陽の位置（黄経・距離 -> 赤道座標）は 0 時・12 時・24 時の 3 回のみ
+ *               計算し、その間は 2 次補間する（1 日での誤差は 1e-5° 程度）。
+ *               日の出／入を 12 時から解いた後、各高度は直前に解いた高度の通過時刻
+ *               から反復を始めるため、高度毎の反復は 1〜2 回で収束する)
+ *
+ * @param[in]   高度(太陽中心の幾何学的高度, 度) (double[n])
+ * @param[in]   高度数 n (unsigned int)
+ * @param[out]  通過 (SunCross[n + 1], 0: 日の出／入, 1〜n: 指定高度)
+ * @return      none
+ */
+void Calc::calc_sun_cross(const double* hts, unsigned int n, struct SunCross* out) {
+  double ra[3];              // 節点: 赤経
+  double dc[3];              // 節点: 赤緯
+  double ds[3];              // 節点: 距離
+  Coord  cd_k = {0.0, 0.0};  // 黄道座標
+  Coord  cd_s;               // 赤道座標
+  double jy;                 // 経過ユリウス年
+  double dist;               // 太陽: 距離
+  double ht;                 // 高度
+  double tm[2] = {0.5, 0.5}; // 直前に解いた通過時刻（朝・夕, 反復の初期値）
+  double dd;                 // 通過時刻(日)
+  double dd_s;               // 通過時刻(秒)
+  struct TmAh* p;
+  unsigned int i;
+  unsigned int kbn;
+
+  try {
+    for (i = 0; i < 3; ++i) {
+      jy       = (day_p + 0.5 * i + dlt_t_d) / 365.25;
+      cd_k.lng = lmd_sun(jy);
+      cd_s     = ko2se(jy, cd_k);
+      ra[i]    = cd_s.lng;
+      dc[i]    = cd_s.lat;
+      ds[i]    = dist_sun(jy);
+    }
+    // 赤経の 0°/360° 境界をまたぐ場合は連続にする
+    for (i = 1; i < 3; ++i) {
+      if (ra[i] - ra[i - 1] < -180.0) ra[i] += 360.0;
+    }
+    for (i = 0; i <= n; ++i) {
+      if (i == 0) {
+        dist = interp3(ds, 0.5);
+        ht   = -0.266994 / dist - kAstrRef - dip + 0.0024428 / dist;  // 出入高度
+      } else {
+        ht   = hts[i - 1];
+      }
+      for (kbn = 0; kbn < 2; ++kbn) {
+        p  = kbn == 0 ? &out[i].am : &out[i].pm;
+        dd = calc_time_cross(ra, dc, ht, tm[kbn], kbn);
+        if (dd < 0.0) {
+          p->time = {0, 0};
+          p->ah   = -1.0;
+          continue;
+        }
+        tm[kbn] = dd;
+        dd_s = dd * kSecDay;
+        p->time.tv_sec  = jst.tv_sec + int(dd_s);
+        p->time.tv_nsec = jst.tv_nsec + (dd_s - int(dd_s)) * 1.0e9;
+        if (p->time.tv_nsec >= 1.0e9) {
+          p->time.tv_nsec -= 1.0e9;
+          ++p->time.tv_sec;
+        }
+        cd_s.lng = interp3(ra, dd);
+        cd_s.lat = interp3(dc, dd);
+        jy    = (day_p + dd + dlt_t_d) / 365.25;
+        p->ah = calc_azimuth(cd_s, tm_sidereal(jy, dd));
+      }
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      補間: 等間隔の節点(0.0 〜 1.0 日, n 点)の値から時刻 tm の値（Lagrange 補間）
+ *
+ * @param[in]  節点の値 (double[n])
+ * @param[in]  節点数 n (3 または 5) (unsigned int)
+ * @param[in]  時刻(日) (double)
+ * @return     補間値 (double)
+ */
+static double interp_nd(const double* v, unsigned int n, double tm) {
+  double x = (n - 1) * tm;  // 節点番号単位の時刻
+  double v_t = 0.0;
+  double l;
+  unsigned int j;
+  unsigned int k;
+
+  if (n == 3) return interp3(v, tm);
+  for (k = 0; k < n; ++k) {
+    l = v[k];
+    for (j = 0; j < n; ++j) {
+      if (j != k) l *= (x - j) / (double(k) - j);
+    }
+    v_t += l;
+  }
+
+  return v_t;
+}
+
+/*
+ * @brief      変換: 当日 0 時からの経過日数 -> 時刻（日付をまたぐ値も可）
+ *
+ * @param[in]  当日 0 時 (timespec)
+ * @param[in]  経過日数 (double)
+ * @return     時刻 (timespec)
+ */
+static struct timespec day_to_ts(const struct timespec& jst, double dd) {
+  double dd_s = dd * kSecDay;        // 経過秒
+  double sec  = std::floor(dd_s);  // 経過秒（整数部）
+  struct timespec ts;
+
+  ts.tv_sec  = jst.tv_sec + time_t(sec);
+  ts.tv_nsec = jst.tv_nsec + long((dd_s - sec) * 1.0e9);
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_nsec -= 1000000000L;
+    ++ts.tv_sec;
+  }
+
+  return ts;
+}
+
+/*
+ * @brief       計算: 指定高度・方位角の時刻等の逆算（一括）
+ *              (天体の位置は天体毎に 1 日分の節点（太陽 3 点, 月 5 点）だけ計算して
+ *               全対象で共用し、その間は補間する（calc_sun_cross と同じ）。
+ *               各対象は、同じ天体・区分で直前に解いた時刻から反復を始めるため、
+ *               近い値の対象を続けて指定すると反復は 1〜2 回で収束する。
+ *               日南中の前後は calc_sun と同じ南中時刻を起点に、その時刻の太陽の位置を
+ *               直接計算する)
+ *
+ * @param[in]   対象 (InvTarget[n])
+ * @param[in]   対象数 n (unsigned int)
+ * @param[out]  結果 (InvRes[n])
+ * @return      none
+ */
+void Calc::calc_inverse(const struct InvTarget* tgs, unsigned int n, struct InvRes* out) {
+  double tm_w[2][2][2];       // 直前に解いた時刻（天体, 高度／方位角, 区分）
+  double tm_t = -1.0;         // 日南中の時刻(日, 未計算は負)
+  unsigned int n_nd;          // 節点数
+  double dd;                  // 時刻(日)
+  double jy;                  // 経過ユリウス年
+  double tm_sd;               // 恒星時
+  double v;                   // 方位角または高度
+  Coord  cd_s;                // 赤道座標
+  unsigned int i;
+  unsigned int kbn;
+
+  try {
+    std::fill(&tm_w[0][0][0], &tm_w[0][0][0] + 8, 0.5);
+    for (i = 0; i < n; ++i) {
+      const struct InvTarget& tg = tgs[i];
+      struct InvRes& r = out[i];
+      r.ev[0].f = r.ev[1].f = false;
+      if (tg.kd == kInvNoon) {
+        if (tm_t < 0.0) tm_t = calc_transit_sun();
+        dd   = tm_t + tg.val / 24.0;
+        jy   = (day_p + dd + dlt_t_d) / 365.25;
+        cd_s = ko2se(jy, {0.0, lmd_sun(jy)});
+        r.ev[0] = {true, day_to_ts(jst, dd), calc_alt_geo(cd_s, tm_sidereal(jy, dd))};
+        continue;
+      }
+      n_nd = tg.bd == 0 ? kNdSun : kNdMoon;
+      if (!f_nd[tg.bd]) calc_nodes(tg.bd);
+      for (kbn = 0; kbn < 2; ++kbn) {
+        double& tm_0 = tm_w[tg.bd][tg.kd][kbn];
+        dd = calc_time_inv(tg, tm_0, kbn);
+        if (dd < 0.0) continue;
+        jy       = (day_p + dd + dlt_t_d) / 365.25;
+        cd_s.lng = norm_ang(interp_nd(nd_ra[tg.bd], n_nd, dd));
+        cd_s.lat = interp_nd(nd_dc[tg.bd], n_nd, dd);
+        tm_sd    = tm_sidereal(jy, dd);
+        if (tg.kd == kInvAz) {
+          // 反対の方位(+180 度)で解けた根は除く
+          if (std::abs(std::remainder(calc_azimuth(cd_s, tm_sd) - tg.val, 360.0)) > 90.0) {
+            continue;
+          }
+          v = calc_alt_geo(cd_s, tm_sd);
+          if (tg.bd == 1) {
+            // 地心高度 -> 測心高度（h' = h - π cos h' を 1 回代入で解く）
+            double p = interp_nd(nd_px, n_nd, dd);
+            v -= p * std::cos(kPi180 * (v - p * std::cos(kPi180 * v)));
+          }
+        } else {
+          v = calc_azimuth(cd_s, tm_sd);
+        }
+        tm_0 = dd;
+        r.ev[kbn] = {true, day_to_ts(jst, dd), v};
+      }
+      // 方位角は時刻順に詰める
+      if (tg.kd == kInvAz && r.ev[1].f
+          && (!r.ev[0].f || r.ev[1].time.tv_sec < r.ev[0].time.tv_sec
+              || (r.ev[1].time.tv_sec == r.ev[0].time.tv_sec
+                  && r.ev[1].time.tv_nsec < r.ev[0].time.tv_nsec))) {
+        std::swap(r.ev[0], r.ev[1]);
+      }
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief       計算: 節点（0 時 〜 24 時の等間隔）の赤経・赤緯・視差（逆算・地平線用）
+ *              (赤経は 0°/360° 境界をまたぐ場合も連続にする。太陽は 12 時の距離も求める)
+ *
+ * @param[in]   天体(0: 太陽, 1: 月) (unsigned int)
+ * @return      none
+ */
+void Calc::calc_nodes(unsigned int bd) {
+  unsigned int n_nd = bd == 0 ? kNdSun : kNdMoon;  // 節点数
+  double* ra = nd_ra[bd];    // 赤経
+  double* dc = nd_dc[bd];    // 赤緯
+  double jy;                 // 経過ユリウス年
+  Coord  cd_k = {0.0, 0.0};  // 黄道座標
+  Coord  cd_s;               // 赤道座標
+  unsigned int i;
+
+  try {
+    for (i = 0; i < n_nd; ++i) {
+      jy = (day_p + double(i) / (n_nd - 1) + dlt_t_d) / 365.25;
+      if (bd == 0) {
+        cd_k.lng = lmd_sun(jy);
+        if (2 * i == n_nd - 1) nd_dist = dist_sun(jy);
+      } else {
+        cd_k     = {bet_moon(jy), lmd_moon(jy)};
+        nd_px[i] = diff_moon(jy);
+      }
+      cd_s  = ko2se(jy, cd_k);
+      ra[i] = cd_s.lng;
+      dc[i] = cd_s.lat;
+    }
+    for (i = 1; i < n_nd; ++i) {
+      while (ra[i] - ra[i - 1] < -180.0) ra[i] += 360.0;
+      while (ra[i] - ra[i - 1] >  180.0) ra[i] -= 360.0;
+    }
+    f_nd[bd] = true;
+  } catch (...) {
+    throw;
+  }
+}
+
 /*
  * @brief      計算: 日の出・入・南中時刻
  *
  * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
- * @return     時刻(日) (double)
+ * @return     時刻(日, 出入高度に達しない場合は kTmNone, 収束しない場合は kTmNoConv) (double)
  */
 double Calc::calc_time_sun(unsigned int kbn) {
   double jy;                // 経過ユリウス年
@@ -174,18 +518,21 @@ double Calc::calc_time_sun(unsigned int kbn) {
   double hang_diff;         // 時角差
   Coord cd_k = {0.0, 0.0};  // 黄道座標
   Coord cd_s = {0.0, 0.0};  // 赤道座標
+  unsigned int n_it = 0;    // 反復回数
 
   try {
     while (std::abs(rev) > kEps) {
+      if (++n_it > kMaxIterEv) return kTmNoConv;
       jy        = (day_p + tm + dlt_t_d) / 365.25;      // tm の経過ユリウス年
-      cd_k.lng  = calc_lmd_sun(jy);                     // 太陽の黄経
-      dist      = calc_dist_sun(jy);                    // 太陽の距離
+      cd_k.lng  = lmd_sun(jy);                     // 太陽の黄経
+      dist      = dist_sun(jy);                    // 太陽の距離
       cd_s      = ko2se(jy, cd_k);                      // 黄道 -> 赤道変換
       r         = 0.266994 / dist;                      // 太陽の視半径
       diff      = 0.0024428 / dist;                     // 太陽の視差
       ht        = -r - kAstrRef - dip + diff;           // 太陽の出入高度
       tm_sd     = tm_sidereal(jy, tm);                  // 恒星時
       hang_diff = hour_ang_diff(cd_s, tm_sd, ht, kbn);  // 時角差
+      if (std::isnan(hang_diff)) return kTmNone;        // 白夜・極夜
       rev       = hang_diff / 360.0;                    // 仮定時刻に対する補正値
       tm       += rev;
     }
@@ -196,11 +543,50 @@ double Calc::calc_time_sun(unsigned int kbn) {
   return tm;
 }
 
+/*
+ * @brief      計算: 日の南中時刻（平均南中時刻から直接）
+ *             (経度のみから求めた平均南中時刻で太陽の赤経と恒星時を求め、時角から
+ *              南中時刻を直接求めた後、同じ計算で 1 回だけ補正する。
+ *              時角の変化率は 360.9856 - 赤経の変化率(0.9〜1.12 度/日) で、360 との比の
+ *              ずれは 3.5e-4 以下のため、均時差(最大 0.0115 日)の誤差は 1 回目で 4.0e-6 日
+ *              (0.35 秒)、補正後は 1.4e-9 日(0.12 ミリ秒)以下となる（同じ式の根に対して。
+ *              反復(calc_time_sun)の収束判定による誤差は 1.5 ミリ秒以下）。
+ *              平均南中時刻が日付の境界付近（0.5 ± kTrnEdge 日の外, 経度 -50.4〜-39.6 度）の
+ *              場合は、どちらの日の南中を返すかを反復と揃えるため calc_time_sun で求める)
+ *
+ * @param      none
+ * @return     時刻(日) (double)
+ */
+double Calc::calc_transit_sun() {
+  double jy;                // 経過ユリウス年
+  double tm;                // 時刻(日)
+  Coord cd_k = {0.0, 0.0};  // 黄道座標
+  Coord cd_s;               // 赤道座標
+  unsigned int i;
+
+  try {
+    // 平均南中時刻（JST 正午に最も近いもの）
+    tm = (135.0 - lng_o) / 360.0;
+    tm = 0.5 + tm - std::floor(tm + 0.5);
+    if (std::abs(tm - 0.5) > kTrnEdge) return calc_time_sun(2);
+    for (i = 0; i < 2; ++i) {
+      jy       = (day_p + tm + dlt_t_d) / 365.25;  // tm の経過ユリウス年
+      cd_k.lng = lmd_sun(jy);                      // 太陽の黄経
+      cd_s     = ko2se(jy, cd_k);                  // 黄道 -> 赤道変換
+      tm      += hour_ang_diff(cd_s, tm_sidereal(jy, tm), 0.0, 2) / 360.0;
+    }
+  } catch (...) {
+    throw;
+  }
+
+  return tm;
+}
+
 /*
  * @brief      計算: 月の出・入・南中時刻
  *
  * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
- * @return     時刻(日) (double)
+ * @return     時刻(日, 当日中にない場合は kTmNone, 収束しない場合は kTmNoConv) (double)
  */
 double Calc::calc_time_moon(unsigned int kbn) {
   double jy;                // 経過ユリウス年
@@ -212,25 +598,28 @@ double Calc::calc_time_moon(unsigned int kbn) {
   double hang_diff;         // 時角差
   Coord cd_k = {0.0, 0.0};  // 黄道座標
   Coord cd_s = {0.0, 0.0};  // 赤道座標
+  unsigned int n_it = 0;    // 反復回数
 
   try {
     while (std::abs(rev) > kEps) {
+      if (++n_it > kMaxIterEv) return kTmNoConv;
       jy = (day_p + tm + dlt_t_d) / 365.25;             // tm の経過ユリウス年
-      cd_k.lng = calc_lmd_moon(jy);                     // 月の黄経
-      cd_k.lat = calc_bet_moon(jy);                     // 月の黄緯
+      cd_k.lng = lmd_moon(jy);                     // 月の黄経
+      cd_k.lat = bet_moon(jy);                     // 月の黄緯
       cd_s = ko2se(jy, cd_k);                           // 黄道 -> 赤道変換
       // 南中の時は計算しない
       if (kbn != 2) {
-        diff = calc_diff_moon(jy);                      // 月の視差
+        diff = diff_moon(jy);                      // 月の視差
         ht   = diff - dip - kAstrRef;                   // 月の出入高度
       }
       tm_sd     = tm_sidereal(jy, tm);                  // 恒星時
       hang_diff = hour_ang_diff(cd_s, tm_sd, ht, kbn);  // 時角差
+      if (std::isnan(hang_diff)) return kTmNone;        // 出入高度に達しない
       rev       = hang_diff / 347.8;                    // 仮定時刻に対する補正値
       tm       += rev;
     }
     // 月の出／入がない場合は -1.0 とする
-    if (tm < 0.0 || tm >= 1.0) { tm = -1.0; }
+    if (tm < 0.0 || tm >= 1.0) { tm = kTmNone; }
   } catch (...) {
     throw;
   }
@@ -239,285 +628,287 @@ double Calc::calc_time_moon(unsigned int kbn) {
 }
 
 /*
- * @brief      計算: 太陽の黄経
+ * @brief      計算: 指定高度の通過時刻
+ *             (calc_time_sun と同じ反復だが、太陽の赤道座標は節点からの補間値を使う)
  *
- * @param[in]  経過ユリウス年 (double)
- * @return     黄経 (double)
+ * @param[in]  節点の赤経 (double[3])
+ * @param[in]  節点の赤緯 (double[3])
+ * @param[in]  高度(度) (double)
+ * @param[in]  反復の初期時刻(日) (double)
+ * @param[in]  区分(0: 朝, 1: 夕) (unsigned int)
+ * @return     時刻(日, 当日中に通過しない場合は -1.0) (double)
  */
-double Calc::calc_lmd_sun(double jy) {
-  double lmd;
+double Calc::calc_time_cross(const double* ra, const double* dc, double ht,
+                             double tm, unsigned int kbn) {
+  double jy;                // 経過ユリウス年
+  double rev = 1.0;         // 補正値
+  double hang_diff;         // 時角差
+  Coord cd_s = {0.0, 0.0};  // 赤道座標
+  unsigned int n_it = 0;    // 反復回数
 
   try {
-    lmd = 0.0003 * std::sin(kPi180 * norm_ang(329.7  +   44.43  * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(352.5  + 1079.97  * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang( 21.1  +  720.02  * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(157.3  +  299.30  * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(234.9  +  315.56  * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(291.2  +   22.81  * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(207.4  +    1.50  * jy))
-        + 0.0006 * std::sin(kPi180 * norm_ang( 29.8  +  337.18  * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(206.8  +   30.35  * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(153.3  +   90.38  * jy))
-        + 0.0008 * std::sin(kPi180 * norm_ang(132.5  +  659.29  * jy))
-        + 0.0013 * std::sin(kPi180 * norm_ang( 81.4  +  225.18  * jy))
-        + 0.0015 * std::sin(kPi180 * norm_ang(343.2  +  450.37  * jy))
-        + 0.0018 * std::sin(kPi180 * norm_ang(251.3  +    0.20  * jy))
-        + 0.0018 * std::sin(kPi180 * norm_ang(297.8  + 4452.67  * jy))
-        + 0.0020 * std::sin(kPi180 * norm_ang(247.1  +  329.64  * jy))
-        + 0.0048 * std::sin(kPi180 * norm_ang(234.95 +   19.341 * jy))
-        + 0.0200 * std::sin(kPi180 * norm_ang(355.05 +  719.981 * jy))
-        + (1.9146 - 0.00005 * jy)
-        * std::sin(kPi180 * norm_ang(357.538 + 359.991 * jy))
-        + norm_ang(280.4603 + 360.00769 * jy);
+    while (std::abs(rev) > kEps) {
+      // 高度に達しない（白夜・極夜等）または収束しない場合は通過なし
+      if (++n_it > kMaxIter) return -1.0;
+      jy        = (day_p + tm + dlt_t_d) / 365.25;      // tm の経過ユリウス年
+      cd_s.lng  = norm_ang(interp3(ra, tm));            // 太陽の赤経
+      cd_s.lat  = interp3(dc, tm);                      // 太陽の赤緯
+      hang_diff = hour_ang_diff(cd_s, tm_sidereal(jy, tm), ht, kbn);
+      if (std::isnan(hang_diff)) return -1.0;
+      rev       = hang_diff / 360.0;                    // 仮定時刻に対する補正値
+      tm       += rev;
+    }
+    if (tm < 0.0 || tm >= 1.0) { tm = -1.0; }
   } catch (...) {
     throw;
   }
 
-  return lmd;
+  return tm;
 }
 
 /*
- * @brief      計算: 太陽の距離
+ * @brief      計算: 指定高度・方位角の時刻
+ *             (calc_time_cross と同じく時角差から補正するが、変化率は時角差の数値微分
+ *              とする（ニュートン法）。天頂付近を通る日の方位角のように、指定値の時角が
+ *              赤緯によって大きく変わる場合も収束させるため。
+ *              節点からの補間のため、微分のための評価で天体の位置の計算は増えない)
  *
- * @param[in]  経過ユリウス年 (double)
- * @return     距離 (double)
+ * @param[in]  対象 (InvTarget, 天体の節点は計算済みであること)
+ * @param[in]  反復の初期時刻(日) (double)
+ * @param[in]  区分(高度: 0 上昇, 1 下降 / 方位角: 根の別) (unsigned int)
+ * @return     時刻(日, 当日中に該当しない場合は -1.0) (double)
  */
-double Calc::calc_dist_sun(double jy) {
-  double dist;
+double Calc::calc_time_inv(const struct InvTarget& tg, double tm, unsigned int kbn) {
+  double rev = 1.0;         // 補正値
+  double hd_0;              // 時角差
+  double hd_1;              // 時角差（kDtInv 後）
+  double rate;              // 時角差の変化率(度/日)
+  unsigned int n_it = 0;    // 反復回数
+  unsigned int n_try;       // 試行回数
 
   try {
-    dist = 0.000007 * std::sin(kPi180 * norm_ang(156.0 +  329.6  * jy))
-         + 0.000007 * std::sin(kPi180 * norm_ang(254.0 +  450.4  * jy))
-         + 0.000013 * std::sin(kPi180 * norm_ang( 27.8 + 4452.67 * jy))
-         + 0.000030 * std::sin(kPi180 * norm_ang( 90.0))
-         + 0.000091 * std::sin(kPi180 * norm_ang(265.1 +  719.98 * jy))
-         + (0.007256 - 0.0000002 * jy)
-         * std::sin(kPi180 * norm_ang(267.54 + 359.991 * jy));
-    dist = std::pow(10.0, dist);
+    for (n_try = 0; n_try < 2; ++n_try) {
+      // 初期時刻によっては前後の日の時刻に収束するため、1 日ずらして解き直す
+      if (n_try > 0) {
+        if (tm >= 0.0 && tm < 1.0) break;
+        tm  += tm < 0.0 ? 1.0 : -1.0;
+        rev  = 1.0;
+        n_it = 0;
+      }
+      while (std::abs(rev) > kEps) {
+        // 該当しない（高度に達しない, 方位角を通らない）または収束しない場合はなし
+        if (++n_it > kMaxIter) return -1.0;
+        hd_0 = inv_hang_diff(tg, tm, kbn);
+        if (std::isnan(hd_0)) return -1.0;
+        hd_1 = inv_hang_diff(tg, tm + kDtInv, kbn);
+        rate = std::remainder(hd_0 - hd_1, 360.0) / kDtInv;
+        // 極値付近等で変化率が小さい（または求まらない）場合は天体の時角の変化率
+        if (!(std::abs(rate) > 0.1 * kHaRate[tg.bd])) rate = kHaRate[tg.bd];
+        rev  = std::max(-0.5, std::min(0.5, hd_0 / rate));
+        tm  += rev;
+      }
+    }
+    if (tm < 0.0 || tm >= 1.0) { tm = -1.0; }
   } catch (...) {
     throw;
   }
 
-  return dist;
+  return tm;
 }
 
 /*
- * @brief      計算: 月の黄緯
+ * @brief      計算: 時刻 tm における指定高度・方位角の時角と天体の時角差（補間赤道座標）
+ *             (高度は視差(π)分を地心高度に換算して（h + π cos h）求める)
  *
- * @param[in]  経過ユリウス年 (double)
- * @return     黄経 (double)
+ * @param[in]  対象 (InvTarget, 天体の節点は計算済みであること)
+ * @param[in]  時刻(日) (double)
+ * @param[in]  区分 (unsigned int)
+ * @return     時角差 (double, 該当する時角がない場合は NaN)
  */
-double Calc::calc_bet_moon(double jy) {
-  double bm;
-  double bet;
+double Calc::inv_hang_diff(const struct InvTarget& tg, double tm, unsigned int kbn) {
+  unsigned int n_nd = tg.bd == 0 ? kNdSun : kNdMoon;    // 節点数
+  double jy = (day_p + tm + dlt_t_d) / 365.25;           // 経過ユリウス年
+  double ht;                                             // 高度（地心）
+  Coord  cd_s;                                           // 赤道座標
 
   try {
-    bm  = 0.0005 * std::sin(kPi180 * norm_ang(307.0   + 19.4       * jy))
-        + 0.0026 * std::sin(kPi180 * norm_ang( 55.0   + 19.34      * jy))
-        + 0.0040 * std::sin(kPi180 * norm_ang(119.5   +  1.33      * jy))
-        + 0.0043 * std::sin(kPi180 * norm_ang(322.1   + 19.36      * jy))
-        + 0.0267 * std::sin(kPi180 * norm_ang(234.95  + 19.341     * jy));
-    bet = 0.0003 * std::sin(kPi180 * norm_ang(234.0   + 19268.0    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(146.0   +  3353.3    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(107.0   + 18149.4    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(205.0   + 22642.7    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(147.0   + 14097.4    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang( 13.0   +  9325.4    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang( 81.0   + 10242.6    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(238.0   + 23281.3    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(311.0   +  9483.9    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(239.0   +  4193.4    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(280.0   +  8485.3    * jy))
-        + 0.0006 * std::sin(kPi180 * norm_ang( 52.0   + 13617.3    * jy))
-        + 0.0006 * std::sin(kPi180 * norm_ang(224.0   +  5590.7    * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(294.0   + 13098.7    * jy))
-        + 0.0008 * std::sin(kPi180 * norm_ang(326.0   +  9724.1    * jy))
-        + 0.0008 * std::sin(kPi180 * norm_ang( 70.0   + 17870.7    * jy))
-        + 0.0010 * std::sin(kPi180 * norm_ang( 18.0   + 12978.66   * jy))
-        + 0.0011 * std::sin(kPi180 * norm_ang(138.3   + 19147.99   * jy))
-        + 0.0012 * std::sin(kPi180 * norm_ang(148.2   +  4851.36   * jy))
-        + 0.0012 * std::sin(kPi180 * norm_ang( 38.4   +  4812.68   * jy))
-        + 0.0013 * std::sin(kPi180 * norm_ang(155.4   +   379.35   * jy))
-        + 0.0013 * std::sin(kPi180 * norm_ang( 95.8   +  4472.03   * jy))
-        + 0.0014 * std::sin(kPi180 * norm_ang(219.2   +   299.96   * jy))
-        + 0.0015 * std::sin(kPi180 * norm_ang( 45.8   +  9964.00   * jy))
-        + 0.0015 * std::sin(kPi180 * norm_ang(211.1   +  9284.69   * jy))
-        + 0.0016 * std::sin(kPi180 * norm_ang(135.7   +   420.02   * jy))
-        + 0.0017 * std::sin(kPi180 * norm_ang( 99.8   + 14496.06   * jy))
-        + 0.0018 * std::sin(kPi180 * norm_ang(270.8   +  5192.01   * jy))
-        + 0.0018 * std::sin(kPi180 * norm_ang(243.3   +  8206.68   * jy))
-        + 0.0019 * std::sin(kPi180 * norm_ang(230.7   +  9244.02   * jy))
-        + 0.0021 * std::sin(kPi180 * norm_ang(170.1   +  1058.66   * jy))
-        + 0.0022 * std::sin(kPi180 * norm_ang(331.4   + 13377.37   * jy))
-        + 0.0025 * std::sin(kPi180 * norm_ang(196.5   +  8605.38   * jy))
-        + 0.0034 * std::sin(kPi180 * norm_ang(319.9   +  4433.31   * jy))
-        + 0.0042 * std::sin(kPi180 * norm_ang(103.9   + 18509.35   * jy))
-        + 0.0043 * std::sin(kPi180 * norm_ang(307.6   +  5470.66   * jy))
-        + 0.0082 * std::sin(kPi180 * norm_ang(144.9   +  3713.33   * jy))
-        + 0.0088 * std::sin(kPi180 * norm_ang(176.7   +  4711.96   * jy))
-        + 0.0093 * std::sin(kPi180 * norm_ang(277.4   +  8845.31   * jy))
-        + 0.0172 * std::sin(kPi180 * norm_ang(  3.18  + 14375.997  * jy))
-        + 0.0326 * std::sin(kPi180 * norm_ang(328.96  + 13737.362  * jy))
-        + 0.0463 * std::sin(kPi180 * norm_ang(172.55  +   698.667  * jy))
-        + 0.0554 * std::sin(kPi180 * norm_ang(194.01  +  8965.374  * jy))
-        + 0.1732 * std::sin(kPi180 * norm_ang(142.427 +  4073.3220 * jy))
-        + 0.2777 * std::sin(kPi180 * norm_ang(138.311 +    60.0316 * jy))
-        + 0.2806 * std::sin(kPi180 * norm_ang(228.235 +  9604.0088 * jy))
-        + 5.1282 * std::sin(kPi180 * norm_ang( 93.273 +  4832.0202 * jy + bm));
+    cd_s.lng = norm_ang(interp_nd(nd_ra[tg.bd], n_nd, tm));
+    cd_s.lat = interp_nd(nd_dc[tg.bd], n_nd, tm);
+    if (tg.kd == kInvAz) return hour_ang_az(cd_s, tm_sidereal(jy, tm), tg.val, kbn);
+    ht = tg.val;
+    if (tg.bd == 1) ht += interp_nd(nd_px, n_nd, tm) * std::cos(kPi180 * tg.val);
   } catch (...) {
     throw;
   }
 
-  return bet;
+  return hour_ang_diff(cd_s, tm_sidereal(jy, tm), ht, kbn);
 }
 
 /*
- * @brief      計算: 月の黄経
+ * @brief      計算: 地平線プロファイル上の出入時刻
+ *             (出は、プロファイルの最も低い仰角での出（その高度に達する時刻）から時刻を
+ *              進め、天体の高度がその方位のプロファイル上の出入高度を初めて上回る時刻。
+ *              入は、最も低い仰角での入から時刻を戻して同様に求める（最後に下回る時刻）。
+ *              各点はプロファイルの参照（O(1)）と節点からの補間のみで、天体の位置の計算は
+ *              節点の分だけ。刻みは高度差からの見込み（ニュートン法）と、方位角の変化が
+ *              プロファイルの分割幅の半分（kHzAzStep 未満の場合は kHzAzStep）を超えない幅の
+ *              小さい方とし、符号が変わったらはさみうち法(Illinois)で詰める。
+ *              このため、幅が kHzAzStep 程度より狭い切れ目から覗く出入は見落とし得る。
+ *              当日の最も低い仰角での出入から当日中に求まらない場合は、日付の境界から
+ *              探索する（前日の出・翌日の入が地形に隠れて当日にずれ込む場合）)
  *
- * @param[in]  経過ユリウス年 (double)
- * @return     黄経 (double)
+ * @param[in]  天体(0: 太陽, 1: 月) (unsigned int)
+ * @param[in]  区分(0: 出, 1: 入) (unsigned int)
+ * @return     時刻(日, 当日中に出入がない場合は -1.0) (double)
  */
-double Calc::calc_lmd_moon(double jy) {
-  double am;
-  double lmd;
+double Calc::calc_time_mask(unsigned int bd, unsigned int kbn) {
+  double sgn = kbn == 0 ? 1.0 : -1.0;  // 探索の向き
+  double c;                 // 太陽: 視半径・視差の補正(度)
+  double ht_lo;             // 最も低い仰角での出入高度
+  double tm_0;              // 最も低い仰角での出入時刻(日)
+  double tm;                // 時刻(日)
+  double tm_1;              // 次の時刻(日)
+  double f;                 // 高度差（天体 - 出入高度）
+  double f_1;               // 次の時刻の高度差
+  double az;                // 方位角
+  double az_0;              // 直前の方位角
+  double dh;                // 高度の変化率(度/日)
+  double ht;                // 天体の高度（視半径・視差の補正後）
+  double dt;                // 刻み(日)
+  double v_az;              // 方位角の変化率の見込み(度/日)
+  double az_st;             // 1 刻みの方位角の変化の上限(度)
+  bool f_fnd = false;       // 出入高度を上回る時刻あり
+  unsigned int n_try;       // 試行回数
+  int side = 0;             // はさみうち法: 直前に更新した側
+  unsigned int i;
 
   try {
-    am  = 0.0006 * std::sin(kPi180 * norm_ang( 54.0   + 19.3       * jy))
-        + 0.0006 * std::sin(kPi180 * norm_ang( 71.0   +  0.2       * jy))
-        + 0.0020 * std::sin(kPi180 * norm_ang( 55.0   + 19.34      * jy))
-        + 0.0040 * std::sin(kPi180 * norm_ang(119.5   +  1.33      * jy));
-    lmd = 0.0003 * std::sin(kPi180 * norm_ang(280.0   + 23221.3    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(161.0   +    40.7    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(311.0   +  5492.0    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang(147.0   + 18089.3    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang( 66.0   +  3494.7    * jy))
-        + 0.0003 * std::sin(kPi180 * norm_ang( 83.0   +  3814.0    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang( 20.0   +   720.0    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang( 71.0   +  9584.7    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(278.0   +   120.1    * jy))
-        + 0.0004 * std::sin(kPi180 * norm_ang(313.0   +   398.7    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(332.0   +  5091.3    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(114.0   + 17450.7    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(181.0   + 19088.0    * jy))
-        + 0.0005 * std::sin(kPi180 * norm_ang(247.0   + 22582.7    * jy))
-        + 0.0006 * std::sin(kPi180 * norm_ang(128.0   +  1118.7    * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(216.0   +   278.6    * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(275.0   +  4853.3    * jy))
-        + 0.0007 * std::sin(kPi180 * norm_ang(140.0   +  4052.0    * jy))
-        + 0.0008 * std::sin(kPi180 * norm_ang(204.0   +  7906.7    * jy))
-        + 0.0008 * std::sin(kPi180 * norm_ang(188.0   + 14037.3    * jy))
-        + 0.0009 * std::sin(kPi180 * norm_ang(218.0   +  8586.0    * jy))
-        + 0.0011 * std::sin(kPi180 * norm_ang(276.5   + 19208.02   * jy))
-        + 0.0012 * std::sin(kPi180 * norm_ang(339.0   + 12678.71   * jy))
-        + 0.0016 * std::sin(kPi180 * norm_ang(242.2   + 18569.38   * jy))
-        + 0.0018 * std::sin(kPi180 * norm_ang(  4.1   +  4013.29   * jy))
-        + 0.0020 * std::sin(kPi180 * norm_ang( 55.0   +    19.34   * jy))
-        + 0.0021 * std::sin(kPi180 * norm_ang(105.6   +  3413.37   * jy))
-        + 0.0021 * std::sin(kPi180 * norm_ang(175.1   +   719.98   * jy))
-        + 0.0021 * std::sin(kPi180 * norm_ang( 87.5   +  9903.97   * jy))
-        + 0.0022 * std::sin(kPi180 * norm_ang(240.6   +  8185.36   * jy))
-        + 0.0024 * std::sin(kPi180 * norm_ang(252.8   +  9224.66   * jy))
-        + 0.0024 * std::sin(kPi180 * norm_ang(211.9   +   988.63   * jy))
-        + 0.0026 * std::sin(kPi180 * norm_ang(107.2   + 13797.39   * jy))
-        + 0.0027 * std::sin(kPi180 * norm_ang(272.5   +  9183.99   * jy))
-        + 0.0037 * std::sin(kPi180 * norm_ang(349.1   +  5410.62   * jy))
-        + 0.0039 * std::sin(kPi180 * norm_ang(111.3   + 17810.68   * jy))
-        + 0.0040 * std::sin(kPi180 * norm_ang(119.5   +     1.33   * jy))
-        + 0.0040 * std::sin(kPi180 * norm_ang(145.6   + 18449.32   * jy))
-        + 0.0040 * std::sin(kPi180 * norm_ang( 13.2   + 13317.34   * jy))
-        + 0.0048 * std::sin(kPi180 * norm_ang(235.0   +    19.34   * jy))
-        + 0.0050 * std::sin(kPi180 * norm_ang(295.4   +  4812.66   * jy))
-        + 0.0052 * std::sin(kPi180 * norm_ang(197.2   +   319.32   * jy))
-        + 0.0068 * std::sin(kPi180 * norm_ang( 53.2   +  9265.33   * jy))
-        + 0.0079 * std::sin(kPi180 * norm_ang(278.2   +  4493.34   * jy))
-        + 0.0085 * std::sin(kPi180 * norm_ang(201.5   +  8266.71   * jy))
-        + 0.0100 * std::sin(kPi180 * norm_ang( 44.89  + 14315.966  * jy))
-        + 0.0107 * std::sin(kPi180 * norm_ang(336.44  + 13038.696  * jy))
-        + 0.0110 * std::sin(kPi180 * norm_ang(231.59  +  4892.052  * jy))
-        + 0.0125 * std::sin(kPi180 * norm_ang(141.51  + 14436.029  * jy))
-        + 0.0153 * std::sin(kPi180 * norm_ang(130.84  +   758.698  * jy))
-        + 0.0305 * std::sin(kPi180 * norm_ang(312.49  +  5131.979  * jy))
-        + 0.0348 * std::sin(kPi180 * norm_ang(117.84  +  4452.671  * jy))
-        + 0.0410 * std::sin(kPi180 * norm_ang(137.43  +  4411.998  * jy))
-        + 0.0459 * std::sin(kPi180 * norm_ang(238.18  +  8545.352  * jy))
-        + 0.0533 * std::sin(kPi180 * norm_ang( 10.66  + 13677.331  * jy))
-        + 0.0572 * std::sin(kPi180 * norm_ang(103.21  +  3773.363  * jy))
-        + 0.0588 * std::sin(kPi180 * norm_ang(214.22  +   638.635  * jy))
-        + 0.1143 * std::sin(kPi180 * norm_ang(  6.546 +  9664.0404 * jy))
-        + 0.1856 * std::sin(kPi180 * norm_ang(177.525 +   359.9905 * jy))
-        + 0.2136 * std::sin(kPi180 * norm_ang(269.926 +  9543.9773 * jy))
-        + 0.6583 * std::sin(kPi180 * norm_ang(235.700 +  8905.3422 * jy))
-        + 1.2740 * std::sin(kPi180 * norm_ang(100.738 +  4133.3536 * jy))
-        + 6.2887 * std::sin(kPi180 * norm_ang(134.961 +  4771.9886 * jy + am))
-        + norm_ang(218.3161 + 4812.67881 * jy);
+    if (!f_nd[bd]) calc_nodes(bd);
+    c     = bd == 0 ? (-0.266994 + 0.0024428) / nd_dist : 0.0;
+    ht_lo = mask_alt(hz->get_min());
+    az_st = std::max(0.5 * hz->get_bin_w(), kHzAzStep);
+    tm_0 = calc_time_inv({bd, kInvAlt, ht_lo + c}, 0.5, kbn);
+    if (tm_0 < 0.0) {
+      // 初期時刻の赤緯ではその高度に達しない（南中高度付近で接する）場合に備え、
+      // 南中（時角 0）付近から解き直す
+      tm = 0.5;
+      for (i = 0; i < 2; ++i) {
+        tm += std::remainder(interp_nd(nd_ra[bd], bd == 0 ? kNdSun : kNdMoon, tm)
+              - tm_sidereal((day_p + tm + dlt_t_d) / 365.25, tm), 360.0) / kHaRate[bd];
+      }
+      tm_0 = calc_time_inv({bd, kInvAlt, ht_lo + c}, tm, kbn);
+    }
+    // 1 回目: 当日の最も低い仰角での出入から, 2 回目: 日付の境界から
+    for (n_try = 0; n_try < 2 && !f_fnd; ++n_try) {
+      if (n_try == 0 && tm_0 < 0.0) continue;
+      tm = n_try == 0 ? tm_0 : (kbn == 0 ? 0.0 : 1.0 - kHzDtMin);
+      f  = mask_diff(bd, tm, c, az, dh, ht);
+      if (f >= 0.0) {
+        if (n_try == 0) return tm;
+        break;
+      }
+      // 境界で最も低い仰角より下の場合、当日の出入は 1 回目の対象
+      if (n_try == 1 && ht < ht_lo) break;
+      // 出入高度を上回る（入は時刻を戻して上回る）時刻まで進める
+      v_az = 360.0;
+      for (i = 0; i < kHzMaxIter; ++i) {
+        // 最も低い仰角より下で遠ざかる場合は出入なし
+        if (ht < ht_lo && dh * sgn < 0.0) break;
+        dt = std::min(kHzDtMax, az_st / v_az);
+        if (dh * sgn > 0.0) dt = std::min(dt, -f / (dh * sgn));
+        dt   = std::max(dt, kHzDtMin);
+        tm_1 = tm + sgn * dt;
+        if (tm_1 < 0.0 || tm_1 >= 1.0) break;
+        az_0 = az;
+        f_1  = mask_diff(bd, tm_1, c, az, dh, ht);
+        v_az = std::max(std::abs(std::remainder(az - az_0, 360.0)) / dt, 1.0);
+        if ((f_fnd = f_1 >= 0.0)) break;
+        tm = tm_1;
+        f  = f_1;
+      }
+    }
+    if (!f_fnd) return kTmNone;
+    // はさみうち法(Illinois)
+    for (i = 0; i < kHzMaxIter && std::abs(tm_1 - tm) > kHzTol; ++i) {
+      double tm_m = tm_1 - f_1 * (tm_1 - tm) / (f_1 - f);
+      double f_m  = mask_diff(bd, tm_m, c, az, dh, ht);
+      if (f_m >= 0.0) {
+        tm_1 = tm_m;
+        f_1  = f_m;
+        if (side > 0) f /= 2.0;
+        side = 1;
+      } else {
+        tm = tm_m;
+        f  = f_m;
+        if (side < 0) f_1 /= 2.0;
+        side = -1;
+      }
+    }
   } catch (...) {
     throw;
   }
 
-  return lmd;
+  return tm_1;
 }
 
 /*
- * @brief      計算: 月の視差
+ * @brief       計算: 時刻 tm における天体の高度と、その方位のプロファイル上の出入高度の差
+ *              (高度は大気差なしの中心の高度（月は測心高度）に太陽の視半径・視差の補正を
+ *               加えた値。赤道座標は節点からの補間)
  *
- * @param[in]  経過ユリウス年 (double)
- * @return     視差 (double)
+ * @param[in]   天体(0: 太陽, 1: 月) (unsigned int)
+ * @param[in]   時刻(日) (double)
+ * @param[in]   太陽: 視半径・視差の補正(度) (double)
+ * @param[out]  方位角 (double)
+ * @param[out]  高度の変化率(度/日) (double)
+ * @param[out]  高度 (double)
+ * @return      高度差（正: 出入高度より上） (double)
  */
-double Calc::calc_diff_moon(double jy) {
-  double diff;
+double Calc::mask_diff(unsigned int bd, double tm, double c,
+                       double& az, double& dh, double& ht) {
+  unsigned int n_nd = bd == 0 ? kNdSun : kNdMoon;  // 節点数
+  double jy = (day_p + tm + dlt_t_d) / 365.25;     // 経過ユリウス年
+  double tm_sd;  // 恒星時
+  double hang;   // 時角(rad)
+  double p;      // 月の視差
+  Coord  cd_s;   // 赤道座標
 
   try {
-    diff = 0.0003 * std::sin(kPi180 * norm_ang(227.0  +  4412.0   * jy))
-         + 0.0004 * std::sin(kPi180 * norm_ang(194.0  +  3773.4   * jy))
-         + 0.0005 * std::sin(kPi180 * norm_ang(329.0  +  8545.4   * jy))
-         + 0.0009 * std::sin(kPi180 * norm_ang(100.0  + 13677.3   * jy))
-         + 0.0028 * std::sin(kPi180 * norm_ang(  0.0  +  9543.98  * jy))
-         + 0.0078 * std::sin(kPi180 * norm_ang(325.7  +  8905.34  * jy))
-         + 0.0095 * std::sin(kPi180 * norm_ang(190.7  +  4133.35  * jy))
-         + 0.0518 * std::sin(kPi180 * norm_ang(224.98 +  4771.989 * jy))
-         + 0.9507 * std::sin(kPi180 * norm_ang(90.0));
+    cd_s.lng = norm_ang(interp_nd(nd_ra[bd], n_nd, tm));
+    cd_s.lat = interp_nd(nd_dc[bd], n_nd, tm);
+    tm_sd = tm_sidereal(jy, tm);
+    hang  = kPi180 * (tm_sd - cd_s.lng);
+    ht = std::asin(std::sin(kPi180 * cd_s.lat) * sin_lat
+                 + std::cos(kPi180 * cd_s.lat) * cos_lat * std::cos(hang));
+    dh = -std::cos(kPi180 * cd_s.lat) * cos_lat * std::sin(hang) / std::cos(ht)
+       * kHaRate[bd];
+    ht /= kPi180;
+    if (bd == 1) {
+      p   = interp_nd(nd_px, n_nd, tm);
+      ht -= p * std::cos(kPi180 * (ht - p * std::cos(kPi180 * ht)));
+    }
+    ht -= c;
+    az  = calc_azimuth(cd_s, tm_sd);
   } catch (...) {
     throw;
   }
 
-  return diff;
+  return ht - mask_alt(hz->at(az));
 }
 
 /*
- * @brief      黄道座標 -> 赤道座標 変換
+ * @brief      計算: 見かけの仰角 e の地形に接する（出入する）天体の高度（大気差なし）
+ *             (e は地平線伏角より下にはならない。大気差は Bennett の式を 0° で kAstrRef
+ *              に合わせたもの（0° 以下は kAstrRef）で、地形がない場合は通常の出入高度と一致)
  *
- * @param[in]  経過ユリウス年 (double)
- * @param[in]  黄道座標 (Coord)
- * @return     赤道座標 (Coord)
+ * @param[in]  仰角(度) (double)
+ * @return     高度(度) (double)
  */
-Coord Calc::ko2se(double jy, Coord cd_k) {
-  double ang_k;  // 黄道傾角
-  double lmd;    // 黄経(rad)
-  double bet;    // 黄緯(rad)
-  double a;
-  double b;
-  double c;
-  Coord  cd_s = {0.0, 0.0};
+double Calc::mask_alt(double e) {
+  e = std::max(e, -dip);
+  if (e <= 0.0) return e - kAstrRef;
 
-  try {
-    ang_k = (23.439291 - 0.000130042 * jy) * kPi180;
-    lmd = cd_k.lng * kPi180;  // 黄経
-    bet = cd_k.lat * kPi180;  // 黄緯
-    a =  cos(bet) * cos(lmd);
-    b = -sin(bet) * sin(ang_k)
-      +  cos(bet) * sin(lmd) * cos(ang_k);
-    c =  sin(bet) * cos(ang_k)
-      +  cos(bet) * sin(lmd) * sin(ang_k);
-    cd_s.lng = std::atan(b / a) / kPi180;
-    // aがマイナスのときは 90°< α < 270° → 180°加算する
-    //if (a < 0.0) { cd_s.lat += 180.0; }
-    if (a < 0.0) { cd_s.lng += 180.0; }
-    cd_s.lat = std::asin(c) / kPi180;
-  } catch (...) {
-    throw;
-  }
-
-  return cd_s;
+  return e - kAstrRef * std::tan(kPi180 * kRefBnt0) / std::tan(kPi180 * (e + 7.31 / (e + 4.4)));
 }
 
 /*
@@ -586,6 +977,39 @@ double Calc:: hour_ang_diff(
   return dt;
 }
 
+/*
+ * @brief      計算: 指定方位角(A)となる時角(tk)と天体の時角(t)との差(dt=tk-t)
+ *             (方位角の式 tan A = -cosδ sin t / (sinδ cosφ - cosδ sinφ cos t) を t に
+ *              ついて解くと cos(t + β) = sinA sinδ cosφ / (cosδ R)
+ *              (R cosβ = sinA sinφ, R sinβ = cosA) となり、根は 2 つ。
+ *              一方は A + 180° の根のこともあるため、呼び出し側で方位角を確かめる)
+ *
+ * @param[in]  天体の赤緯・赤経 (Coord)
+ * @param[in]  恒星時Θ(度) (double)
+ * @param[in]  方位角(度) (double)
+ * @param[in]  根の区分(0: t + β = -acos, 1: +acos) (unsigned int)
+ * @return     時角差 (double, 根がない場合は NaN)
+ */
+double Calc::hour_ang_az(Coord cd_s, double tm_sd, double az, unsigned int kbn) {
+  double s_a = std::sin(kPi180 * az);
+  double c_a = std::cos(kPi180 * az);
+  double r;   // R
+  double b;   // β
+  double tk;  // 指定方位角の時角
+
+  try {
+    r  = std::sqrt(c_a * c_a + s_a * s_a * sin_lat * sin_lat);
+    b  = std::atan2(c_a, s_a * sin_lat) / kPi180;
+    tk = s_a * std::tan(kPi180 * cd_s.lat) * cos_lat / r;
+    tk = std::acos(tk) / kPi180;
+    tk = (kbn == 0 ? -tk : tk) - b;
+  } catch (...) {
+    throw;
+  }
+
+  return std::remainder(tk - tm_sd + cd_s.lng, 360.0);
+}
+
 /*
  * @brief      計算: 時刻(t)における黄経、黄緯(λ(jy),β(jy))の天体の方位角(ang)
  *
@@ -597,14 +1021,33 @@ double Calc:: hour_ang_diff(
 double Calc::calc_angle(Coord cd_k, double dd, double jy) {
   Coord  cd_s;   // 赤道座標
   double tm_sd;  // 恒星時(日)
+  double ang;    // 角度
+
+  try {
+    cd_s  = ko2se(jy, cd_k);            // 黄道 -> 赤道変換
+    tm_sd = tm_sidereal(jy, dd);        // 恒星時
+    ang   = calc_azimuth(cd_s, tm_sd);  // 天体の方位角
+  } catch (...) {
+    throw;
+  }
+
+  return ang;
+}
+
+/*
+ * @brief      計算: 赤道座標(α,δ)・恒星時Θにおける天体の方位角(ang)
+ *
+ * @param[in]  天体の赤道座標 (Coord)
+ * @param[in]  恒星時Θ(度) (double)
+ * @return     角度(xx.x度) (double)
+ */
+double Calc::calc_azimuth(Coord cd_s, double tm_sd) {
   double hang;   // 天体の時角
   double a_0;
   double a_1;
   double ang;    // 角度
 
   try {
-    cd_s  = ko2se(jy, cd_k);            // 黄道 -> 赤道変換
-    tm_sd = tm_sidereal(jy, dd);        // 恒星時
     hang  = tm_sd - cd_s.lng;           // 天体の時角
     // 天体の方位角
     a_0 = -std::cos(kPi180 * cd_s.lat) * std::sin(kPi180 * hang);
@@ -623,6 +1066,27 @@ double Calc::calc_angle(Coord cd_k, double dd, double jy) {
   return ang;
 }
 
+/*
+ * @brief      計算: 赤道座標(α,δ)・恒星時Θにおける天体の高度（大気差なし）
+ *
+ * @param[in]  天体の赤道座標 (Coord)
+ * @param[in]  恒星時Θ(度) (double)
+ * @return     高度(度) (double)
+ */
+double Calc::calc_alt_geo(Coord cd_s, double tm_sd) {
+  double ht;  // 高度
+
+  try {
+    ht = std::sin(kPi180 * cd_s.lat) * sin_lat
+       + std::cos(kPi180 * cd_s.lat) * cos_lat * std::cos(kPi180 * (tm_sd - cd_s.lng));
+    ht = std::asin(ht) / kPi180;
+  } catch (...) {
+    throw;
+  }
+
+  return ht;
+}
+
 /*
  * @brief      計算: 時刻(t)における黄経、黄緯(λ(jy),β(jy))の天体の高度(height)
  *
@@ -662,24 +1126,5 @@ double Calc::calc_height(Coord cd_k, double dd, double jy) {
   return ht;
 }
 
-/*
- * @brief   計算: 角度の正規化
- *                (角度を 0 以上 360 未満にする)
- *
- * @param[in]  角度（正規化前） (double)
- * @return     角度（正規化後） (double)
- */
-double Calc::norm_ang(double ang_src) {
-  double ang;
-
-  try {
-    ang = ang_src - 360.0 * int(ang_src / 360.0);
-  } catch (...) {
-    throw;
-  }
-
-  return ang;
-}
-
 }  // namespace sun_moon
 
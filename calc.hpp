@@ -1,11 +1,15 @@
 #ifndef SUN_MOON_CALC_HPP_
 #define SUN_MOON_CALC_HPP_
 
+#include "ephem.hpp"
+#include "horizon.hpp"
 #include "time.hpp"
 
+#include <cstdint>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 //#include <string>
 
 namespace sun_moon {
@@ -15,10 +19,55 @@ struct TmAh {
   struct timespec time;
   double          ah;
 };
-// 座標
-struct Coord {
-  double lat;
-  double lng;
+
+// 出・入・南中の状態（calc_sun, calc_moon の直後に get_st で取得）
+enum EvSt : unsigned int {
+  kEvOk = 0,  // 正常
+  kEvNone,    // 該当日に出・入・南中なし（出入高度に達しない日を含む）
+  kEvNoConv,  // 反復が収束しない
+};
+
+// 月の位相（月の南中時, 南中がない日は正午の値）
+struct MoonPhase {
+  double ph_ang;  // 位相角(度, 0: 満月 〜 180: 新月)
+  double illum;   // 輝面比(0: 新月 〜 1: 満月)
+  double age;     // 月齢(日, 太陽との黄経差を平均朔望月で換算)
+  double limb;    // 明縁の位置角(度, 天の北極方向から東回り)
+};
+
+// 太陽高度の通過（日の出／入・薄明等）
+// * 朝（上昇時）・夕（下降時）の時刻と方位角。その日に通過しない場合は ah = -1
+struct SunCross {
+  struct TmAh am;  // 朝
+  struct TmAh pm;  // 夕
+};
+
+// 逆算の区分
+enum InvKind : unsigned int {
+  kInvAlt = 0,  // 指定高度に達する時刻
+  kInvAz,       // 指定方位角を通過する時刻
+  kInvNoon,     // 日南中の前後（指定時間後）の高度（太陽のみ）
+};
+
+// 逆算の対象
+struct InvTarget {
+  unsigned int bd;   // 天体(0: 太陽, 1: 月。Body と同じ値)
+  InvKind      kd;   // 区分
+  double       val;  // 高度・方位角(度) / 日南中からの時間(時, 前はマイナス)
+};
+
+// 逆算の結果（該当なしは f = false）
+// * 高度: ev[0] が上昇時、ev[1] が下降時（値は方位角）
+// * 方位角: 時刻順（通過が 1 回の日は ev[0] のみ。値は高度）
+// * 日南中の前後: ev[0] のみ（値は高度）
+// * 高度はいずれも大気差を含まない中心の高度（月は視差補正済みの測心高度）
+struct InvEv {
+  bool            f;     // 該当あり
+  struct timespec time;  // 時刻
+  double          val;   // 方位角または高度(度)
+};
+struct InvRes {
+  struct InvEv ev[2];
 };
 
 class Calc {
@@ -29,30 +78,65 @@ class Calc {
   double  dlt_t_d;      // ΔTの日換算値
   double dip;           // 地平線伏角
   double day_p;         // 2000年1月1日力学時正午からの経過日数(日)
+  double  sin_lat;      // sin(緯度)
+  double  cos_lat;      // cos(緯度)
+  std::uint64_t eop_ver;  // 使用した EOP 一覧の版数
+  bool    f_eop;        // ΔT を EOP 一覧から求めた（false: 範囲外のため近似式）
+  EvSt    st;           // 直前の calc_sun / calc_moon の状態
+  bool    f_mt;         // 月南中の黄道座標を保持済み
+  double  jy_mt;        // 月南中時の経過ユリウス年
+  Coord   cd_mt;        // 月南中時の黄道座標
+  const Horizon* hz;    // 地平線プロファイル（nullptr: 海面の地平線のみ）
+  bool    f_nd[2];      // 節点を計算済み（天体毎）
+  double  nd_ra[2][5];  // 節点: 赤経（天体毎）
+  double  nd_dc[2][5];  // 節点: 赤緯（天体毎）
+  double  nd_px[5];     // 節点: 月の視差
+  double  nd_dist;      // 太陽の距離（12 時）
 
 public:
   Calc(struct timespec, double, double, double);  // コンストラクタ
+  Calc(struct timespec, double, double, double,
+       std::shared_ptr<const EopTable>);          // コンストラクタ（EOP 一覧指定）
+  std::uint64_t get_eop_ver() { return eop_ver; } // 取得: 使用した EOP 一覧の版数
+  bool has_eop() const { return f_eop; }          // 判定: ΔT を EOP 一覧から求めた
+  EvSt get_st() const { return st; }              // 取得: 直前の calc_sun / calc_moon の状態
+  void set_horizon(const Horizon* p) { hz = p; }  // 設定: 地平線プロファイル
   struct TmAh calc_sun(unsigned int);             // 計算（日の出／入）
   struct TmAh calc_moon(unsigned int);            // 計算（月の出／入）
+  struct MoonPhase calc_phase();                  // 計算（月の位相, calc_moon(2) の後）
+  void calc_sun_cross(const double*, unsigned int, struct SunCross*);
+                                                  // 計算（日の出／入と指定高度の通過を一括）
+  void calc_inverse(const struct InvTarget*, unsigned int, struct InvRes*);
+                                                  // 計算（指定高度・方位角の時刻等の逆算を一括）
 private:
-  double calc_day_progress();           // 計算: 2000年1月1日力学時正午からの経過日数
   double calc_time_sun(unsigned int);   // 計算: 日の出・入・南中時刻
-  double calc_lmd_sun(double);          // 計算: 太陽の黄経
-  double calc_dist_sun(double);         // 計算: 太陽の距離
+  double calc_transit_sun();            // 計算: 日の南中時刻（平均南中時刻から直接, 補正 1 回）
   double calc_time_moon(unsigned int);  // 計算: 日の出・入・南中時刻
-  double calc_bet_moon(double);         // 計算: 月の黄緯
-  double calc_lmd_moon(double);         // 計算: 月の黄経
-  double calc_dist_moon(double);        // 計算: 月の距離
-  double norm_ang(double);              // 計算: 角度の正規化
+  double calc_time_cross(const double*, const double*, double, double, unsigned int);
+                                        // 計算: 指定高度の通過時刻（補間赤道座標）
+  void calc_nodes(unsigned int);        // 計算: 節点の赤経・赤緯・視差（逆算・地平線用）
+  double calc_time_inv(const struct InvTarget&, double, unsigned int);
+                                        // 計算: 指定高度・方位角の時刻（補間赤道座標）
+  double inv_hang_diff(const struct InvTarget&, double, unsigned int);
+                                        // 計算: 指定高度・方位角の時角と天体の時角差
+  bool hz_on() const { return hz != nullptr && hz->get_max() > -dip; }
+                                        // 判定: 地平線プロファイルで出入が変わり得る
+  double calc_time_mask(unsigned int, unsigned int);
+                                        // 計算: 地平線プロファイル上の出入時刻
+  double mask_diff(unsigned int, double, double, double&, double&, double&);
+                                        // 計算: 天体の高度とプロファイル上の出入高度の差
+  double mask_alt(double);              // 計算: 仰角(度)の地形に接する天体の高度（大気差補正）
   double tm_sidereal(double, double);   // 計算: 観測地点の恒星時Θ(度)
   double hour_ang_diff(Coord, double, double, unsigned int);
                                         // 計算: 出入点の時角と天体の時角差
+  double hour_ang_az(Coord, double, double, unsigned int);
+                                        // 計算: 指定方位角の時角と天体の時角差
   double calc_angle(Coord, double, double);
                                         // 計算: 時刻(t)における黄経、黄緯の天体の方位角
+  double calc_azimuth(Coord, double);   // 計算: 赤道座標・恒星時における天体の方位角
+  double calc_alt_geo(Coord, double);   // 計算: 赤道座標・恒星時における天体の高度（大気差なし）
   double calc_height(Coord, double, double);
                                         // 計算: 時刻(t)における黄経、黄緯の天体の高度
-  double calc_diff_moon(double);        // 計算: 月の視差
-  struct Coord ko2se(double, Coord);    // 変換: 黄道座標 -> 赤道座標
 };
 
 }  // namespace sun_moon
@@ -0,0 +1,180 @@
+/*
+ * check_lite: 軽量版 (libsun_moon_lite.a) の検査（make check-lite）
+ *
+ * * ヒープ確保なし: malloc/calloc/realloc・operator new を差し替えて計数し、
+ *   軽量版の関数の呼び出し中に 1 回でも確保があれば失敗
+ * * 結果の一致: 同じ日付・観測者について libsun_moon.so の sm_calc_batch と
+ *   sm_result（時刻・状態・方位角／高度のビット列・補足フラグ）を比較し、
+ *   1 件でも異なれば失敗（calc.cpp の移植である軽量版との同期を保つため）
+ * * 日付・観測者は固定の種から生成（1900〜2199 年, 南北の高緯度を含む, 標高 0〜3000m）
+ */
+#include "libsun_moon_lite.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <new>
+#include <random>
+
+extern "C" void* __libc_malloc(std::size_t);
+extern "C" void* __libc_calloc(std::size_t, std::size_t);
+extern "C" void* __libc_realloc(void*, std::size_t);
+
+// 定数
+static constexpr long kNumCase = 200000;  // 比較件数
+
+// ヒープ確保の計数（計数中のみ）
+static bool g_cnt = false;
+static long g_n_alloc = 0;
+
+extern "C" void* malloc(std::size_t n) {
+  if (g_cnt) ++g_n_alloc;
+  return __libc_malloc(n);
+}
+extern "C" void* calloc(std::size_t n, std::size_t s) {
+  if (g_cnt) ++g_n_alloc;
+  return __libc_calloc(n, s);
+}
+extern "C" void* realloc(void* p, std::size_t n) {
+  if (g_cnt) ++g_n_alloc;
+  return __libc_realloc(p, n);
+}
+void* operator new(std::size_t n) {
+  void* p;
+
+  if (g_cnt) ++g_n_alloc;
+  if ((p = __libc_malloc(n == 0 ? 1 : n)) == nullptr) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](std::size_t n) {
+  return operator new(n);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using FnCtxNew = sm_ctx* (*)(const char*);
+using FnCalc   = std::ptrdiff_t (*)(sm_ctx*, const sm_date*, const sm_observer*,
+                                    std::size_t, sm_result*);
+
+/*
+ * @brief      比較: イベント（時刻・状態・方位角／高度のビット列）
+ *
+ * @param[in]  軽量版 (sm_event)
+ * @param[in]  共有ライブラリ (sm_event)
+ * @return     一致 (bool)
+ */
+bool same_ev(const sm_event& a, const sm_event& b) {
+  return a.status == b.status && a.sec == b.sec && a.nsec == b.nsec
+      && std::memcmp(&a.ah, &b.ah, sizeof(a.ah)) == 0;
+}
+
+/*
+ * @brief      比較: 計算結果
+ *
+ * @param[in]  軽量版 (sm_result)
+ * @param[in]  共有ライブラリ (sm_result)
+ * @return     一致 (bool)
+ */
+bool same_res(const sm_result& a, const sm_result& b) {
+  if (a.status != b.status) return false;
+  if (a.status != SM_OK) return true;
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (!same_ev(a.sun[i], b.sun[i]) || !same_ev(a.moon[i], b.moon[i])) return false;
+  }
+  return a.flags == b.flags;  // eop_ver は版数の採番が異なる（軽量版は DUT1 一覧の最終日付）
+}
+
+/*
+ * @brief      出力: 差異のある件
+ *
+ * @param[in]  日付 (sm_date)
+ * @param[in]  観測者 (sm_observer)
+ * @param[in]  軽量版 (sm_result)
+ * @param[in]  共有ライブラリ (sm_result)
+ * @return     none
+ */
+void put_diff(const sm_date& d, const sm_observer& o, const sm_result& a, const sm_result& b) {
+  std::printf("[DIFF] %04d-%02d-%02d %.6f %.6f %.1f status %d/%d\n",
+              d.year, d.month, d.day, o.lat, o.lng, o.ht, a.status, b.status);
+  for (unsigned int i = 0; i < 6; ++i) {
+    const sm_event& x = i < 3 ? a.sun[i] : a.moon[i - 3];
+    const sm_event& y = i < 3 ? b.sun[i] : b.moon[i - 3];
+    if (same_ev(x, y)) continue;
+    std::printf("  ev %u: %lld.%09d %d %.12f | %lld.%09d %d %.12f\n", i,
+                (long long)x.sec, x.nsec, x.status, x.ah,
+                (long long)y.sec, y.nsec, y.status, y.ah);
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> u01(0.0, 1.0);
+  long n_diff = 0;  // 差異のある件数
+  long k;
+
+  void* h = dlopen("./libsun_moon.so", RTLD_NOW | RTLD_LOCAL);
+  if (h == nullptr) {
+    std::fprintf(stderr, "[ERROR] Cannot load libsun_moon.so: %s\n", dlerror());
+    return EXIT_FAILURE;
+  }
+  auto ctx_new = reinterpret_cast<FnCtxNew>(dlsym(h, "sm_ctx_new"));
+  auto calc    = reinterpret_cast<FnCalc>(dlsym(h, "sm_calc_batch"));
+  sm_ctx* ctx  = ctx_new == nullptr ? nullptr : ctx_new(".");
+  if (calc == nullptr || ctx == nullptr) {
+    std::fprintf(stderr, "[ERROR] Cannot initialize libsun_moon.so\n");
+    return EXIT_FAILURE;
+  }
+  for (k = 0; k < kNumCase; ++k) {
+    sm_date d = {int32_t(1900 + rng() % 300), int32_t(1 + rng() % 12), int32_t(1 + rng() % 28)};
+    if (k % 50 == 0) { d.month = 3; d.day = 1; }  // うるう日の前後
+    if (k % 51 == 0) { d.month = 1; d.day = 1; }  // 年の境界
+    sm_observer o = {u01(rng) * 40.0 + (k % 2 ? 50.0 : -90.0), u01(rng) * 360.0 - 180.0,
+                     double(rng() % 3000)};
+    if (k % 997 == 0) o.lat = 95.0;               // 入力値不正
+    sm_result a;
+    sm_result b;
+    sm_result c;
+    sm_lite_state st;
+    // 軽量版（一括・逐次）
+    g_cnt = true;
+    sm_lite_calc(&d, &o, &a);
+    c = a;
+    if (sm_lite_init(&st, &d, &o) == SM_OK) {
+      for (int i = 0; i < 3; ++i) {
+        sm_lite_sun(&st, i, &c.sun[i]);
+        sm_lite_moon(&st, i, &c.moon[i]);
+      }
+    }
+    g_cnt = false;
+    calc(ctx, &d, &o, 1, &b);
+    if (!same_res(a, b) || !same_res(c, a)) {
+      if (n_diff++ < 5) put_diff(d, o, a, b);
+    }
+  }
+  // 位相
+  {
+    sm_lite_state st;
+    sm_lite_phase ph;
+    sm_event ev;
+    sm_date d = {2024, 2, 29};
+    sm_observer o = {35.68, 139.77, 40.0};
+    g_cnt = true;
+    sm_lite_init(&st, &d, &o);
+    sm_lite_moon(&st, SM_TRANSIT, &ev);
+    sm_lite_phase_calc(&st, &ph);
+    g_cnt = false;
+  }
+  std::printf("[INFO] %ld cases, %ld differ, %ld heap allocations (eop_ver %llu)\n",
+              kNumCase, n_diff, g_n_alloc, (unsigned long long)sm_lite_eop_ver());
+
+  return n_diff == 0 && g_n_alloc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,395 @@
+#include "colfile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sun_moon {
+
+// 定数
+static constexpr std::uint64_t kChunkRows = 65536;  // チャンク行数
+static constexpr const char* kEvCol[6] = {
+  "sun_rise", "sun_set", "sun_transit", "moon_rise", "moon_set", "moon_transit"
+};
+
+/*
+ * @brief   取得: 計算結果の列定義
+ *          (seq, date, lat, lng, ht, イベント毎に _sec, _nsec, _ah, _st, eop_ver)
+ *
+ * @param   none
+ * @return  列定義 (vector<ColDesc>)
+ */
+const std::vector<ColDesc>& col_descs() {
+  static const std::vector<ColDesc> descs = [] {
+    std::vector<ColDesc> d;
+    auto add = [&d](const std::string& name, ColType t, std::uint32_t s) {
+      ColDesc c = {};
+      std::strncpy(c.name, name.c_str(), sizeof(c.name) - 1);
+      c.type = t;
+      c.size = s;
+      d.push_back(c);
+    };
+    add("seq",  kCtU64, 8);
+    add("date", kCtI32, 4);
+    add("lat",  kCtF64, 8);
+    add("lng",  kCtF64, 8);
+    add("ht",   kCtF64, 8);
+    for (const char* ev : kEvCol) {
+      add(std::string(ev) + "_sec",  kCtI64, 8);  // UNIX 秒
+      add(std::string(ev) + "_nsec", kCtI32, 4);  // ナノ秒
+      add(std::string(ev) + "_ah",   kCtF64, 8);  // 方位角 or 高度
+      add(std::string(ev) + "_st",   kCtU8,  1);  // 0: 正常, 1: イベントなし
+    }
+    add("moon_phase_angle", kCtF64, 8);  // 位相角
+    add("moon_illum",       kCtF64, 8);  // 輝面比
+    add("moon_age",         kCtF64, 8);  // 月齢
+    add("moon_limb",        kCtF64, 8);  // 明縁の位置角
+    add("eop_ver", kCtU64, 8);
+    return d;
+  }();
+
+  return descs;
+}
+
+/*
+ * @brief   取得: ヘッダ（ColHead + 列定義）のバイト列
+ *
+ * @param   none
+ * @return  ヘッダ (vector<char>)
+ */
+static const std::vector<char>& col_head() {
+  static const std::vector<char> head = [] {
+    const auto& descs = col_descs();
+    ColHead h = {};
+    std::vector<char> v;
+    std::memcpy(h.magic, kColMagic, sizeof(h.magic));
+    h.n_col  = descs.size();
+    h.s_head = sizeof(ColHead) + sizeof(ColDesc) * descs.size();
+    v.resize(h.s_head);
+    std::memcpy(v.data(), &h, sizeof(h));
+    std::memcpy(v.data() + sizeof(h), descs.data(),
+                sizeof(ColDesc) * descs.size());
+    return v;
+  }();
+
+  return head;
+}
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+ColWriter::ColWriter() : fd(-1), n_row(0), day0(0), ymd(-1) {
+  cols.resize(col_descs().size());
+  for (std::size_t i = 0; i < cols.size(); ++i)
+    cols[i].reserve(kChunkRows * col_descs()[i].size);
+}
+
+/*
+ * @brief  デストラクタ（残りを書き出し）
+ *
+ * @param  none
+ */
+ColWriter::~ColWriter() {
+  flush();
+  if (fd > 1) close(fd);
+}
+
+/*
+ * @brief      OPEN
+ *             (新規ファイルにはヘッダを書き込む。既存ファイルはヘッダを照合して
+ *              末尾にチャンクを追記する)
+ *
+ * @param[in]  ファイル名 ("-" は標準出力) (string)
+ * @return     成否 (bool)
+ */
+bool ColWriter::open(const std::string& f) {
+  struct stat st;
+
+  try {
+    const std::vector<char>& head = col_head();
+    fd = (f == "-") ? 1 : ::open(f.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    if (fd != 1 && fstat(fd, &st) == 0 && st.st_size > 0) {
+      // 追記: ヘッダ照合
+      std::vector<char> cur(head.size());
+      if (pread(fd, cur.data(), cur.size(), 0) != ssize_t(cur.size())
+          || cur != head) return false;
+      return true;
+    }
+    return write_all(fd, head.data(), head.size());
+  } catch (...) {
+    return false;
+  }
+}
+
+/*
+ * @brief      追加: 1 件
+ *             (_st 列は計算状態 (CalcSt)。状態の指定がなければ計算結果から判定（res_ev_st）。
+ *              正常以外のイベントは時刻 0, 方位角／高度 NaN)
+ *
+ * @param[in]  データ行番号 (uint64_t)
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 指定なし)
+ * @return     none
+ */
+void ColWriter::put(std::uint64_t seq, const Query& q, const Result& res,
+                    const ResSt* rs) {
+  static constexpr double kNan = std::numeric_limits<double>::quiet_NaN();
+  bool f_ok = rs == nullptr || rs->st == kStOk;  // 件として正常
+  unsigned int c = 0;  // 列番号
+  unsigned int i;
+
+  put_val(c++, seq);
+  put_val(c++, to_ymd(q.jst.tv_sec));
+  put_val(c++, q.lat);
+  put_val(c++, q.lng);
+  put_val(c++, q.ht);
+  for (i = 0; i < 6; ++i) {
+    const TmAh& ev = i < 3 ? res.sun[i] : res.moon[i - 3];
+    CalcSt st = !f_ok ? rs->st
+              : rs != nullptr ? rs->ev[i]
+              : res_ev_st(res, i);
+    bool ok = st == kStOk;
+    put_val(c++, std::int64_t(ok ? ev.time.tv_sec : 0));
+    put_val(c++, std::int32_t(ok ? ev.time.tv_nsec : 0));
+    put_val(c++, ok ? ev.ah : kNan);
+    put_val(c++, std::uint8_t(st));
+  }
+  put_val(c++, f_ok ? res.phase.ph_ang : kNan);
+  put_val(c++, f_ok ? res.phase.illum : kNan);
+  put_val(c++, f_ok ? res.phase.age : kNan);
+  put_val(c++, f_ok ? res.phase.limb : kNan);
+  put_val(c++, res.eop_ver);
+  if (++n_row >= kChunkRows) flush();
+}
+
+/*
+ * @brief      追加: 読込中の 1 件をそのまま（分割結果の併合用）
+ *
+ * @param[in]  読込中のファイル (ColReader)
+ * @return     none
+ */
+void ColWriter::put_row(const ColReader& rd) {
+  unsigned int c;
+
+  for (c = 0; c < cols.size(); ++c) {
+    const char* p = rd.get_val(c);
+    cols[c].insert(cols[c].end(), p, p + col_descs()[c].size);
+  }
+  if (++n_row >= kChunkRows) flush();
+}
+
+/*
+ * @brief   書出: チャンク
+ *
+ * @param   none
+ * @return  成否 (bool)
+ */
+bool ColWriter::flush() {
+  static constexpr char kPad[8] = {};
+  ChunkHead ch = {};
+  std::size_t pad;  // 整列用詰め物サイズ
+  bool ok = true;
+
+  if (n_row == 0) return true;
+  std::memcpy(ch.tag, kColChunk, sizeof(ch.tag));
+  ch.n_row = n_row;
+  if (fd < 0) {
+    out.append(reinterpret_cast<const char*>(&ch), sizeof(ch));
+    for (auto& c : cols) {
+      pad = (8 - c.size() % 8) % 8;
+      out.append(c.data(), c.size());
+      out.append(kPad, pad);
+      c.clear();
+    }
+    n_row = 0;
+    return true;
+  }
+  ok = write_all(fd, &ch, sizeof(ch));
+  for (auto& c : cols) {
+    pad = (8 - c.size() % 8) % 8;
+    ok = ok && write_all(fd, c.data(), c.size()) && write_all(fd, kPad, pad);
+    c.clear();
+  }
+  n_row = 0;
+
+  return ok;
+}
+
+/*
+ * @brief      書出: 生成済みチャンク（他の ColWriter で生成したもの）
+ *
+ * @param[in]  チャンク (string)
+ * @return     成否 (bool)
+ */
+bool ColWriter::put_raw(const std::string& chunk) {
+  return fd >= 0 && write_all(fd, chunk.data(), chunk.size());
+}
+
+/*
+ * @brief   取得: 保持中のチャンク（出力先なしの場合。取得後クリア）
+ *
+ * @param   none
+ * @return  チャンク (string)
+ */
+std::string ColWriter::take() {
+  std::string s;
+
+  flush();
+  s.swap(out);
+
+  return s;
+}
+
+/*
+ * @brief      変換: 時刻 -> YYYYMMDD（JST, 同一日はキャッシュを使用）
+ *
+ * @param[in]  時刻 (time_t)
+ * @return     日付 (int32_t)
+ */
+std::int32_t ColWriter::to_ymd(time_t ts) {
+  struct tm t;
+
+  if (ymd < 0 || ts < day0 || ts >= day0 + 86400) {
+    localtime_jst(ts, t);
+    ymd  = (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+    day0 = ts - (t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec);
+  }
+
+  return ymd;
+}
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+ColReader::ColReader() : fd(-1), p_map(nullptr), s_map(0), off(0),
+                         n_row(0), idx(0), f_bad(false) {}
+
+/*
+ * @brief  デストラクタ
+ *
+ * @param  none
+ */
+ColReader::~ColReader() {
+  if (p_map != nullptr) munmap(const_cast<char*>(p_map), s_map);
+  if (fd >= 0) close(fd);
+}
+
+/*
+ * @brief      OPEN（ヘッダを照合）
+ *
+ * @param[in]  ファイル名 (string)
+ * @return     成否 (bool)
+ */
+bool ColReader::open(const std::string& f) {
+  struct stat st;
+  void* p;
+
+  try {
+    const std::vector<char>& head = col_head();
+    fd = ::open(f.c_str(), O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) return false;
+    s_map = st.st_size;
+    if (s_map < head.size()) return false;
+    p = mmap(nullptr, s_map, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return false;
+    p_map = static_cast<const char*>(p);
+    madvise(p, s_map, MADV_SEQUENTIAL);
+    if (std::memcmp(p_map, head.data(), head.size()) != 0) return false;
+    off = head.size();
+    cols.resize(col_descs().size());
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief   移動: 次の行
+ *          (チャンク末尾では次のチャンクを読み込む。チャンクの形式・サイズが
+ *           不正な場合は破損として false を返す)
+ *
+ * @param   none
+ * @return  成否（終端・破損時は false） (bool)
+ */
+bool ColReader::next() {
+  ChunkHead ch;
+  std::size_t s;  // 列データサイズ
+  unsigned int c;
+
+  if (n_row > 0 && ++idx < n_row) return true;
+  while (off < s_map) {
+    if (s_map - off < sizeof(ch)) break;
+    std::memcpy(&ch, p_map + off, sizeof(ch));
+    if (std::memcmp(ch.tag, kColChunk, sizeof(ch.tag)) != 0) break;
+    off += sizeof(ch);
+    for (c = 0; c < cols.size(); ++c) {
+      s = (ch.n_row * col_descs()[c].size + 7) / 8 * 8;
+      if (ch.n_row > s_map || s > s_map - off) {
+        f_bad = true;
+        return false;
+      }
+      cols[c] = p_map + off;
+      off += s;
+    }
+    n_row = ch.n_row;
+    idx   = 0;
+    if (n_row > 0) return true;
+  }
+  if (off < s_map) f_bad = true;
+  n_row = 0;
+
+  return false;
+}
+
+/*
+ * @brief   取得: 現在行の seq（先頭列）
+ *
+ * @param   none
+ * @return  データ行番号 (uint64_t)
+ */
+std::uint64_t ColReader::get_seq() const {
+  std::uint64_t v;
+
+  std::memcpy(&v, get_val(0), sizeof(v));
+
+  return v;
+}
+
+/*
+ * @brief      書出: 全バイト（部分書込・割込みを再試行）
+ *
+ * @param[in]  ファイルディスクリプタ (int)
+ * @param[in]  データ (const void*)
+ * @param[in]  バイト数 (size_t)
+ * @return     成否 (bool)
+ */
+bool write_all(int fd, const void* p, std::size_t n) {
+  const char* c = static_cast<const char*>(p);
+  ssize_t s;
+
+  while (n > 0) {
+    s = ::write(fd, c, n);
+    if (s < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    c += s;
+    n -= s;
+  }
+
+  return true;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,107 @@
+#ifndef SUN_MOON_COLFILE_HPP_
+#define SUN_MOON_COLFILE_HPP_
+
+#include "engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 列形式バイナリファイル
+// * ヘッダ:   ColHead + 列定義(ColDesc) × 列数
+// * チャンク: ChunkHead + 列データ（列ごとに n_row 件を連続配置, 8 バイト境界に整列）
+// * 数値はホストのバイト順（リトルエンディアン前提）
+// * チャンク単位で追記可能（既存ファイルへの追記時はヘッダを照合）
+static constexpr char kColMagic[8] = {'S', 'M', 'C', 'O', 'L', '0', '1', '\0'};
+static constexpr char kColChunk[4] = {'C', 'H', 'N', 'K'};
+
+// 列の型
+enum ColType : std::uint32_t {
+  kCtI64 = 1,  // int64
+  kCtI32 = 2,  // int32
+  kCtF64 = 3,  // float64
+  kCtU8  = 4,  // uint8
+  kCtU64 = 5,  // uint64
+};
+
+struct ColHead {
+  char          magic[8];  // "SMCOL01\0"
+  std::uint32_t n_col;     // 列数
+  std::uint32_t s_head;    // ヘッダサイズ（列定義を含む）
+};
+struct ColDesc {
+  char          name[24];  // 列名（NUL 終端）
+  std::uint32_t type;      // 型 (ColType)
+  std::uint32_t size;      // 要素サイズ (bytes)
+};
+struct ChunkHead {
+  char          tag[4];    // "CHNK"
+  std::uint32_t rsv;       // 予約
+  std::uint64_t n_row;     // 行数
+};
+
+const std::vector<ColDesc>& col_descs();  // 取得: 計算結果の列定義
+
+class ColReader;
+
+// 書込: 列形式バイナリファイル
+class ColWriter {
+  int                            fd;     // 出力先（-1 の場合は out に保持）
+  std::string                    out;    // 書出済みチャンク（fd が -1 の場合）
+  std::vector<std::vector<char>> cols;   // 列バッファ
+  std::uint64_t                  n_row;  // バッファ内の行数
+  time_t                         day0;   // 日付キャッシュ: 当日 00:00:00
+  std::int32_t                   ymd;    // 日付キャッシュ: YYYYMMDD
+
+public:
+  ColWriter();   // コンストラクタ
+  ~ColWriter();  // デストラクタ
+  bool open(const std::string&);                         // OPEN（"-" は標準出力）
+  void put(std::uint64_t, const Query&, const Result&, const ResSt* = nullptr);
+                                                         // 追加: 1 件（計算状態付き）
+  void put_row(const ColReader&);                        // 追加: 読込中の 1 件をそのまま
+  bool flush();                                          // 書出: チャンク
+  bool put_raw(const std::string&);                      // 書出: 生成済みチャンク
+  std::string take();                                    // 取得: 保持中のチャンク（取得後クリア）
+
+private:
+  template <typename T> void put_val(unsigned int c, T v) {
+    const char* p = reinterpret_cast<const char*>(&v);
+    cols[c].insert(cols[c].end(), p, p + sizeof(T));
+  }
+  std::int32_t to_ymd(time_t);  // 変換: 時刻 -> YYYYMMDD
+};
+
+// 読込: 列形式バイナリファイル（メモリマップ, 1 行ずつ順に参照）
+class ColReader {
+  int                      fd;     // ファイルディスクリプタ
+  const char*              p_map;  // マップ先頭
+  std::size_t              s_map;  // マップサイズ
+  std::size_t              off;    // 次のチャンク位置
+  std::vector<const char*> cols;   // 現チャンクの列先頭
+  std::uint64_t            n_row;  // 現チャンクの行数
+  std::uint64_t            idx;    // 現在行（チャンク内）
+  bool                     f_bad;  // 破損検出フラグ
+
+public:
+  ColReader();   // コンストラクタ
+  ~ColReader();  // デストラクタ
+  bool open(const std::string&);  // OPEN（ヘッダを照合）
+  bool next();                    // 移動: 次の行（終端・破損時は false）
+  bool is_bad() const { return f_bad; }  // 判定: 破損
+  std::uint64_t get_seq() const;         // 取得: 現在行の seq
+  const char* get_val(unsigned int c) const {  // 取得: 現在行の列値
+    return cols[c] + idx * col_descs()[c].size;
+  }
+};
+
+bool write_all(int, const void*, std::size_t);  // 書出: 全バイト
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,80 @@
+#include "contour.hpp"
+
+#include <cmath>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double kPi    = atan(1.0) * 4.0;  // 円周率
+static constexpr double kPi180 = kPi / 180.0;      // 円周率 / 180
+
+/*
+ * @brief       計算: 等高度線
+ *              (高度 h の地点は、直下点からの角距離が 90° - h の小円上にある。
+ *               月は測心高度とするため、地心での高度 h + 視差 × cos(h) に換算する。
+ *               直下点からの方位角を刻み毎に回し、球面上の到達点を求める)
+ *
+ * @param[in]   天体直下点 (SubPoint)
+ * @param[in]   高度(度, 大気差補正なし) (double)
+ * @param[in]   刻み(直下点から見た方位角, 度) (double)
+ * @param[ref]  折れ線の集合 (vector<Polyline>)
+ * @return      none
+ */
+void calc_contour(const SubPoint& sp, double ht, double step,
+                  std::vector<Polyline>& lines) {
+  double d;         // 角距離(rad)
+  double sd;        // sin(角距離)
+  double cd;        // cos(角距離)
+  double sp_lat;    // sin(直下点の緯度)
+  double cp_lat;    // cos(直下点の緯度)
+  double b;         // 方位角(rad)
+  double s_lat;     // sin(緯度)
+  Coord  pt;        // 地点
+  Coord  pv;        // 直前の地点
+  double lat_x;     // 日付変更線上の緯度
+  unsigned int n;   // 点数
+  unsigned int i;
+
+  try {
+    lines.clear();
+    if (step <= 0.0 || std::abs(ht) >= 90.0) return;
+    d  = kPi180 * (90.0 - (ht + sp.prl * std::cos(kPi180 * ht)));
+    sd = std::sin(d);
+    cd = std::cos(d);
+    sp_lat = std::sin(kPi180 * sp.lat);
+    cp_lat = std::cos(kPi180 * sp.lat);
+    n = unsigned(std::ceil(360.0 / step));
+    lines.emplace_back();
+    for (i = 0; i <= n; ++i) {
+      b = i == n ? 0.0 : kPi180 * step * i;  // 終点は始点に一致させて閉じる
+      s_lat  = sp_lat * cd + cp_lat * sd * std::cos(b);
+      pt.lat = std::asin(s_lat) / kPi180;
+      pt.lng = std::remainder(
+          sp.lng + std::atan2(std::sin(b) * sd * cp_lat, cd - sp_lat * s_lat) / kPi180,
+          360.0);
+      if (i > 0 && std::abs(pt.lng - pv.lng) > 180.0) {
+        // 日付変更線をまたぐ: 線上の点を補って分割
+        double e = pv.lng > 0.0 ? 180.0 : -180.0;              // 直前側の端
+        double w = pt.lng + (pv.lng > 0.0 ? 360.0 : -360.0);   // 連続させた経度
+        lat_x = pv.lat + (pt.lat - pv.lat) * (e - pv.lng) / (w - pv.lng);
+        lines.back().push_back({lat_x, e});
+        lines.emplace_back();
+        lines.back().push_back({lat_x, -e});
+      }
+      lines.back().push_back(pt);
+      pv = pt;
+    }
+    // 始点・終点の側が同じ分割は 1 本につなげる
+    if (lines.size() > 1) {
+      lines.front().erase(lines.front().begin());
+      lines.back().insert(lines.back().end(), lines.front().begin(),
+                          lines.front().end());
+      lines.erase(lines.begin());
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,22 @@
+#ifndef SUN_MOON_CONTOUR_HPP_
+#define SUN_MOON_CONTOUR_HPP_
+
+#include "ephem.hpp"
+#include "track.hpp"
+
+#include <vector>
+
+namespace sun_moon {
+
+// 等高度線（天体の高度が一定となる地点の列）
+// * 天体直下点を中心とする地球上の小円として解析的に求める（全球の格子評価は不要）
+// * 日付変更線(±180°)で分割し、分割点は線上に補った折れ線の集合とする（Coord は lat/lng 度）
+using Polyline = std::vector<Coord>;
+
+void calc_contour(const SubPoint&, double, double, std::vector<Polyline>&);
+                                   // 計算: 等高度線（直下点, 高度, 刻み(度)）
+
+}  // namespace sun_moon
+
+#endif
+
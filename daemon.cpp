@@ -0,0 +1,192 @@
+#include "daemon.hpp"
+#include "format.hpp"
+#include "stats.hpp"
+
+#include <chrono>
+#include <cstdlib>   // for EXIT_XXXX
+#include <sstream>
+#include <thread>
+
+namespace sun_moon {
+
+// 定数
+static constexpr unsigned int kWatchMs  = 1000;    // EOP ファイル監視間隔 (ms)
+static constexpr std::size_t  kCacheMax = 100000;  // 結果キャッシュ最大件数
+static constexpr std::size_t  kQueueMax = 4096;    // 受付キュー最大件数
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+Daemon::Daemon() : q_req(kQueueMax) {
+  try {
+    eop_cache = o_eop.get();
+    f_stop    = false;
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief   実行: 標準入力の問い合わせを 1 行ずつ処理
+ *          (EOP ファイルの更新・SIGHUP は監視スレッドで検知し、
+ *           新スナップショットを差し替えるのみで処理中の問い合わせは待たせない)
+ *
+ * @param   none
+ * @return  終了コード (int)
+ */
+int Daemon::run() {
+  struct Request req;  // 問い合わせ
+  Formatter o_fmt(1, kLyLine);
+
+  try {
+    Eop::catch_hup();
+    stats_enable();  // 統計（STATS）は常駐モードのみ記録
+    std::thread th_w(&Daemon::watch, this);
+    std::thread th_r(&Daemon::read, this);
+    while (q_req.pop(req)) {
+      std::string s = proc(req);
+      if (s.empty() || s.back() != '\n') s += '\n';
+      o_fmt.put_str(s);
+      o_fmt.flush();  // 対話的に使用するため 1 件ごとに出力
+    }
+    th_r.join();
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      f_stop = true;
+    }
+    cv.notify_all();
+    th_w.join();
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief   受付: 標準入力（1 行ずつ受付時刻を付けてキューへ）
+ *
+ * @param   none
+ * @return  none
+ */
+void Daemon::read() {
+  std::string buf;  // 1行分バッファ
+
+  while (getline(std::cin, buf)) {
+    if (buf == "QUIT") break;
+    if (buf.empty()) continue;
+    if (!q_req.push({buf, now_ns()})) break;
+  }
+  q_req.close();
+}
+
+/*
+ * @brief   監視: EOP ファイル更新（更新日時の変化 or SIGHUP で再読込）
+ *
+ * @param   none
+ * @return  none
+ */
+void Daemon::watch() {
+  std::unique_lock<std::mutex> lk(mtx);
+
+  while (!cv.wait_for(lk, std::chrono::milliseconds(kWatchMs),
+                      [this] { return f_stop; })) {
+    lk.unlock();
+    o_eop.check();
+    lk.lock();
+  }
+}
+
+/*
+ * @brief      キャッシュの部分無効化
+ *             (新旧 EOP 一覧の差異開始日付以降の結果のみ破棄する)
+ *
+ * @param[in]  新しい EOP 一覧 (shared_ptr<const EopTable>)
+ * @return     none
+ */
+void Daemon::sync_cache(std::shared_ptr<const EopTable> eop) {
+  std::string dt;  // 差異開始日付
+
+  try {
+    dt = eop_diff_date(*eop_cache, *eop);
+    // UTC 換算で前日の EOP を参照するため、差異開始日付以降を破棄すれば十分
+    if (!dt.empty()) {
+      cache.erase(cache.lower_bound(CacheKey(dt, -1.0e9, -1.0e9, -1.0e9)),
+                  cache.end());
+    }
+    eop_cache = eop;
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      処理: 1 行
+ *             ("YYYYMMDD LATITUDE LONGITUDE HEIGHT", "RELOAD" or "STATS")
+ *
+ * @param[in]  問い合わせ (Request)
+ * @return     応答文字列 (string)
+ */
+std::string Daemon::proc(const Request& req) {
+  std::istringstream iss(req.line);
+  std::string dt;   // 日付文字列
+  struct Query q;
+  struct Result res;
+
+  try {
+    stats_add(kMtQueueWait, now_ns() - req.t_arr);
+    if (req.line == "STATS") return stats_json();
+    if (req.line == "RELOAD") {
+      o_eop.reload();
+      return "OK RELOAD " + std::to_string(o_eop.get()->ver);
+    }
+    stats_count(kCtQuery);
+    if (!(iss >> dt >> q.lat >> q.lng >> q.ht) || !parse_date(dt, q.jst)) {
+      stats_count(kCtError);
+      return "ERR bad request";
+    }
+    if (q.ht < 0.0) {
+      stats_count(kCtError);
+      return "ERR bad height";
+    }
+    // 処理中はこのスナップショットを使用（差し替えの影響を受けない）
+    auto eop = o_eop.get();
+    if (eop->ver != eop_cache->ver) sync_cache(eop);
+    CacheKey key(dt, q.lat, q.lng, q.ht);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      stats_count(kCtCacheHit);
+      return fmt_res(q, it->second);
+    }
+    stats_count(kCtCacheMiss);
+    res = calc_all(q, eop);
+    if (cache.size() >= kCacheMax) cache.erase(cache.begin());
+    cache.emplace(key, res);
+    return fmt_res(q, res);
+  } catch (...) {
+    stats_count(kCtError);
+    return "ERR calculation failed";
+  }
+}
+
+/*
+ * @brief      整形: 計算結果 ("OK " + 1 件 1 行形式, 改行付き)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @return     応答文字列 (string)
+ */
+std::string Daemon::fmt_res(const Query& q, const Result& res) {
+  Lap lap(kMtSerialize);
+  Formatter o_fmt(-1, kLyLine);
+
+  o_fmt.put_str("OK ", 3);
+  o_fmt.put(q, res);
+
+  return o_fmt.take();
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,50 @@
+#ifndef SUN_MOON_DAEMON_HPP_
+#define SUN_MOON_DAEMON_HPP_
+
+#include "engine.hpp"
+#include "eop.hpp"
+#include "queue.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace sun_moon {
+
+// 受付済みの問い合わせ
+struct Request {
+  std::string   line;   // 問い合わせ文字列
+  std::uint64_t t_arr;  // 受付時刻(ns)
+};
+// 結果キャッシュのキー（日付, 緯度, 経度, 標高）
+using CacheKey = std::tuple<std::string, double, double, double>;
+
+class Daemon {
+  Eop o_eop;                                  // EOP スナップショット管理
+  std::map<CacheKey, Result> cache;           // 結果キャッシュ（日付順）
+  std::shared_ptr<const EopTable> eop_cache;  // キャッシュ内容の EOP 一覧
+  std::mutex mtx;                             // 停止通知用
+  std::condition_variable cv;                 // 停止通知用
+  bool f_stop;                                // 停止フラグ
+  Queue<Request> q_req;                       // 受付キュー
+
+public:
+  Daemon();    // コンストラクタ
+  int run();   // 実行: 標準入力の問い合わせを 1 行ずつ処理
+
+private:
+  void read();                                       // 受付: 標準入力
+  void watch();                                      // 監視: EOP ファイル更新
+  void sync_cache(std::shared_ptr<const EopTable>);  // キャッシュの部分無効化
+  std::string proc(const Request&);                  // 処理: 1 行
+  std::string fmt_res(const Query&, const Result&);  // 整形: 計算結果
+};
+
+}  // namespace sun_moon
+
+#endif
+
@@ -3,6 +3,7 @@
 
 namespace sun_moon {
 
+// * 例外・ヒープを使用しない（軽量版 libsun_moon_lite.a と共用）
 float calc_dlt_t_bf_m500(double);  // ΔT (                year <  -500)
 float calc_dlt_t_bf_0500(double);  // ΔT (-500 <= year && year <   500)
 float calc_dlt_t_bf_1600(double);  // ΔT ( 500 <= year && year <  1600)
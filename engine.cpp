@@ -0,0 +1,254 @@
+#include "engine.hpp"
+#include "stats.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace sun_moon {
+
+/*
+ * @brief       変換: 日付文字列(YYYYMMDD) -> JST
+ *
+ * @param[in]   日付文字列 (string)
+ * @param[ref]  JST (timespec)
+ * @return      成否 (bool)
+ */
+bool parse_date(const std::string& str, struct timespec& jst) {
+  struct tm t = {};  // for work
+
+  try {
+    if (str.size() != 8) return false;
+    for (char c : str) if (c < '0' || c > '9') return false;
+    std::istringstream is(str);
+    is >> std::get_time(&t, "%Y%m%d");
+    if (is.fail()) return false;
+    jst.tv_sec  = mktime_jst(t);
+    jst.tv_nsec = 0;
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief       変換: 逆算の対象一覧（カンマ区切り）
+ *              * alt:X, az:X ... 太陽が高度 X 度に達する・方位角 X 度を通過する時刻
+ *              * moon_alt:X, moon_az:X ... 同（月）
+ *              * noon:H ... 日南中から H 時間後（前はマイナス, -12 〜 12）の太陽の高度
+ *
+ * @param[in]   対象一覧 (string)
+ * @param[ref]  対象 (vector<InvTarget>)
+ * @param[ref]  対象の名称（出力の見出し, 指定どおりの文字列） (vector<string>)
+ * @return      成否 (bool)
+ */
+bool parse_targets(const std::string& str, std::vector<InvTarget>& tgts,
+                   std::vector<std::string>& names) {
+  std::istringstream iss(str);
+  std::string tok;    // 対象 1 件
+  std::string k;      // 区分の名称
+  std::size_t p;      // ':' の位置
+  std::size_t n_cv;   // 変換した文字数
+  InvTarget tg;
+
+  try {
+    tgts.clear();
+    names.clear();
+    while (std::getline(iss, tok, ',')) {
+      if ((p = tok.find(':')) == std::string::npos || p + 1 >= tok.size()) return false;
+      k = tok.substr(0, p);
+      tg.bd = k.compare(0, 5, "moon_") == 0 ? 1 : 0;
+      if (tg.bd == 1) k.erase(0, 5);
+      if      (k == "alt")                { tg.kd = kInvAlt;  }
+      else if (k == "az")                 { tg.kd = kInvAz;   }
+      else if (k == "noon" && tg.bd == 0) { tg.kd = kInvNoon; }
+      else                                { return false;     }
+      tg.val = std::stod(tok.substr(p + 1), &n_cv);
+      if (p + 1 + n_cv != tok.size()) return false;
+      if (tg.kd == kInvAlt  && !(tg.val >= -90.0 && tg.val <= 90.0)) return false;
+      if (tg.kd == kInvAz   && !(tg.val >= 0.0 && tg.val < 360.0))   return false;
+      if (tg.kd == kInvNoon && !(tg.val >= -12.0 && tg.val <= 12.0)) return false;
+      tgts.push_back(tg);
+      names.push_back(tok);
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return !tgts.empty();
+}
+
+/*
+ * @brief       計算: 日・月の出・入・南中（calc_all, calc_all_st 共通）
+ *
+ * @param[in]   問い合わせ (Query)
+ * @param[in]   EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ * @param[in]   地平線プロファイル (const Horizon*)
+ * @param[out]  計算結果 (Result)
+ * @param[out]  状態 (ResSt*, nullptr の場合は求めない)
+ */
+static void calc_res(const Query& q, std::shared_ptr<const EopTable> eop, const Horizon* hz,
+                     struct Result& res, struct ResSt* rs) {
+  static constexpr CalcSt kEvSt[] = {kStOk, kStNoEvent, kStNoConv};  // EvSt -> CalcSt
+  std::uint64_t t0;  // 計測開始時刻(ns, 0: 記録しない)
+  unsigned int  i;
+
+  try {
+    t0 = stats_on() ? now_ns() : 0;
+    Calc o_c(q.jst, q.lat, q.lng, q.ht, eop);
+    if (t0 != 0) stats_add(kMtEop, now_ns() - t0);
+    o_c.set_horizon(hz);
+    for (i = 0; i < 3; ++i) {
+      Lap lap(Metric(kMtSunRise + i));
+      res.sun[i] = o_c.calc_sun(i);
+      if (rs) rs->ev[i] = kEvSt[o_c.get_st()];
+    }
+    for (i = 0; i < 3; ++i) {
+      Lap lap(Metric(kMtMoonRise + i));
+      res.moon[i] = o_c.calc_moon(i);
+      if (rs) rs->ev[3 + i] = kEvSt[o_c.get_st()];
+    }
+    res.phase   = o_c.calc_phase();
+    res.eop_ver = o_c.get_eop_ver();
+    if (rs) rs->f_eop = o_c.has_eop();
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 日・月の出・入・南中
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>)
+ * @param[in]  地平線プロファイル (const Horizon*, nullptr: 海面の地平線のみ)
+ * @return     計算結果 (Result)
+ */
+struct Result calc_all(const Query& q, std::shared_ptr<const EopTable> eop,
+                       const Horizon* hz) {
+  struct Result res;
+
+  try {
+    calc_res(q, eop, hz, res, nullptr);
+  } catch (...) {
+    throw;
+  }
+
+  return res;
+}
+
+/*
+ * @brief      判定: 問い合わせの値の範囲
+ *             (緯度・経度・標高が有限で緯度 ±90 度・経度 ±360 度・標高 0 以上, 日付が変換済み)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @return     範囲内 (bool)
+ */
+bool check_query(const Query& q) noexcept {
+  return std::isfinite(q.lat) && std::isfinite(q.lng) && std::isfinite(q.ht)
+      && std::abs(q.lat) <= 90.0 && std::abs(q.lng) <= 360.0 && q.ht >= 0.0
+      && q.jst.tv_sec != time_t(-1);
+}
+
+/*
+ * @brief       計算: 日・月の出・入・南中（例外を送出せず、状態を返す）
+ *              (不正な問い合わせは計算前に kStBadInput で返すため巻き戻しは発生しない。
+ *               計算中の例外は kStFailed とし、結果は全イベント「なし」とする)
+ *
+ * @param[in]   問い合わせ (Query)
+ * @param[in]   EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ * @param[in]   地平線プロファイル (const Horizon*, nullptr の場合は海面の地平線のみ)
+ * @param[out]  計算結果 (Result)
+ * @param[out]  状態 (ResSt)
+ * @return      件の状態 (CalcSt)
+ */
+CalcSt calc_all_st(const Query& q, std::shared_ptr<const EopTable> eop, const Horizon* hz,
+                   struct Result& res, struct ResSt& rs) noexcept {
+  unsigned int i;
+
+  rs.f_eop = false;
+  rs.st    = kStOk;
+  try {
+    if (!check_query(q)) {
+      rs.st = kStBadInput;
+    } else {
+      calc_res(q, eop, hz, res, &rs);
+    }
+  } catch (...) {
+    rs.st = kStFailed;
+  }
+  if (rs.st != kStOk) {
+    for (i = 0; i < 3; ++i) res.sun[i] = res.moon[i] = {{0, 0}, -1.0};
+    res.phase   = {};
+    res.eop_ver = 0;
+    for (i = 0; i < 6; ++i) rs.ev[i] = kStNoEvent;
+  }
+
+  return rs.st;
+}
+
+/*
+ * @brief      判定: 計算結果のみからイベントの状態（状態を伴わない結果の出力用）
+ *             (出・入は ah < 0 がイベントなし。南中は高度が負でも正常で、時刻が未設定
+ *              ({0, 0}) の場合のみイベントなし。収束しないイベントはイベントなしと区別できない)
+ *
+ * @param[in]  計算結果 (Result)
+ * @param[in]  イベント番号 (0〜2: 日の出・入・南中, 3〜5: 月の出・入・南中) (unsigned int)
+ * @return     状態 (CalcSt)
+ */
+CalcSt res_ev_st(const struct Result& res, unsigned int i) noexcept {
+  const TmAh& ev = i < 3 ? res.sun[i] : res.moon[i - 3];
+
+  if (i % 3 != 2) return ev.ah < 0.0 ? kStNoEvent : kStOk;
+
+  return ev.time.tv_sec == 0 && ev.time.tv_nsec == 0 ? kStNoEvent : kStOk;
+}
+
+/*
+ * @brief      計算: 日の出／入・薄明等（kTwiAlt の各高度の通過を一括で計算）
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ * @return     計算結果 (Twilight)
+ */
+struct Twilight calc_twilight(const Query& q, std::shared_ptr<const EopTable> eop) {
+  struct Twilight tw;
+
+  try {
+    Calc o_c(q.jst, q.lat, q.lng, q.ht, eop);
+    o_c.calc_sun_cross(kTwiAlt, kNumTwi, tw.cr);
+    tw.eop_ver = o_c.get_eop_ver();
+  } catch (...) {
+    throw;
+  }
+
+  return tw;
+}
+
+/*
+ * @brief       計算: 指定高度・方位角の時刻等の逆算（全対象を 1 つの Calc で一括）
+ *
+ * @param[in]   問い合わせ (Query)
+ * @param[in]   対象 (vector<InvTarget>)
+ * @param[in]   EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ * @param[out]  結果 (InvRes[対象数])
+ * @return      計算に使用した EOP 一覧の版数 (uint64_t)
+ */
+std::uint64_t calc_inverse(const Query& q, const std::vector<InvTarget>& tgts,
+                           std::shared_ptr<const EopTable> eop, struct InvRes* out) {
+  std::uint64_t ver;
+
+  try {
+    Calc o_c(q.jst, q.lat, q.lng, q.ht, eop);
+    o_c.calc_inverse(tgts.data(), tgts.size(), out);
+    ver = o_c.get_eop_ver();
+  } catch (...) {
+    throw;
+  }
+
+  return ver;
+}
+
+}  // namespace sun_moon
+
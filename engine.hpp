@@ -0,0 +1,77 @@
+#ifndef SUN_MOON_ENGINE_HPP_
+#define SUN_MOON_ENGINE_HPP_
+
+#include "calc.hpp"
+#include "eop.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 問い合わせ（日付・観測地点）
+struct Query {
+  struct timespec jst;  // JST (計算対象日の 00:00:00)
+  double          lat;  // 緯度
+  double          lng;  // 経度
+  double          ht;   // 標高
+};
+// 計算結果（日・月の出・入・南中）
+struct Result {
+  struct TmAh   sun[3];   // 日の出・入・南中 (添字は calc_sun の区分)
+  struct TmAh   moon[3];  // 月の出・入・南中 (添字は calc_moon の区分)
+  struct MoonPhase phase; // 月の位相
+  std::uint64_t eop_ver;  // 計算に使用した EOP 一覧の版数
+};
+
+// 計算の状態（値は C ABI の SM_* と同じ）
+enum CalcSt : std::int32_t {
+  kStOk       = 0,  // 正常
+  kStNoEvent  = 1,  // 該当日に出・入・南中なし（イベント毎）
+  kStBadInput = 2,  // 問い合わせの値が不正（件毎）
+  kStFailed   = 3,  // 計算失敗（件毎。EOP 一覧の読込失敗・メモリ不足等）
+  kStNoConv   = 4,  // 反復が収束しない（イベント毎）
+};
+// 計算の状態（calc_all_st の結果）
+// * ev の添字は 0〜2: 日の出・入・南中, 3〜5: 月の出・入・南中（st が kStOk の場合のみ有効）
+struct ResSt {
+  CalcSt st;      // 件の状態（kStOk, kStBadInput, kStFailed）
+  CalcSt ev[6];   // イベント毎の状態（kStOk, kStNoEvent, kStNoConv）
+  bool   f_eop;   // ΔT を EOP 一覧から求めた（false: 一覧の範囲外のため近似式）
+};
+
+// 薄明等の高度（太陽中心の幾何学的高度, 度）
+// * ゴールデンアワー上端, ゴールデンアワー／ブルーアワー境界, 市民薄明, 航海薄明, 天文薄明
+static constexpr unsigned int kNumTwi = 5;
+static constexpr double kTwiAlt[kNumTwi] = {6.0, -4.0, -6.0, -12.0, -18.0};
+// 計算結果（日の出／入・薄明等）
+struct Twilight {
+  struct SunCross cr[kNumTwi + 1];  // 0: 日の出／入, 1〜: kTwiAlt の各高度
+  std::uint64_t   eop_ver;          // 計算に使用した EOP 一覧の版数
+};
+
+bool parse_date(const std::string&, struct timespec&);  // 変換: YYYYMMDD -> JST
+bool parse_targets(const std::string&, std::vector<InvTarget>&, std::vector<std::string>&);
+                                                         // 変換: 逆算の対象一覧
+struct Result calc_all(const Query&, std::shared_ptr<const EopTable>,
+                       const Horizon* = nullptr);
+                                                         // 計算: 日・月の出・入・南中
+bool check_query(const Query&) noexcept;                 // 判定: 問い合わせの値の範囲
+CalcSt calc_all_st(const Query&, std::shared_ptr<const EopTable>, const Horizon*,
+                   struct Result&, struct ResSt&) noexcept;
+                                                         // 計算: 日・月の出・入・南中（例外なし, 状態付き）
+CalcSt res_ev_st(const struct Result&, unsigned int) noexcept;
+                                                         // 判定: 計算結果のみからイベントの状態
+struct Twilight calc_twilight(const Query&, std::shared_ptr<const EopTable>);
+                                                         // 計算: 日の出／入・薄明等
+std::uint64_t calc_inverse(const Query&, const std::vector<InvTarget>&,
+                           std::shared_ptr<const EopTable>, struct InvRes*);
+                                                         // 計算: 指定高度・方位角の時刻等の逆算
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,177 @@
+#include "eop.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace sun_moon {
+
+// 版数採番用（0 は単発読込用）
+static std::atomic<std::uint64_t> g_ver(0);
+
+volatile std::sig_atomic_t Eop::f_hup = 0;
+
+/*
+ * @brief       読込: EOP(うるう秒, DUT1)一覧
+ *
+ * @param[ref]  EOP 一覧 (EopTable)
+ * @param[in]   ファイル格納ディレクトリ (string, 空文字列はカレント)
+ * @return      成否 (bool)
+ */
+bool load_eop(EopTable& tbl, const std::string& dir) {
+  File o_f(dir);
+
+  try {
+    tbl.ver = 0;
+    tbl.l_ls.clear();
+    tbl.l_dut.clear();
+    tbl.l_ls.reserve(50);    // 予めメモリ確保
+    tbl.l_dut.reserve(250);  // 予めメモリ確保
+    // 更新日時は読込前に取得（読込中の更新は次回確認時に検知）
+    if (!o_f.get_mtime(tbl.mt_ls, tbl.mt_dut)) return false;
+    if (!o_f.get_leap_sec_list(tbl.l_ls))      return false;
+    if (!o_f.get_dut1_list(tbl.l_dut))         return false;
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      差異開始日付
+ *             (うるう秒・DUT1 はいずれも階段関数のため、両一覧で異なる
+ *              エントリの最小日付以降のみ値が変わり得る)
+ *
+ * @param[in]  旧 EOP 一覧 (EopTable)
+ * @param[in]  新 EOP 一覧 (EopTable)
+ * @return     差異開始日付 (YYYYMMDD, 差異なしの場合は空文字列) (string)
+ */
+std::string eop_diff_date(const EopTable& a, const EopTable& b) {
+  std::string dt;  // 差異開始日付
+
+  try {
+    // 先頭から比較し、最初の不一致エントリの日付（小さい方）を求める
+    auto diff = [&dt](const std::vector<std::vector<std::string>>& l_a,
+                      const std::vector<std::vector<std::string>>& l_b) {
+      std::size_t i = 0;
+      std::string d;
+      while (i < l_a.size() && i < l_b.size() && l_a[i] == l_b[i]) ++i;
+      if (i < l_a.size()) d = l_a[i][0];
+      if (i < l_b.size() && (d.empty() || l_b[i][0] < d)) d = l_b[i][0];
+      if (!d.empty() && (dt.empty() || d < dt)) dt = d;
+    };
+    diff(a.l_ls,  b.l_ls);
+    diff(a.l_dut, b.l_dut);
+  } catch (...) {
+    throw;
+  }
+
+  return dt;
+}
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  EOP ファイル格納ディレクトリ (string, 空文字列はカレント)
+ */
+Eop::Eop(const std::string& dir) : dir(dir) {
+  try {
+    auto t = std::make_shared<EopTable>();
+    if (!load_eop(*t, dir)) throw std::runtime_error("EOP files could not be read");
+    t->ver = ++g_ver;
+    std::atomic_store(&tbl, std::shared_ptr<const EopTable>(t));
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief   取得: 現行スナップショット
+ *          (ロックなしで取得。取得済みのスナップショットは差し替え後も有効)
+ *
+ * @param   none
+ * @return  EOP 一覧 (shared_ptr<const EopTable>)
+ */
+std::shared_ptr<const EopTable> Eop::get() const {
+  return std::atomic_load(&tbl);
+}
+
+/*
+ * @brief   再読込
+ *          (新しいスナップショットを生成し、内容に変化があれば差し替える)
+ *
+ * @param   none
+ * @return  差し替え有無 (bool)
+ */
+bool Eop::reload() {
+  std::lock_guard<std::mutex> lk(mtx);
+
+  try {
+    auto t   = std::make_shared<EopTable>();
+    auto cur = get();
+    if (!load_eop(*t, dir)) return false;  // 読込失敗時は現行を維持
+    if (t->l_ls == cur->l_ls && t->l_dut == cur->l_dut) {
+      // 内容不変なら更新日時のみ引き継いで差し替え（版数は据え置き）
+      t->ver = cur->ver;
+      std::atomic_store(&tbl, std::shared_ptr<const EopTable>(t));
+      return false;
+    }
+    t->ver = ++g_ver;
+    std::atomic_store(&tbl, std::shared_ptr<const EopTable>(t));
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief   確認: ファイル更新日時の変化、または SIGHUP 受信時に再読込
+ *
+ * @param   none
+ * @return  差し替え有無 (bool)
+ */
+bool Eop::check() {
+  struct timespec mt_ls;   // 更新日時: うるう秒ファイル
+  struct timespec mt_dut;  // 更新日時: DUT1 ファイル
+  File o_f(dir);
+
+  try {
+    if (f_hup) {
+      f_hup = 0;
+      return reload();
+    }
+    if (!o_f.get_mtime(mt_ls, mt_dut)) return false;
+    auto cur = get();
+    if (mt_ls.tv_sec  == cur->mt_ls.tv_sec  &&
+        mt_ls.tv_nsec == cur->mt_ls.tv_nsec &&
+        mt_dut.tv_sec  == cur->mt_dut.tv_sec &&
+        mt_dut.tv_nsec == cur->mt_dut.tv_nsec) return false;
+    return reload();
+  } catch (...) {
+    return false;
+  }
+}
+
+/*
+ * @brief   SIGHUP ハンドラ登録
+ *
+ * @param   none
+ * @return  none
+ */
+void Eop::catch_hup() {
+  std::signal(SIGHUP, on_hup);
+}
+
+/*
+ * @brief      SIGHUP ハンドラ（フラグを立てるのみ）
+ *
+ * @param[in]  シグナル番号 (int)
+ * @return     none
+ */
+void Eop::on_hup(int) {
+  f_hup = 1;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,48 @@
+#ifndef SUN_MOON_EOP_HPP_
+#define SUN_MOON_EOP_HPP_
+
+#include "file.hpp"
+
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// EOP(うるう秒, DUT1)一覧のスナップショット（公開後は不変）
+struct EopTable {
+  std::uint64_t   ver;                          // 版数
+  struct timespec mt_ls;                        // 更新日時: うるう秒ファイル
+  struct timespec mt_dut;                       // 更新日時: DUT1 ファイル
+  std::vector<std::vector<std::string>> l_ls;   // List of Leap Second
+  std::vector<std::vector<std::string>> l_dut;  // List of DUT1
+};
+
+bool load_eop(EopTable&, const std::string& = "");            // 読込: EOP 一覧
+std::string eop_diff_date(const EopTable&, const EopTable&);  // 差異開始日付
+
+class Eop {
+  std::shared_ptr<const EopTable> tbl;  // 現行スナップショット
+  std::string dir;                      // EOP ファイル格納ディレクトリ
+  std::mutex mtx;                       // 再読込の排他（読み手は使用しない）
+  static volatile std::sig_atomic_t f_hup;  // SIGHUP 受信フラグ
+
+public:
+  explicit Eop(const std::string& = "");     // コンストラクタ
+  std::shared_ptr<const EopTable> get() const;  // 取得: 現行スナップショット
+  bool reload();                             // 再読込（内容に変化があれば差し替え）
+  bool check();                              // 確認: 更新日時変化 or SIGHUP → 再読込
+  static void catch_hup();                   // SIGHUP ハンドラ登録
+
+private:
+  static void on_hup(int);                   // SIGHUP ハンドラ
+};
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,37 @@
+# 生成: 静的 EOP 一覧（libsun_moon_lite 用）
+# * 入力: LEAP_SEC.txt DUT1.txt（この順。空行は無視）
+# * 出力: eop_tbl.hpp（行の並びはファイルのまま。Time と同じく末尾から探索する）
+FNR == 1 { ++f }
+NF >= 2 && f == 1 { ls = ls sprintf("  {%d, %d},\n", $1 + 0, $2 + 0) }
+NF >= 2 && f == 2 {
+  v = $2
+  if (v !~ /[.eE]/) v = v ".0"
+  dut = dut sprintf("  {%d, %sf},\n", $1 + 0, v)
+  ver = $1 + 0
+}
+END {
+  print "// 自動生成（eop_tbl.awk: LEAP_SEC.txt, DUT1.txt から）。編集しないこと"
+  print "#ifndef SUN_MOON_EOP_TBL_HPP_"
+  print "#define SUN_MOON_EOP_TBL_HPP_"
+  print ""
+  print "#include <cstdint>"
+  print ""
+  print "namespace sun_moon {"
+  print ""
+  print "struct EopLs {"
+  print "  std::int32_t ymd;      // 適用開始日(YYYYMMDD)"
+  print "  std::int32_t utc_tai;  // UTC - TAI"
+  print "};"
+  print "struct EopDut {"
+  print "  std::int32_t ymd;      // 適用開始日(YYYYMMDD)"
+  print "  float        dut1;     // DUT1"
+  print "};"
+  print ""
+  printf "static constexpr EopLs kEopLs[] = {\n%s};\n", ls
+  printf "static constexpr EopDut kEopDut[] = {\n%s};\n", dut
+  printf "static constexpr std::uint64_t kEopVer = %d;  // 版数（DUT1 一覧の最終日付）\n", ver
+  print ""
+  print "}  // namespace sun_moon"
+  print ""
+  print "#endif"
+}
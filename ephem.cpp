@@ -0,0 +1,312 @@
+#include "ephem.hpp"
+
+#include <cmath>
+
+namespace sun_moon {
+
+// 定数
+static constexpr unsigned int kJstUtc = 9;                // JST - UTC (hours)
+static constexpr double       kPi     = atan(1.0) * 4.0;  // 円周率
+static constexpr double       kPi180  = kPi / 180.0;      // 円周率 / 180
+
+/*
+ * @brief      計算: 級数の和（表の並び順に加算）
+ *
+ * @param[in]  項の表 (Term[N])
+ * @param[in]  経過ユリウス年 (double)
+ * @return     Σ 振幅 × sin(位相 + 角速度 × jy) (double)
+ */
+template <std::size_t N>
+static double sum_terms(const Term (&t)[N], double jy) {
+  double v = 0.0;
+
+  for (const Term& e : t)
+    v += e.amp * std::sin(kPi180 * norm_ang(e.ph + e.rt * jy));
+
+  return v;
+}
+
+/*
+ * @brief       計算: 級数の和（n 点一括, 項の外側で点を回す）
+ *              (点毎の加算順は sum_terms と同じため、結果も同一になる)
+ *
+ * @param[in]   項の表 (Term[N])
+ * @param[in]   経過ユリウス年 (double[n])
+ * @param[in]   点数 (size_t)
+ * @param[out]  Σ 振幅 × sin(位相 + 角速度 × jy) (double[n])
+ * @return      none
+ */
+template <std::size_t N>
+static void sum_terms_n(const Term (&t)[N], const double* jy, std::size_t n,
+                        double* v) {
+  std::size_t i;
+
+  for (i = 0; i < n; ++i) v[i] = 0.0;
+  for (const Term& e : t) {
+    for (i = 0; i < n; ++i)
+      v[i] += e.amp * std::sin(kPi180 * norm_ang(e.ph + e.rt * jy[i]));
+  }
+}
+
+/*
+ * @brief   計算: 角度の正規化
+ *                (角度を 0 以上 360 未満にする)
+ *
+ * @param[in]  角度（正規化前） (double)
+ * @return     角度（正規化後） (double)
+ */
+double norm_ang(double ang_src) {
+  return ang_src - 360.0 * int(ang_src / 360.0);
+}
+
+#ifndef SUN_MOON_LITE
+/*
+ * @brief      計算: 2000年1月1日力学時正午からの経過日数
+ *             (JST 日付の 00:00:00 まで。ΔT は含まない)
+ *
+ * @param[in]  JST (time_t)
+ * @return     経過日数 (double)
+ */
+double day_progress(time_t jst) {
+  struct tm    t;
+  int          y;
+  unsigned int m;
+  unsigned int d;
+
+  // JST(UTC+9) の日付（プロセスのタイムゾーンによらない）
+  jst += time_t(kJstUtc * 3600);
+  gmtime_r(&jst, &t);
+  y = t.tm_year + 1900 - 2000;
+  m = t.tm_mon + 1;
+  d = t.tm_mday;
+  // 1月,2月は前年の13月,14月とする
+  if (m < 3) {
+    --y;
+    m += 12;
+  }
+
+  return 365.0 * y + 30.0 * m + d
+       - 33.5 - kJstUtc / 24.0
+       + int(3 * (m + 1) / 5.0)
+       + int(y / 4.0);
+}
+#endif
+
+/*
+ * @brief      計算: 太陽の黄経
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     黄経 (double)
+ */
+double lmd_sun(double jy) {
+  return sum_terms(kLmdSun, jy)
+       + (kLmdSunMain.amp - kLmdSunMainT * jy)
+       * std::sin(kPi180 * norm_ang(kLmdSunMain.ph + kLmdSunMain.rt * jy))
+       + norm_ang(kLmdSunMean.ph + kLmdSunMean.rt * jy);
+}
+
+/*
+ * @brief       計算: 太陽の黄経（n 点一括, 結果は lmd_sun と同一）
+ *
+ * @param[in]   経過ユリウス年 (double[n])
+ * @param[in]   点数 (size_t)
+ * @param[out]  黄経 (double[n])
+ * @return      none
+ */
+void lmd_sun_n(const double* jy, std::size_t n, double* v) {
+  sum_terms_n(kLmdSun, jy, n, v);
+  for (std::size_t i = 0; i < n; ++i) {
+    v[i] = v[i]
+         + (kLmdSunMain.amp - kLmdSunMainT * jy[i])
+         * std::sin(kPi180 * norm_ang(kLmdSunMain.ph + kLmdSunMain.rt * jy[i]))
+         + norm_ang(kLmdSunMean.ph + kLmdSunMean.rt * jy[i]);
+  }
+}
+
+/*
+ * @brief      計算: 太陽の距離
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     距離 (double)
+ */
+double dist_sun(double jy) {
+  double dist;
+
+  dist = sum_terms(kDistSun, jy)
+       + (kDistSunMain.amp - kDistSunMainT * jy)
+       * std::sin(kPi180 * norm_ang(kDistSunMain.ph + kDistSunMain.rt * jy));
+
+  return std::pow(10.0, dist);
+}
+
+/*
+ * @brief      計算: 月の黄緯
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     黄緯 (double)
+ */
+double bet_moon(double jy) {
+  double bm = sum_terms(kBetMoonB, jy);
+
+  return sum_terms(kBetMoon, jy)
+       + kBetMoonMain.amp
+       * std::sin(kPi180 * norm_ang(kBetMoonMain.ph + kBetMoonMain.rt * jy + bm));
+}
+
+/*
+ * @brief      計算: 月の黄経
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     黄経 (double)
+ */
+double lmd_moon(double jy) {
+  double am = sum_terms(kLmdMoonA, jy);
+
+  return sum_terms(kLmdMoon, jy)
+       + kLmdMoonMain.amp
+       * std::sin(kPi180 * norm_ang(kLmdMoonMain.ph + kLmdMoonMain.rt * jy + am))
+       + norm_ang(kLmdMoonMean.ph + kLmdMoonMean.rt * jy);
+}
+
+#ifndef SUN_MOON_LITE
+/*
+ * @brief       計算: 月の黄経（n 点一括, 結果は lmd_moon と同一）
+ *
+ * @param[in]   経過ユリウス年 (double[n])
+ * @param[in]   点数 (size_t)
+ * @param[out]  黄経 (double[n])
+ * @return      none
+ */
+void lmd_moon_n(const double* jy, std::size_t n, double* v) {
+  std::vector<double> am(n);
+
+  sum_terms_n(kLmdMoonA, jy, n, am.data());
+  sum_terms_n(kLmdMoon, jy, n, v);
+  for (std::size_t i = 0; i < n; ++i) {
+    v[i] = v[i]
+         + kLmdMoonMain.amp
+         * std::sin(kPi180 * norm_ang(kLmdMoonMain.ph + kLmdMoonMain.rt * jy[i] + am[i]))
+         + norm_ang(kLmdMoonMean.ph + kLmdMoonMean.rt * jy[i]);
+  }
+}
+#endif
+
+/*
+ * @brief      計算: 月の視差
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     視差 (double)
+ */
+double diff_moon(double jy) {
+  return sum_terms(kDiffMoon, jy);
+}
+
+/*
+ * @brief      計算: 黄道傾角
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @return     黄道傾角(度) (double)
+ */
+double obliquity(double jy) {
+  return 23.439291 - 0.000130042 * jy;
+}
+
+/*
+ * @brief      黄道座標 -> 赤道座標 変換
+ *
+ * @param[in]  経過ユリウス年 (double)
+ * @param[in]  黄道座標 (Coord)
+ * @return     赤道座標 (Coord)
+ */
+Coord ko2se(double jy, Coord cd_k) {
+  double ang_k;  // 黄道傾角
+  double lmd;    // 黄経(rad)
+  double bet;    // 黄緯(rad)
+  double a;
+  double b;
+  double c;
+  Coord  cd_s = {0.0, 0.0};
+
+  ang_k = obliquity(jy) * kPi180;
+  lmd = cd_k.lng * kPi180;  // 黄経
+  bet = cd_k.lat * kPi180;  // 黄緯
+  a =  cos(bet) * cos(lmd);
+  b = -sin(bet) * sin(ang_k)
+    +  cos(bet) * sin(lmd) * cos(ang_k);
+  c =  sin(bet) * cos(ang_k)
+    +  cos(bet) * sin(lmd) * sin(ang_k);
+  cd_s.lng = std::atan(b / a) / kPi180;
+  // aがマイナスのときは 90°< α < 270° → 180°加算する
+  if (a < 0.0) { cd_s.lng += 180.0; }
+  cd_s.lat = std::asin(c) / kPi180;
+
+  return cd_s;
+}
+
+#ifndef SUN_MOON_LITE
+/*
+ * @brief      初期化: 逐次評価
+ *
+ * @param[in]  項の表 (const Term*)
+ * @param[in]  項数 (size_t)
+ * @param[in]  開始時の経過ユリウス年 (double)
+ * @param[in]  1 刻みの経過ユリウス年 (double)
+ * @return     none
+ */
+void TermIter::init(const Term* t, std::size_t n, double jy, double djy) {
+  std::size_t i;
+  double a;
+
+  amp.resize(n);
+  s.resize(n);
+  c.resize(n);
+  ds.resize(n);
+  dc.resize(n);
+  for (i = 0; i < n; ++i) {
+    a      = kPi180 * norm_ang(t[i].ph + t[i].rt * jy);
+    amp[i] = t[i].amp;
+    s[i]   = std::sin(a);
+    c[i]   = std::cos(a);
+    ds[i]  = std::sin(kPi180 * t[i].rt * djy);
+    dc[i]  = std::cos(kPi180 * t[i].rt * djy);
+  }
+}
+
+/*
+ * @brief   計算: Σ 振幅 × sin（表の並び順に加算）
+ *
+ * @param   none
+ * @return  和 (double)
+ */
+double TermIter::sum() const {
+  double v = 0.0;
+
+  for (std::size_t i = 0; i < amp.size(); ++i) v += amp[i] * s[i];
+
+  return v;
+}
+
+/*
+ * @brief   移動: 1 刻み進める（加法定理による回転）
+ *
+ * @param   none
+ * @return  none
+ */
+void TermIter::next() {
+  double* ps = s.data();
+  double* pc = c.data();
+  const double* pds = ds.data();
+  const double* pdc = dc.data();
+  std::size_t n = s.size();
+  double s1;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    s1    = ps[i] * pdc[i] + pc[i] * pds[i];
+    pc[i] = pc[i] * pdc[i] - ps[i] * pds[i];
+    ps[i] = s1;
+  }
+}
+#endif
+
+}  // namespace sun_moon
+
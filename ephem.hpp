@@ -0,0 +1,64 @@
+#ifndef SUN_MOON_EPHEM_HPP_
+#define SUN_MOON_EPHEM_HPP_
+
+#include "ephem_tbl.hpp"
+
+#include <cstddef>
+#include <ctime>
+#ifndef SUN_MOON_LITE
+#include <vector>
+#endif
+
+namespace sun_moon {
+
+// 座標
+struct Coord {
+  double lat;
+  double lng;
+};
+
+// 日・月の位置の級数（Calc・時系列計算で共用）
+// * jy: 2000年1月1日力学時正午からの経過ユリウス年
+// * SUN_MOON_LITE 定義時（軽量版）は、ヒープ・タイムゾーンを使う関数・クラスを除く
+double norm_ang(double);            // 計算: 角度の正規化
+#ifndef SUN_MOON_LITE
+double day_progress(time_t);        // 計算: 2000年1月1日力学時正午からの経過日数
+#endif
+double lmd_sun(double);             // 計算: 太陽の黄経
+double dist_sun(double);            // 計算: 太陽の距離
+double bet_moon(double);            // 計算: 月の黄緯
+double lmd_moon(double);            // 計算: 月の黄経
+double diff_moon(double);           // 計算: 月の視差
+double obliquity(double);           // 計算: 黄道傾角(度)
+struct Coord ko2se(double, Coord);  // 変換: 黄道座標 -> 赤道座標
+void lmd_sun_n(const double*, std::size_t, double*);   // 計算: 太陽の黄経（n 点一括）
+#ifndef SUN_MOON_LITE
+void lmd_moon_n(const double*, std::size_t, double*);  // 計算: 月の黄経（n 点一括）
+
+// 級数の逐次評価
+// * 時刻が一定間隔で進む場合、各項の sin/cos を加法定理で 1 刻みずつ回転させる
+//   （項毎の三角関数呼び出しが不要。誤差は刻み数に比例して増えるため、
+//    呼び出し側で定期的に init し直すこと）
+class TermIter {
+  std::vector<double> amp;  // 振幅
+  std::vector<double> s;    // sin(現在の引数)
+  std::vector<double> c;    // cos(現在の引数)
+  std::vector<double> ds;   // sin(1 刻みの引数増分)
+  std::vector<double> dc;   // cos(1 刻みの引数増分)
+
+public:
+  void init(const Term*, std::size_t, double, double);  // 初期化: 表, 項数, jy, 刻み(年)
+  template <std::size_t N> void init(const Term (&t)[N], double jy, double djy) {
+    init(t, N, jy, djy);
+  }
+  double sum() const;                                // 計算: Σ 振幅 × sin
+  double get_sin(std::size_t i) const { return s[i]; }  // 取得: 第 i 項の sin
+  double get_cos(std::size_t i) const { return c[i]; }  // 取得: 第 i 項の cos
+  void next();                                       // 移動: 1 刻み進める
+};
+#endif
+
+}  // namespace sun_moon
+
+#endif
+
@@ -1,11 +1,24 @@
 #include "file.hpp"
 
+#include <sys/stat.h>
+
 namespace sun_moon {
 
 // 定数
 constexpr char kFLeapSec[13] = "LEAP_SEC.txt";
 constexpr char kFDut1[9]     = "DUT1.txt";
 
+/*
+ * @brief      ファイルパス生成
+ *
+ * @param[in]  ファイル名 (const char*)
+ * @return     ファイルパス (string)
+ */
+std::string File::path(const char* f) {
+  if (dir.empty()) return f;
+  return dir + (dir.back() == '/' ? "" : "/") + f;
+}
+
 /*
  * @brief       UTC - TAI (協定世界時と国際原子時の差 = うるう秒の総和) 一覧取得
  *
@@ -13,7 +26,7 @@ constexpr char kFDut1[9]     = "DUT1.txt";
  * @return      <none>
  */
 bool File::get_leap_sec_list(std::vector<std::vector<std::string>>& data) {
-  std::string f(kFLeapSec);  // ファイル名
+  std::string f(path(kFLeapSec));  // ファイル名
   std::string buf;           // 1行分バッファ
 
   try {
@@ -45,7 +58,7 @@ bool File::get_leap_sec_list(std::vector<std::vector<std::string>>& data) {
  * @return      <none>
  */
 bool File::get_dut1_list(std::vector<std::vector<std::string>>& data) {
-  std::string f(kFDut1);  // ファイル名
+  std::string f(path(kFDut1));  // ファイル名
   std::string buf;        // 1行分バッファ
 
   try {
@@ -70,5 +83,27 @@ bool File::get_dut1_list(std::vector<std::vector<std::string>>& data) {
   return true;
 }
 
+/*
+ * @brief       うるう秒・DUT1 ファイルの更新日時取得
+ *
+ * @param[ref]  更新日時: うるう秒ファイル (timespec)
+ * @param[ref]  更新日時: DUT1 ファイル (timespec)
+ * @return      成否 (bool)
+ */
+bool File::get_mtime(struct timespec& ts_ls, struct timespec& ts_dut) {
+  struct stat st;
+
+  try {
+    if (stat(path(kFLeapSec).c_str(), &st) != 0) return false;
+    ts_ls = st.st_mtim;
+    if (stat(path(kFDut1).c_str(), &st) != 0) return false;
+    ts_dut = st.st_mtim;
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
 }  // namespace sun_moon
 
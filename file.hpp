@@ -1,6 +1,7 @@
 #ifndef SUN_MOON_FILE_HPP_
 #define SUN_MOON_FILE_HPP_
 
+#include <ctime>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -9,10 +10,17 @@
 namespace sun_moon {
 
 class File {
+  std::string dir;  // ファイル格納ディレクトリ（空文字列はカレント）
 
 public:
+  File() {}                                        // コンストラクタ
+  explicit File(const std::string& dir) : dir(dir) {}  // コンストラクタ（ディレクトリ指定）
   bool get_leap_sec_list(std::vector<std::vector<std::string>>&);  // 取得: うるう秒一覧
   bool get_dut1_list(std::vector<std::vector<std::string>>&);      // 取得: DUT1 一覧
+  bool get_mtime(struct timespec&, struct timespec&);               // 取得: 更新日時
+
+private:
+  std::string path(const char*);                                    // ファイルパス生成
 };
 
 }  // namespace sun_moon
@@ -0,0 +1,659 @@
+#include "format.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+
+namespace sun_moon {
+
+// 定数
+static constexpr std::size_t kBufSize = 1 << 20;  // 書き出し単位 (bytes)
+static constexpr double kPow10[] = {
+  1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9
+};
+// 2 桁表 ("00" - "99")
+static constexpr char kDigit2[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+// 出・南中・入の順に出力
+static constexpr unsigned int kOrd[3] = {0, 2, 1};
+static constexpr const char* kEvName[3] = {"rise", "set", "transit"};
+// 計算状態の名称（CalcSt の順, 機械向け・人向け）
+static constexpr const char* kStName[5] = {
+  "ok", "no_event", "bad_input", "failed", "no_conv"
+};
+static constexpr const char* kStHuman[5] = {
+  "正常", "なし", "入力値不正", "計算失敗", "収束せず"
+};
+// 薄明等: 時刻順の出力（区分(Twilight::cr の添字), 朝(0)／夕(1), 名称）
+static constexpr struct {
+  unsigned int i;
+  unsigned int pm;
+  const char*  name;
+} kTwiOrd[(kNumTwi + 1) * 2] = {
+  {5, 0, "astro_dawn"}, {4, 0, "nautical_dawn"}, {3, 0, "civil_dawn"},
+  {2, 0, "blue_end"},   {0, 0, "sunrise"},       {1, 0, "golden_end"},
+  {1, 1, "golden_start"}, {0, 1, "sunset"},      {2, 1, "blue_start"},
+  {3, 1, "civil_dusk"}, {4, 1, "nautical_dusk"}, {5, 1, "astro_dusk"},
+};
+
+/*
+ * @brief       変換: 名称 -> 出力形式
+ *
+ * @param[in]   名称 ("human", "line", "csv", "jsonl", "bin", "geojson") (string)
+ * @param[ref]  出力形式 (Layout)
+ * @return      成否 (bool)
+ */
+bool parse_layout(const std::string& name, Layout& ly) {
+  if      (name == "human") { ly = kLyHuman; }
+  else if (name == "line")  { ly = kLyLine;  }
+  else if (name == "csv")   { ly = kLyCsv;   }
+  else if (name == "jsonl") { ly = kLyJson;  }
+  else if (name == "bin")   { ly = kLyBin;   }
+  else if (name == "geojson") { ly = kLyGeoJson; }
+  else                      { return false;  }
+
+  return true;
+}
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  出力先ファイルディスクリプタ (-1: バッファに保持するのみ) (int)
+ * @param[in]  出力形式 (Layout)
+ */
+Formatter::Formatter(int fd, Layout ly)
+    : fd(fd), ly(ly), buf(kBufSize + 4096), len(0), day0(0), ymd{-1, 0, 0} {}
+
+/*
+ * @brief  デストラクタ（残りを書き出し）
+ *
+ * @param  none
+ */
+Formatter::~Formatter() {
+  flush();
+}
+
+/*
+ * @brief   出力: 見出し行（CSV のみ）
+ *
+ * @param   none
+ * @return  none
+ */
+void Formatter::put_head() {
+  static constexpr char kHead[] =
+    "date,lat,lng,ht,"
+    "sun_rise,sun_rise_az,sun_transit,sun_transit_alt,sun_set,sun_set_az,"
+    "moon_rise,moon_rise_az,moon_transit,moon_transit_alt,moon_set,moon_set_az,"
+    "moon_phase_angle,moon_illum,moon_age,moon_limb,eop_ver\n";
+
+  if (ly == kLyCsv) put_str(kHead, sizeof(kHead) - 1);
+}
+
+/*
+ * @brief      判定: イベントの状態
+ *             (状態の指定がなければ計算結果から判定（res_ev_st）)
+ *
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 指定なし)
+ * @param[in]  イベント番号 (0〜2: 日の出・入・南中, 3〜5: 月の出・入・南中) (unsigned int)
+ * @return     状態 (CalcSt)
+ */
+static CalcSt ev_st(const Result& res, const ResSt* rs, unsigned int i) {
+  if (rs != nullptr) return rs->st != kStOk ? rs->st : rs->ev[i];
+
+  return res_ev_st(res, i);
+}
+
+/*
+ * @brief      出力: 計算結果 1 件
+ *             (計算できなかった件は結果の値を出力せず、状態のみを示す)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 計算結果から判定)
+ * @return     none
+ */
+void Formatter::put(const Query& q, const Result& res, const ResSt* rs) {
+  switch (ly) {
+  case kLyHuman: put_human(q, res, rs); break;
+  case kLyLine:  put_line(q, res, rs);  break;
+  case kLyCsv:   put_csv(q, res, rs);   break;
+  case kLyJson:  put_json(q, res, rs);  break;
+  case kLyBin:
+  case kLyGeoJson: break;
+  }
+  if (fd >= 0 && len >= kBufSize) flush();
+}
+
+/*
+ * @brief      出力: 文字列
+ *
+ * @param[in]  文字列 (const char*)
+ * @param[in]  バイト数 (size_t)
+ * @return     none
+ */
+void Formatter::put_str(const char* s, std::size_t n) {
+  reserve(n);
+  std::memcpy(buf.data() + len, s, n);
+  len += n;
+}
+
+/*
+ * @brief      出力: 整数
+ *
+ * @param[in]  値 (int64_t)
+ * @return     none
+ */
+void Formatter::put_int(std::int64_t v) {
+  reserve(24);
+  len = std::to_chars(buf.data() + len, buf.data() + buf.size(), v).ptr
+      - buf.data();
+}
+
+/*
+ * @brief      出力: 整数（0 埋め）
+ *
+ * @param[in]  値 (uint64_t)
+ * @param[in]  最小桁数 (unsigned int)
+ * @return     none
+ */
+void Formatter::put_uint(std::uint64_t v, unsigned int w) {
+  char  tmp[24];
+  char* p = tmp + sizeof(tmp);  // 下位桁から格納
+
+  while (v >= 100) {
+    p -= 2;
+    std::memcpy(p, kDigit2 + (v % 100) * 2, 2);
+    v /= 100;
+  }
+  if (v >= 10) {
+    p -= 2;
+    std::memcpy(p, kDigit2 + v * 2, 2);
+  } else {
+    *--p = char('0' + v);
+  }
+  while (tmp + sizeof(tmp) - p < w) *--p = '0';
+  put_str(p, tmp + sizeof(tmp) - p);
+}
+
+/*
+ * @brief      出力: 固定小数点
+ *             (値を 10^桁 倍して整数に丸め、整数部・小数部を個別に出力)
+ *
+ * @param[in]  値 (double)
+ * @param[in]  小数桁数 (unsigned int, 最大 9)
+ * @param[in]  右寄せ幅 (unsigned int, 0 は寄せなし)
+ * @return     none
+ */
+void Formatter::put_fixed(double v, unsigned int prec, unsigned int w) {
+  char  tmp[48];
+  char* e = tmp + sizeof(tmp);
+  char* p = e;
+  bool  neg = std::signbit(v);
+  std::uint64_t r;  // 10^桁 倍して丸めた値
+  unsigned int  i;
+
+  if (!std::isfinite(v) || std::abs(v) >= 1.0e15) {
+    const char* s = std::isnan(v) ? (neg ? "-nan" : "nan")
+                  : std::isinf(v) ? (neg ? "-inf" : "inf") : nullptr;
+    if (s == nullptr) {
+      // 桁あふれする巨大値は整数部のみ
+      auto r = std::to_chars(tmp, e, std::int64_t(v));
+      p = tmp;
+      e = r.ptr;
+    } else {
+      p = const_cast<char*>(s);
+      e = p + std::strlen(s);
+    }
+    for (i = e - p; i < w; ++i) put_chr(' ');
+    put_str(p, e - p);
+    return;
+  }
+  r = std::llround(std::abs(v) * kPow10[prec]);
+  for (i = 0; i < prec; ++i) {
+    *--p = char('0' + r % 10);
+    r /= 10;
+  }
+  if (prec > 0) *--p = '.';
+  do {
+    *--p = char('0' + r % 10);
+    r /= 10;
+  } while (r > 0);
+  if (neg) *--p = '-';
+  for (i = e - p; i < w; ++i) *--p = ' ';
+  put_str(p, e - p);
+}
+
+/*
+ * @brief      出力: 日付
+ *
+ * @param[in]  時刻 (time_t)
+ * @param[in]  区切り文字 ('\0' は区切りなし) (char)
+ * @return     none
+ */
+void Formatter::put_date(time_t ts, char sep) {
+  int t[6];  // 年月日時分秒
+
+  split(ts, t);
+  if (t[0] < 0) put_chr('-');  // 紀元前（天文学的年）
+  put_uint(std::abs(t[0]), 4);
+  if (sep) put_chr(sep);
+  put_uint(t[1], 2);
+  if (sep) put_chr(sep);
+  put_uint(t[2], 2);
+}
+
+/*
+ * @brief      出力: 時刻 HH:MM:SS（秒未満は切り捨て）
+ *
+ * @param[in]  時刻 (timespec)
+ * @return     none
+ */
+void Formatter::put_hms(const struct timespec& ts) {
+  int   t[6];  // 年月日時分秒
+  char* p;
+
+  split(ts.tv_sec, t);
+  reserve(8);
+  p = buf.data() + len;
+  std::memcpy(p,     kDigit2 + t[3] * 2, 2);
+  p[2] = ':';
+  std::memcpy(p + 3, kDigit2 + t[4] * 2, 2);
+  p[5] = ':';
+  std::memcpy(p + 6, kDigit2 + t[5] * 2, 2);
+  len += 8;
+}
+
+/*
+ * @brief   出力: バッファ内容を書き出し
+ *
+ * @param   none
+ * @return  成否 (bool)
+ */
+bool Formatter::flush() {
+  std::size_t off = 0;  // 書き出し済みバイト数
+  ssize_t s;
+
+  if (fd < 0) return true;
+  while (off < len) {
+    s = ::write(fd, buf.data() + off, len - off);
+    if (s < 0) {
+      if (errno == EINTR) continue;
+      len = 0;
+      return false;
+    }
+    off += s;
+  }
+  len = 0;
+
+  return true;
+}
+
+/*
+ * @brief   取得: バッファ内容（取得後クリア）
+ *
+ * @param   none
+ * @return  バッファ内容 (string)
+ */
+std::string Formatter::take() {
+  std::string s(buf.data(), len);
+
+  len = 0;
+
+  return s;
+}
+
+/*
+ * @brief      バッファ拡張
+ *             (出力先があれば書き出して空け、なければ拡張する)
+ *
+ * @param[in]  必要バイト数 (size_t)
+ * @return     none
+ */
+void Formatter::grow(std::size_t n) {
+  if (fd >= 0) flush();
+  if (len + n > buf.size()) buf.resize((len + n) * 2);
+}
+
+/*
+ * @brief       分解: 時刻 -> 年月日時分秒（JST）
+ *              (直前と同じ日であれば localtime_jst を呼ばずに算出する)
+ *
+ * @param[in]   時刻 (time_t)
+ * @param[ref]  年月日時分秒 (int[6])
+ * @return      none
+ */
+void Formatter::split(time_t ts, int* t) {
+  struct tm tm;
+  time_t    sod;  // 当日 00:00:00 からの秒数
+
+  if (ymd[0] < 0 || ts < day0 || ts >= day0 + 86400) {
+    localtime_jst(ts, tm);
+    ymd[0] = tm.tm_year + 1900;
+    ymd[1] = tm.tm_mon + 1;
+    ymd[2] = tm.tm_mday;
+    day0 = ts - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+  }
+  sod  = ts - day0;
+  t[0] = ymd[0];
+  t[1] = ymd[1];
+  t[2] = ymd[2];
+  t[3] = sod / 3600;
+  t[4] = sod / 60 % 60;
+  t[5] = sod % 60;
+}
+
+/*
+ * @brief      出力: 従来の表示形式
+ *             (計算できなかった件は見出しの後に "ERR 理由" の 1 行のみ)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 計算結果から判定)
+ * @return     none
+ */
+void Formatter::put_human(const Query& q, const Result& res, const ResSt* rs) {
+  static constexpr const char* kName[2][3] = {
+    {"日の出 ", "日の入 ", "日南中 "}, {"月の出 ", "月の入 ", "月南中 "}
+  };
+  static constexpr const char* kAh[3] = {" (方位角 ", " (方位角 ", " (　高度 "};
+
+  put_chr('[');
+  put_date(q.jst.tv_sec, '-');
+  put_str("JST ", 4);
+  put_fixed(std::abs(q.lat), 4);
+  put_chr(q.lat < 0.0 ? 'S' : 'N');
+  put_chr(' ');
+  put_fixed(std::abs(q.lng), 4);
+  put_chr(q.lng < 0.0 ? 'W' : 'E');
+  put_chr(' ');
+  put_fixed(q.ht, 4);
+  put_str("m]\n", 3);
+  if (rs != nullptr && rs->st != kStOk) {
+    put_str("ERR ");
+    put_str(kStHuman[rs->st]);
+    put_chr('\n');
+    return;
+  }
+  for (unsigned int b = 0; b < 2; ++b) {
+    const TmAh* ev = b == 0 ? res.sun : res.moon;
+    for (unsigned int k : kOrd) {
+      CalcSt st = ev_st(res, rs, b * 3 + k);
+      put_str(kName[b][k]);
+      if (st == kStOk) {
+        put_hms(ev[k].time);
+        put_str(kAh[k]);
+        put_fixed(ev[k].ah, 2, 6);
+        put_str("°)\n");
+      } else if (st == kStNoEvent) {
+        put_str("--:--:--");
+        put_str(kAh[k]);
+        put_str("---.--°)\n");
+      } else {
+        put_str("ERR     ");
+        put_str(kAh[k]);
+        put_str("---.--°) ");
+        put_str(kStHuman[st]);
+        put_chr('\n');
+      }
+    }
+  }
+  put_str("月　相 位相角 ");
+  put_fixed(res.phase.ph_ang, 2, 6);
+  put_str("° 輝面比 ");
+  put_fixed(res.phase.illum, 3);
+  put_str(" 月齢 ");
+  put_fixed(res.phase.age, 1);
+  put_str(" 明縁 ");
+  put_fixed(res.phase.limb, 2, 6);
+  put_str("°\n");
+}
+
+/*
+ * @brief      出力: 1 件 1 行（空白区切り）
+ *             ("日付 緯度 経度 標高 日の出 方位角 日南中 高度 日の入 方位角
+ *               月の出 方位角 月南中 高度 月の入 方位角
+ *               位相角 輝面比 月齢 明縁の位置角 EOP版数")
+ *             (イベントなしは "--:--:-- ---.--", 収束しないイベントは "ERR ---.--",
+ *              計算できなかった件は "日付 緯度 経度 標高 ERR 理由")
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 計算結果から判定)
+ * @return     none
+ */
+void Formatter::put_line(const Query& q, const Result& res, const ResSt* rs) {
+  put_date(q.jst.tv_sec, '\0');
+  put_chr(' ');
+  put_fixed(q.lat, 4);
+  put_chr(' ');
+  put_fixed(q.lng, 4);
+  put_chr(' ');
+  put_fixed(q.ht, 4);
+  if (rs != nullptr && rs->st != kStOk) {
+    put_str(" ERR ", 5);
+    put_str(kStName[rs->st]);
+    put_chr('\n');
+    return;
+  }
+  for (unsigned int b = 0; b < 2; ++b) {
+    const TmAh* ev = b == 0 ? res.sun : res.moon;
+    for (unsigned int k : kOrd) {
+      CalcSt st = ev_st(res, rs, b * 3 + k);
+      if (st == kStOk) {
+        put_chr(' ');
+        put_hms(ev[k].time);
+        put_chr(' ');
+        put_fixed(ev[k].ah, 2);
+      } else if (st == kStNoEvent) {
+        put_str(" --:--:-- ---.--", 16);
+      } else {
+        put_str(" ERR ---.--", 11);
+      }
+    }
+  }
+  put_chr(' ');
+  put_fixed(res.phase.ph_ang, 2);
+  put_chr(' ');
+  put_fixed(res.phase.illum, 3);
+  put_chr(' ');
+  put_fixed(res.phase.age, 1);
+  put_chr(' ');
+  put_fixed(res.phase.limb, 2);
+  put_chr(' ');
+  put_uint(res.eop_ver, 1);
+  put_chr('\n');
+}
+
+/*
+ * @brief      出力: CSV（イベントなしは空欄）
+ *             (収束しないイベントは時刻欄が "ERR"。計算できなかった件は全イベントの
+ *              時刻欄が "ERR" で、他の結果欄は空欄)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 計算結果から判定)
+ * @return     none
+ */
+void Formatter::put_csv(const Query& q, const Result& res, const ResSt* rs) {
+  put_date(q.jst.tv_sec, '\0');
+  put_chr(',');
+  put_fixed(q.lat, 4);
+  put_chr(',');
+  put_fixed(q.lng, 4);
+  put_chr(',');
+  put_fixed(q.ht, 4);
+  for (unsigned int b = 0; b < 2; ++b) {
+    const TmAh* ev = b == 0 ? res.sun : res.moon;
+    for (unsigned int k : kOrd) {
+      CalcSt st = ev_st(res, rs, b * 3 + k);
+      if (st == kStOk) {
+        put_chr(',');
+        put_hms(ev[k].time);
+        put_chr(',');
+        put_fixed(ev[k].ah, 2);
+      } else if (st == kStNoEvent) {
+        put_str(",,", 2);
+      } else {
+        put_str(",ERR,", 5);
+      }
+    }
+  }
+  if (rs != nullptr && rs->st != kStOk) {
+    put_str(",,,,,\n", 6);
+    return;
+  }
+  put_chr(',');
+  put_fixed(res.phase.ph_ang, 2);
+  put_chr(',');
+  put_fixed(res.phase.illum, 3);
+  put_chr(',');
+  put_fixed(res.phase.age, 1);
+  put_chr(',');
+  put_fixed(res.phase.limb, 2);
+  put_chr(',');
+  put_uint(res.eop_ver, 1);
+  put_chr('\n');
+}
+
+/*
+ * @brief      出力: JSON Lines（イベントなしは null）
+ *             (収束しないイベントは {"status":"no_conv"}。計算できなかった件は
+ *              日付・地点と "status" のみ)
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Result)
+ * @param[in]  計算状態 (const ResSt*, nullptr: 計算結果から判定)
+ * @return     none
+ */
+void Formatter::put_json(const Query& q, const Result& res, const ResSt* rs) {
+  put_str("{\"date\":\"");
+  put_date(q.jst.tv_sec, '-');
+  put_str("\",\"lat\":");
+  put_fixed(q.lat, 4);
+  put_str(",\"lng\":");
+  put_fixed(q.lng, 4);
+  put_str(",\"ht\":");
+  put_fixed(q.ht, 4);
+  if (rs != nullptr && rs->st != kStOk) {
+    put_str(",\"status\":\"");
+    put_str(kStName[rs->st]);
+    put_str("\"}\n");
+    return;
+  }
+  for (unsigned int b = 0; b < 2; ++b) {
+    const TmAh* ev = b == 0 ? res.sun : res.moon;
+    put_str(b == 0 ? ",\"sun\":{" : "},\"moon\":{");
+    for (unsigned int k : kOrd) {
+      CalcSt st = ev_st(res, rs, b * 3 + k);
+      if (k != kOrd[0]) put_chr(',');
+      put_chr('"');
+      put_str(kEvName[k]);
+      if (st == kStNoEvent) {
+        put_str("\":null");
+        continue;
+      }
+      if (st != kStOk) {
+        put_str("\":{\"status\":\"");
+        put_str(kStName[st]);
+        put_str("\"}");
+        continue;
+      }
+      put_str("\":{\"time\":\"");
+      put_hms(ev[k].time);
+      put_str(k == 2 ? "\",\"alt\":" : "\",\"az\":");
+      put_fixed(ev[k].ah, 2);
+      put_chr('}');
+    }
+  }
+  put_str("},\"phase\":{\"angle\":");
+  put_fixed(res.phase.ph_ang, 2);
+  put_str(",\"illum\":");
+  put_fixed(res.phase.illum, 3);
+  put_str(",\"age\":");
+  put_fixed(res.phase.age, 1);
+  put_str(",\"limb\":");
+  put_fixed(res.phase.limb, 2);
+  put_str("},\"eop_ver\":");
+  put_uint(res.eop_ver, 1);
+  put_str("}\n");
+}
+
+/*
+ * @brief   出力: 見出し行（薄明等, CSV のみ）
+ *
+ * @param   none
+ * @return  none
+ */
+void Formatter::put_twi_head() {
+  if (ly != kLyCsv) return;
+  put_str("date,lat,lng,ht");
+  for (const auto& o : kTwiOrd) {
+    put_chr(',');
+    put_str(o.name);
+    put_chr(',');
+    put_str(o.name);
+    put_str("_az", 3);
+  }
+  put_str(",eop_ver\n");
+}
+
+/*
+ * @brief      出力: 計算結果 1 件（薄明等, 時刻順。通過なしは line: "--:--:-- ---.--",
+ *             csv: 空欄, jsonl: null）
+ *
+ * @param[in]  問い合わせ (Query)
+ * @param[in]  計算結果 (Twilight)
+ * @return     none
+ */
+void Formatter::put(const Query& q, const Twilight& tw) {
+  char sep = ly == kLyCsv ? ',' : ' ';
+
+  if (ly == kLyJson) {
+    put_str("{\"date\":\"");
+    put_date(q.jst.tv_sec, '-');
+    put_str("\",\"lat\":");
+  } else {
+    put_date(q.jst.tv_sec, '\0');
+    put_chr(sep);
+  }
+  put_fixed(q.lat, 4);
+  put_str(ly == kLyJson ? ",\"lng\":" : &sep, ly == kLyJson ? 7 : 1);
+  put_fixed(q.lng, 4);
+  put_str(ly == kLyJson ? ",\"ht\":" : &sep, ly == kLyJson ? 6 : 1);
+  put_fixed(q.ht, 4);
+  for (const auto& o : kTwiOrd) {
+    const TmAh& ev = o.pm == 0 ? tw.cr[o.i].am : tw.cr[o.i].pm;
+    if (ly == kLyJson) {
+      put_str(",\"");
+      put_str(o.name);
+      if (ev.ah < 0.0) {
+        put_str("\":null");
+        continue;
+      }
+      put_str("\":{\"time\":\"");
+      put_hms(ev.time);
+      put_str("\",\"az\":");
+      put_fixed(ev.ah, 2);
+      put_chr('}');
+    } else if (ev.ah < 0.0) {
+      put_str(ly == kLyCsv ? ",," : " --:--:-- ---.--", ly == kLyCsv ? 2 : 16);
+    } else {
+      put_chr(sep);
+      put_hms(ev.time);
+      put_chr(sep);
+      put_fixed(ev.ah, 2);
+    }
+  }
+  put_str(ly == kLyJson ? ",\"eop_ver\":" : &sep, ly == kLyJson ? 11 : 1);
+  put_uint(tw.eop_ver, 1);
+  put_str(ly == kLyJson ? "}\n" : "\n");
+  if (fd >= 0 && len >= kBufSize) flush();
+}
+
+}  // namespace sun_moon
+
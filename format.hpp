@@ -0,0 +1,72 @@
+#ifndef SUN_MOON_FORMAT_HPP_
+#define SUN_MOON_FORMAT_HPP_
+
+#include "engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 出力形式
+enum Layout : unsigned int {
+  kLyHuman = 0,  // 従来の表示形式（1 件 7 行）
+  kLyLine,       // 1 件 1 行（空白区切り）
+  kLyCsv,        // CSV
+  kLyJson,       // JSON Lines
+  kLyBin,        // 列形式バイナリ（ColWriter で出力）
+  kLyGeoJson,    // GeoJSON（等高度線モードのみ）
+};
+
+bool parse_layout(const std::string&, Layout&);  // 変換: 名称 -> 出力形式
+
+// 結果出力
+// * 再利用するバッファへ直接書き込み、一定量たまったら write(2) でまとめて出力
+// * 数値は to_chars と 2 桁表で変換（iostream・一時文字列を使わない）
+class Formatter {
+  int               fd;     // 出力先（-1 の場合はバッファに保持するのみ）
+  Layout            ly;     // 出力形式
+  std::vector<char> buf;    // 出力バッファ
+  std::size_t       len;    // 使用済みバイト数
+  time_t            day0;   // 日付キャッシュ: 当日 00:00:00
+  int               ymd[3]; // 日付キャッシュ: 年月日
+
+public:
+  Formatter(int, Layout);  // コンストラクタ
+  ~Formatter();            // デストラクタ
+  void put_head();                             // 出力: 見出し行（CSV のみ）
+  void put(const Query&, const Result&, const ResSt* = nullptr);
+                                               // 出力: 計算結果 1 件（計算状態付き）
+  void put_twi_head();                         // 出力: 見出し行（薄明等, CSV のみ）
+  void put(const Query&, const Twilight&);     // 出力: 計算結果 1 件（薄明等）
+  void put_str(const char*, std::size_t);      // 出力: 文字列
+  void put_str(const char* s) { put_str(s, std::strlen(s)); }
+  void put_str(const std::string& s) { put_str(s.data(), s.size()); }
+  void put_chr(char c) { reserve(1); buf[len++] = c; }
+  void put_int(std::int64_t);                  // 出力: 整数
+  void put_uint(std::uint64_t, unsigned int);  // 出力: 整数（0 埋め桁数指定）
+  void put_fixed(double, unsigned int, unsigned int = 0);
+                                               // 出力: 固定小数点（小数桁, 右寄せ幅）
+  void put_date(time_t, char);                 // 出力: 日付（区切り文字, '\0' は区切りなし）
+  void put_hms(const struct timespec&);        // 出力: 時刻 HH:MM:SS
+  bool flush();                                // 出力: バッファ内容を書き出し
+  std::string take();                          // 取得: バッファ内容（取得後クリア）
+
+private:
+  void reserve(std::size_t n) { if (len + n > buf.size()) grow(n); }
+  void grow(std::size_t);                      // バッファ拡張（または書き出し）
+  void split(time_t, int*);                    // 分解: 時刻 -> 年月日時分秒
+  void put_human(const Query&, const Result&, const ResSt*);
+  void put_line(const Query&, const Result&, const ResSt*);
+  void put_csv(const Query&, const Result&, const ResSt*);
+  void put_json(const Query&, const Result&, const ResSt*);
+};
+
+}  // namespace sun_moon
+
+#endif
+
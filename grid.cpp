@@ -0,0 +1,371 @@
+#include "grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+/*
+ * @brief      判定: 状態が同じ（件が正常で、各イベントの状態が一致）
+ *             (月の出入がない日・極地方で解が求まらない・収束しない等の区別を含む)
+ *
+ * @param[in]  計算状態 (ResSt)
+ * @param[in]  計算状態 (ResSt)
+ * @return     同じ (bool)
+ */
+bool same_st(const sun_moon::ResSt& a, const sun_moon::ResSt& b) {
+  if (a.st != sun_moon::kStOk || b.st != sun_moon::kStOk) return false;
+  for (unsigned int k = 0; k < 6; ++k) {
+    if (a.ev[k] != b.ev[k]) return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      変換: 時刻 -> 当日 00:00:00 からの経過秒数
+ *
+ * @param[in]  時刻 (timespec)
+ * @param[in]  当日 00:00:00 (time_t)
+ * @return     経過秒数 (double)
+ */
+double to_rel(const struct timespec& ts, time_t jst) {
+  return double(ts.tv_sec - jst) + ts.tv_nsec * 1.0e-9;
+}
+
+}  // namespace
+
+namespace sun_moon {
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  範囲 (GridSpec)
+ */
+Grid::Grid(const GridSpec& spec) : spec(spec), cur(0), lim(0) {
+  struct tm t;
+
+  try {
+    if (!(spec.step > 0.0) || spec.lat_1 < spec.lat_0 || spec.lng_1 < spec.lng_0
+        || spec.d_1.tv_sec < spec.d_0.tv_sec)
+      throw std::invalid_argument("invalid grid");
+    // 端点を含むよう、丸め誤差分の余裕をみて点数を求める
+    n_lat = std::floor((spec.lat_1 - spec.lat_0) / spec.step + 1.0e-9) + 1;
+    n_lng = std::floor((spec.lng_1 - spec.lng_0) / spec.step + 1.0e-9) + 1;
+    // 各日の JST（mktime_jst で日を進める）
+    localtime_jst(spec.d_0.tv_sec, t);
+    for (;;) {
+      time_t ts = mktime_jst(t);
+      if (ts > spec.d_1.tv_sec) break;
+      days.push_back(ts);
+      ++t.tm_mday;
+    }
+    lim = size();
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      取得: 行番号の問い合わせ
+ *
+ * @param[in]  行番号 (uint64_t)
+ * @return     入力行 (Row)
+ */
+Row Grid::row(std::uint64_t seq) {
+  Row r;
+  std::uint64_t i_pt = seq % (n_lat * n_lng);  // 日内の点番号
+
+  r.seq  = seq;
+  r.line = 0;
+  r.q.jst.tv_sec  = days[seq / (n_lat * n_lng)];
+  r.q.jst.tv_nsec = 0;
+  r.q.lat = spec.lat_0 + spec.step * (i_pt / n_lng);
+  r.q.lng = spec.lng_0 + spec.step * (i_pt % n_lng);
+  r.q.ht  = spec.ht;
+
+  return r;
+}
+
+/*
+ * @brief      設定: 生成する行番号の範囲（分割実行用）
+ *
+ * @param[in]  開始行番号（含む） (uint64_t)
+ * @param[in]  終了行番号（含まない） (uint64_t)
+ * @return     none
+ */
+void Grid::limit(std::uint64_t b, std::uint64_t e) {
+  lim = std::min(e, size());
+  cur = std::min(b, lim);
+}
+
+/*
+ * @brief       読込: 最大 n 件
+ *
+ * @param[ref]  読込結果 (vector<Row>, 追記)
+ * @param[in]   最大件数 (size_t)
+ * @return      読込件数（0 の場合は終了） (size_t)
+ */
+std::size_t Grid::read(std::vector<Row>& rows, std::size_t n) {
+  std::size_t cnt = 0;
+
+  while (cnt < n && cur < lim) {
+    rows.push_back(row(cur++));
+    ++cnt;
+  }
+
+  return cnt;
+}
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  格子点 (Grid)
+ * @param[in]  許容誤差(秒) (double)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>)
+ */
+GridAdapt::GridAdapt(Grid& grid, double tol, std::shared_ptr<const EopTable> eop)
+    : grid(grid), tol_t(tol), tol_a(tol * 360.0 / 86400.0), eop(eop),
+      n_lng(grid.get_n_lng()), day(0), i_0(0), jst(0), n_ex(0) {
+  try {
+    res.resize((kCell + 1) * n_lng);
+    rst.resize((kCell + 1) * n_lng);
+    st.reset(new std::atomic<unsigned char>[(kCell + 1) * n_lng]);
+    for (std::uint64_t k = 0; k < (kCell + 1) * n_lng; ++k) st[k] = 0;
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      開始: 帯
+ *             (同じ日の次の帯の場合は、前の帯の最終行（次の帯の先頭行）の厳密値を引き継ぐ)
+ *
+ * @param[in]  日の番号 (uint64_t)
+ * @param[in]  緯度方向の先頭番号 (kCell の倍数) (uint64_t)
+ * @return     none
+ */
+void GridAdapt::begin_band(std::uint64_t d, std::uint64_t i) {
+  bool f_cont = d == day && i == i_0 + kCell;  // 前の帯の続き
+  std::uint64_t j;
+  std::uint64_t r;
+
+  try {
+    for (j = 0; j < n_lng; ++j) {
+      st[j] = f_cont && st[kCell * n_lng + j] == 1 ? 1 : 0;
+      if (st[j] == 1) {
+        res[j] = res[kCell * n_lng + j];
+        rst[j] = rst[kCell * n_lng + j];
+      }
+    }
+    for (r = 1; r <= kCell; ++r) {
+      for (j = 0; j < n_lng; ++j) st[r * n_lng + j] = 0;
+    }
+    day = d;
+    i_0 = i;
+    jst = grid.row(d * grid.get_n_lat() * n_lng).q.jst.tv_sec;
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: タイル 1 枚
+ *             (経度方向の先頭番号から kCell 点分。補間には次のタイル・帯の先頭の
+ *              行・列の厳密値も使う)
+ *
+ * @param[in]  経度方向の先頭番号 (kCell の倍数) (uint64_t)
+ * @return     none
+ */
+void GridAdapt::calc_tile(std::uint64_t j_0) {
+  try {
+    cell(i_0, std::min(i_0 + kCell, grid.get_n_lat() - 1),
+         j_0, std::min(j_0 + kCell, n_lng - 1));
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 厳密値（計算済みの場合はそのまま。補間値は厳密値で置き換える）
+ *             (隣接するタイルと同じ点を同時に計算しないよう、状態を「計算中」にした
+ *              スレッドのみが計算し、他は完了を待つ)
+ *
+ * @param[in]  緯度方向の番号 (uint64_t)
+ * @param[in]  経度方向の番号 (uint64_t)
+ * @return     計算結果 (Result)
+ */
+const struct Result& GridAdapt::exact(std::uint64_t i, std::uint64_t j) {
+  std::uint64_t k = (i - i_0) * n_lng + j;
+  unsigned char s;
+
+  try {
+    for (;;) {
+      s = st[k].load(std::memory_order_acquire);
+      if (s == 1) break;
+      if (s == 3) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (!st[k].compare_exchange_weak(s, 3, std::memory_order_acquire)) continue;
+      calc_all_st(grid.row((day * grid.get_n_lat() + i) * n_lng + j).q, eop, nullptr,
+                  res[k], rst[k]);
+      ++n_ex;
+      st[k].store(1, std::memory_order_release);
+      break;
+    }
+  } catch (...) {
+    throw;
+  }
+
+  return res[k];
+}
+
+/*
+ * @brief      計算: セル [i_a, i_b] × [j_a, j_b]
+ *             (四隅を厳密に計算し、辺の中点・中心の厳密値と補間値が許容誤差以内なら
+ *              セル内の未設定の点を補間する。超える場合は中点で分割して繰り返す)
+ *
+ * @param[in]  緯度方向の番号: 開始 (uint64_t)
+ * @param[in]  緯度方向の番号: 終了（含む） (uint64_t)
+ * @param[in]  経度方向の番号: 開始 (uint64_t)
+ * @param[in]  経度方向の番号: 終了（含む） (uint64_t)
+ * @return     none
+ */
+void GridAdapt::cell(std::uint64_t i_a, std::uint64_t i_b,
+                     std::uint64_t j_a, std::uint64_t j_b) {
+  std::uint64_t is[3] = {i_a, (i_a + i_b) / 2, i_b};  // 分割位置（緯度方向）
+  std::uint64_t js[3] = {j_a, (j_a + j_b) / 2, j_b};  // 分割位置（経度方向）
+  unsigned int  n_i = i_b - i_a > 1 ? 3 : 2;         // 分割位置の数（2: 分割しない）
+  unsigned int  n_j = j_b - j_a > 1 ? 3 : 2;
+  unsigned int  k;
+  unsigned int  l;
+  bool ok = true;
+
+  try {
+    if (n_i == 2) is[1] = i_b;
+    if (n_j == 2) js[1] = j_b;
+    for (k = 0; k < 4; ++k) exact(k < 2 ? i_a : i_b, k % 2 == 0 ? j_a : j_b);
+    // 格子間隔 1 のセルは四隅のみ
+    if (n_i == 2 && n_j == 2) return;
+    // 四隅で状態（イベントの有無・収束）が同じか
+    const ResSt& c = rst[(i_a - i_0) * n_lng + j_a];
+    for (k = 1; ok && k < 4; ++k) {
+      ok = same_st(c, rst[((k < 2 ? i_a : i_b) - i_0) * n_lng + (k % 2 == 0 ? j_a : j_b)]);
+    }
+    // 辺の中点・中心の厳密値と補間値の比較（状態も同じであること）
+    for (k = 0; ok && k < n_i; ++k) {
+      for (l = 0; ok && l < n_j; ++l) {
+        if ((k == 0 || k == n_i - 1) && (l == 0 || l == n_j - 1)) continue;
+        const Result& e = exact(is[k], js[l]);
+        ok = same_st(c, rst[(is[k] - i_0) * n_lng + js[l]])
+          && near(e, interp(i_a, i_b, j_a, j_b, is[k], js[l]), c);
+      }
+    }
+    if (ok) {
+      for (std::uint64_t i = i_a; i <= i_b; ++i) {
+        for (std::uint64_t j = j_a; j <= j_b; ++j) {
+          std::uint64_t m_k = (i - i_0) * n_lng + j;
+          unsigned char s = 0;
+          // 未設定の点のみ（隣接するタイルが設定済み・設定中の点はそのまま）
+          if (!st[m_k].compare_exchange_strong(s, 3, std::memory_order_acquire)) continue;
+          res[m_k] = interp(i_a, i_b, j_a, j_b, i, j);
+          rst[m_k] = c;
+          st[m_k].store(2, std::memory_order_release);
+        }
+      }
+      return;
+    }
+    for (k = 0; k + 1 < n_i; ++k) {
+      for (l = 0; l + 1 < n_j; ++l) cell(is[k], is[k + 1], js[l], js[l + 1]);
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 四隅の厳密値からの双一次補間
+ *             (四隅で状態が同じ場合のみ使用。正常以外のイベントは左上の値のまま)
+ *
+ * @param[in]  緯度方向の番号: 開始 (uint64_t)
+ * @param[in]  緯度方向の番号: 終了（含む） (uint64_t)
+ * @param[in]  経度方向の番号: 開始 (uint64_t)
+ * @param[in]  経度方向の番号: 終了（含む） (uint64_t)
+ * @param[in]  緯度方向の番号 (uint64_t)
+ * @param[in]  経度方向の番号 (uint64_t)
+ * @return     補間値 (Result)
+ */
+struct Result GridAdapt::interp(std::uint64_t i_a, std::uint64_t i_b,
+                                std::uint64_t j_a, std::uint64_t j_b,
+                                std::uint64_t i, std::uint64_t j) {
+  const Result* c[4] = {&exact(i_a, j_a), &exact(i_a, j_b),
+                        &exact(i_b, j_a), &exact(i_b, j_b)};
+  double u = i_b > i_a ? double(i - i_a) / (i_b - i_a) : 0.0;
+  double v = j_b > j_a ? double(j - j_a) / (j_b - j_a) : 0.0;
+  double wt[4] = {(1.0 - u) * (1.0 - v), (1.0 - u) * v, u * (1.0 - v), u * v};  // 重み
+  struct Result r = *c[0];
+  double t;
+  unsigned int k;
+  unsigned int m;
+
+  const ResSt& s = rst[(i_a - i_0) * n_lng + j_a];  // 四隅の状態（同じ場合のみ補間）
+
+  // 時刻（当日 00:00:00 からの秒数）と方位角／高度
+  auto ip_ev = [&](struct TmAh (Result::* ev)[3], unsigned int n, unsigned int i_ev) {
+    TmAh& e = (r.*ev)[n];
+    if (s.ev[i_ev] != kStOk) return;
+    t    = 0.0;
+    e.ah = 0.0;
+    for (k = 0; k < 4; ++k) {
+      t    += wt[k] * to_rel((c[k]->*ev)[n].time, jst);
+      e.ah += wt[k] * (c[k]->*ev)[n].ah;
+    }
+    e.time.tv_sec  = jst + time_t(std::floor(t));
+    e.time.tv_nsec = long((t - std::floor(t)) * 1.0e9);
+  };
+
+  for (m = 0; m < 3; ++m) {
+    ip_ev(&Result::sun, m, m);
+    ip_ev(&Result::moon, m, 3 + m);
+  }
+  r.phase = {0.0, 0.0, 0.0, 0.0};
+  for (k = 0; k < 4; ++k) {
+    r.phase.ph_ang += wt[k] * c[k]->phase.ph_ang;
+    r.phase.illum  += wt[k] * c[k]->phase.illum;
+    r.phase.age    += wt[k] * c[k]->phase.age;
+    r.phase.limb   += wt[k] * c[k]->phase.limb;
+  }
+
+  return r;
+}
+
+/*
+ * @brief      判定: 許容誤差以内（状態が同じ場合のみ使用。正常なイベントのみ比較）
+ *
+ * @param[in]  厳密値 (Result)
+ * @param[in]  補間値 (Result)
+ * @param[in]  計算状態 (ResSt)
+ * @return     許容誤差以内 (bool)
+ */
+bool GridAdapt::near(const Result& a, const Result& b, const ResSt& s) {
+  const TmAh* ea[6] = {&a.sun[0], &a.sun[1], &a.sun[2], &a.moon[0], &a.moon[1], &a.moon[2]};
+  const TmAh* eb[6] = {&b.sun[0], &b.sun[1], &b.sun[2], &b.moon[0], &b.moon[1], &b.moon[2]};
+  unsigned int k;
+
+  for (k = 0; k < 6; ++k) {
+    if (s.ev[k] != kStOk) continue;
+    if (std::abs(to_rel(ea[k]->time, jst) - to_rel(eb[k]->time, jst)) > tol_t
+        || std::abs(ea[k]->ah - eb[k]->ah) > tol_a) return false;
+  }
+
+  return std::abs(a.phase.ph_ang - b.phase.ph_ang) <= tol_a
+      && std::abs(a.phase.limb - b.phase.limb) <= tol_a
+      && std::abs(a.phase.illum - b.phase.illum) <= tol_a / 180.0
+      && std::abs(a.phase.age - b.phase.age) <= tol_t / 86400.0;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,100 @@
+#ifndef SUN_MOON_GRID_HPP_
+#define SUN_MOON_GRID_HPP_
+
+#include "engine.hpp"
+#include "eop.hpp"
+#include "input.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+namespace sun_moon {
+
+// 日付範囲 × 格子点
+struct GridSpec {
+  struct timespec d_0;    // 開始日(JST)
+  struct timespec d_1;    // 終了日(JST, 当日を含む)
+  double          lat_0;  // 緯度: 開始
+  double          lat_1;  // 緯度: 終了（当値を含む）
+  double          lng_0;  // 経度: 開始
+  double          lng_1;  // 経度: 終了（当値を含む）
+  double          step;   // 格子間隔(度)
+  double          ht;     // 標高
+};
+
+// 問い合わせ生成: 日付範囲 × 格子点
+// * 日付 → 緯度 → 経度 の順（データ行番号はこの順の通し番号）
+class Grid : public Source {
+  GridSpec            spec;   // 範囲
+  std::vector<time_t> days;   // 各日の JST
+  std::uint64_t       n_lat;  // 緯度方向の点数
+  std::uint64_t       n_lng;  // 経度方向の点数
+  std::uint64_t       cur;    // 次に生成する行番号
+  std::uint64_t       lim;    // 生成終了の行番号（含まない）
+
+public:
+  explicit Grid(const GridSpec&);  // コンストラクタ
+  std::size_t read(std::vector<Row>&, std::size_t) override;  // 読込: 最大 n 件
+  std::uint64_t size() { return days.size() * n_lat * n_lng; }  // 総件数
+  std::uint64_t get_n_day() { return days.size(); }  // 取得: 日数
+  std::uint64_t get_n_lat() { return n_lat; }        // 取得: 緯度方向の点数
+  std::uint64_t get_n_lng() { return n_lng; }        // 取得: 経度方向の点数
+  Row row(std::uint64_t);  // 取得: 行番号の問い合わせ
+  void limit(std::uint64_t, std::uint64_t);  // 設定: 生成する行番号の範囲
+};
+
+// 格子点の適応補間
+// * kCell × kCell 間隔の粗い格子点のみ厳密に計算し、セル内は双一次補間する
+// * セルの辺の中点・中心でも厳密に計算して補間値と比較し、誤差が許容値を超える場合、
+//   または四隅でイベントの有無が異なる場合は、セルを 4 分割して繰り返す
+//   （最小のセルは格子間隔 1 で、四隅のみのため全て厳密値）
+// * 許容値: 時刻は指定秒、角度は天球が指定秒で回転する角度（1 秒 = 15″）
+// * 緯度方向 kCell 行の帯単位で計算し、帯を経度方向 kCell 点のタイルに分けて並列に処理する。
+//   厳密値は帯全体で共有するため、タイル・帯の境界の点も 1 回だけ計算する
+class GridAdapt {
+  Grid&         grid;   // 格子点
+  double        tol_t;  // 許容値: 時刻(秒)
+  double        tol_a;  // 許容値: 角度(度)
+  std::shared_ptr<const EopTable> eop;  // EOP 一覧
+  std::uint64_t n_lng;  // 経度方向の点数
+  std::uint64_t day;    // 帯: 日の番号
+  std::uint64_t i_0;    // 帯: 緯度方向の先頭番号
+  time_t        jst;    // 帯: 当日 00:00:00
+  std::vector<struct Result> res;  // 帯の計算結果((kCell + 1) 行 × 経度方向の点数)
+  std::vector<struct ResSt>  rst;  // 帯の計算状態（補間値は四隅と同じ）
+  std::unique_ptr<std::atomic<unsigned char>[]> st;
+                        // 帯の各点の状態(0: 未設定, 1: 厳密値, 2: 補間値, 3: 計算中)
+  std::atomic<std::uint64_t> n_ex;  // 厳密に計算した点数
+
+public:
+  static constexpr std::uint64_t kCell = 32;  // 粗い格子の間隔(格子点数, 2 の冪)
+  GridAdapt(Grid&, double, std::shared_ptr<const EopTable>);  // コンストラクタ
+  void begin_band(std::uint64_t, std::uint64_t);  // 開始: 帯（日, 緯度方向の先頭番号）
+  void calc_tile(std::uint64_t);       // 計算: タイル 1 枚（経度方向の先頭番号）
+  const struct Result& get(std::uint64_t r, std::uint64_t j) {  // 取得: 帯の r 行目の結果
+    return res[r * n_lng + j];
+  }
+  const struct ResSt& get_st(std::uint64_t r, std::uint64_t j) {  // 取得: 帯の r 行目の状態
+    return rst[r * n_lng + j];
+  }
+  std::uint64_t get_n_ex() { return n_ex; }  // 取得: 厳密に計算した点数
+
+private:
+  const struct Result& exact(std::uint64_t, std::uint64_t);  // 計算: 厳密値
+  void cell(std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t);
+                                                   // 計算: セル（再帰的に分割）
+  struct Result interp(std::uint64_t, std::uint64_t, std::uint64_t,
+                       std::uint64_t, std::uint64_t, std::uint64_t);
+                                                   // 計算: 四隅からの双一次補間
+  bool near(const Result&, const Result&, const ResSt&);
+                                                   // 判定: 許容誤差以内
+};
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,188 @@
+#include "horizon.hpp"
+#include "input.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>   // for EXIT_XXXX
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double kHzUnit = 0.01;    // 仰角の単位(度)
+static constexpr double kKeyRes = 1.0e4;   // 索引キー: 緯度・経度の分解能(1 / 度, 出力の桁数と同じ)
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  仰角(度, 方位 0 から n 等分した各方位) (float[n])
+ * @param[in]  分割数 n (unsigned int)
+ */
+Horizon::Horizon(const float* v, unsigned int n) {
+  try {
+    el.assign(v, v + n);
+    el.push_back(v[0]);
+    n_deg  = n / 360.0;
+    el_min = *std::min_element(el.begin(), el.end());
+    el_max = *std::max_element(el.begin(), el.end());
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 緯度・経度の索引キー（0.0001 度単位に丸めた値を連結）
+ *
+ * @param[in]  緯度 (double)
+ * @param[in]  経度 (double)
+ * @return     キー (uint64_t)
+ */
+std::uint64_t HorizonSet::key(double lat, double lng) {
+  std::uint32_t k_lat = std::uint32_t(std::int32_t(std::llround(lat * kKeyRes)));
+  std::uint32_t k_lng = std::uint32_t(std::int32_t(std::llround(lng * kKeyRes)));
+
+  return std::uint64_t(k_lat) << 32 | k_lng;
+}
+
+/*
+ * @brief      読込: 地平線プロファイルファイル
+ *             (同じ緯度・経度の地点が複数ある場合は後の地点を使う)
+ *
+ * @param[in]  ファイル名 (string)
+ * @return     成否 (bool)
+ */
+bool HorizonSet::load(const std::string& f) {
+  HzHead head;
+  HzSite st;
+  std::vector<std::int16_t> raw;  // 仰角(0.01 度単位)
+  std::vector<float> v;           // 仰角(度)
+  std::uint32_t i;
+  std::uint32_t j;
+
+  try {
+    std::ifstream ifs(f, std::ios::binary);
+    if (!ifs || !ifs.read(reinterpret_cast<char*>(&head), sizeof(head))) return false;
+    if (std::memcmp(head.magic, kHzMagic, sizeof(kHzMagic)) != 0
+        || head.n_bin < 4 || head.n_bin > kHzMaxBin || head.n_site == 0) return false;
+    raw.resize(head.n_bin);
+    v.resize(head.n_bin);
+    hzs.clear();
+    idx.clear();
+    hzs.reserve(head.n_site);
+    for (i = 0; i < head.n_site; ++i) {
+      if (!ifs.read(reinterpret_cast<char*>(&st), sizeof(st))
+          || !ifs.read(reinterpret_cast<char*>(raw.data()), raw.size() * sizeof(raw[0])))
+        return false;
+      for (j = 0; j < head.n_bin; ++j) v[j] = float(raw[j] * kHzUnit);
+      idx[key(st.lat, st.lng)] = hzs.size();
+      hzs.emplace_back(v.data(), head.n_bin);
+    }
+    if (ifs.peek() != std::ifstream::traits_type::eof()) return false;
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      参照: 緯度・経度の地点（0.0001 度単位で一致するもの）
+ *
+ * @param[in]  緯度 (double)
+ * @param[in]  経度 (double)
+ * @return     プロファイル (const Horizon*, ない場合は nullptr)
+ */
+const Horizon* HorizonSet::find(double lat, double lng) const {
+  auto it = idx.find(key(lat, lng));
+
+  return it == idx.end() ? nullptr : &hzs[it->second];
+}
+
+/*
+ * @brief      実行: 地平線プロファイルファイルの作成
+ *             (テキストは 1 行 1 地点 "LATITUDE,LONGITUDE,EL_0,EL_1,...,EL_n-1"（区切りは
+ *              カンマ・空白・タブ）, 空行・'#' で始まる行は無視。EL_i は方位 i × 360 / n 度の
+ *              見かけの仰角(度, -90 〜 90)で、n は全行で同じ(4 〜 kHzMaxBin))
+ *
+ * @param[in]  テキストファイル名 (string)
+ * @param[in]  出力ファイル名 (string)
+ * @return     終了コード (int)
+ */
+int run_horizon_build(const std::string& f_in, const std::string& f_out) {
+  std::string ln;
+  unsigned int n_ln = 0;
+  const char* p;
+  const char* e;
+  double v;
+  std::vector<double> vs;          // 1 行分の値
+  std::vector<std::int16_t> raw;   // 仰角(0.01 度単位)
+  HzHead head = {};
+  HzSite st;
+  std::size_t i;
+
+  try {
+    std::ifstream ifs(f_in);
+    if (!ifs) {
+      std::cerr << "[ERROR] Cannot open " << f_in << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::ofstream ofs(f_out, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      std::cerr << "[ERROR] Cannot open " << f_out << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::memcpy(head.magic, kHzMagic, sizeof(kHzMagic));
+    ofs.write(reinterpret_cast<const char*>(&head), sizeof(head));  // 地点数は最後に書き直す
+    while (std::getline(ifs, ln)) {
+      ++n_ln;
+      if (ln.empty() || ln[0] == '#' || ln == "\r") continue;
+      p = ln.data();
+      e = p + ln.size();
+      vs.clear();
+      bool ok = true;
+      while (ok) {
+        while (p < e && (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == e) break;
+        if ((ok = parse_num(p, e, v))) vs.push_back(v);
+      }
+      ok = ok && vs.size() >= 6 && std::abs(vs[0]) <= 90.0 && std::abs(vs[1]) <= 360.0
+        && (head.n_bin == 0 || vs.size() - 2 == head.n_bin) && vs.size() - 2 <= kHzMaxBin;
+      for (i = 2; ok && i < vs.size(); ++i) ok = std::abs(vs[i]) <= 90.0;
+      if (!ok) {
+        std::cerr << "[ERROR] " << f_in << " line " << n_ln
+                  << ": malformed horizon profile" << std::endl;
+        return EXIT_FAILURE;
+      }
+      head.n_bin = vs.size() - 2;
+      st.lat = vs[0];
+      st.lng = vs[1];
+      raw.resize(head.n_bin);
+      for (i = 0; i < head.n_bin; ++i) {
+        raw[i] = std::int16_t(std::lround(vs[i + 2] / kHzUnit));
+      }
+      ofs.write(reinterpret_cast<const char*>(&st), sizeof(st));
+      ofs.write(reinterpret_cast<const char*>(raw.data()), raw.size() * sizeof(raw[0]));
+      ++head.n_site;
+    }
+    if (head.n_site == 0) {
+      std::cerr << "[ERROR] No horizon profile in " << f_in << std::endl;
+      return EXIT_FAILURE;
+    }
+    ofs.seekp(0);
+    ofs.write(reinterpret_cast<const char*>(&head), sizeof(head));
+    if (!ofs.flush()) {
+      std::cerr << "[ERROR] Write error" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "[INFO] " << head.n_site << " sites, " << head.n_bin << " bins" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,73 @@
+#ifndef SUN_MOON_HORIZON_HPP_
+#define SUN_MOON_HORIZON_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sun_moon {
+
+// 地平線プロファイルファイル（地点毎の地形・建物の仰角）
+// * ヘッダ: HzHead
+// * 地点:   HzSite + 仰角(int16 × 分割数, 0.01 度単位) × 地点数
+// * 数値はホストのバイト順（リトルエンディアン前提）
+static constexpr char kHzMagic[8] = {'S', 'M', 'H', 'Z', 'N', '0', '1', '\0'};
+static constexpr unsigned int kHzMaxBin = 36000;  // 方位の分割数の上限
+
+struct HzHead {
+  char          magic[8];  // "SMHZN01\0"
+  std::uint32_t n_bin;     // 方位の分割数（全地点共通）
+  std::uint32_t n_site;    // 地点数
+};
+struct HzSite {
+  double lat;              // 緯度
+  double lng;              // 経度
+};
+
+// 地平線プロファイル（1 地点）
+// * 方位角(北 = 0, 東回り) を n 等分した各方位 i × 360 / n 度の見かけの仰角を持ち、
+//   間は線形補間する（参照は O(1)）
+class Horizon {
+  std::vector<float> el;  // 仰角(度, n + 1 個。末尾は 360 度として先頭を複製)
+  double n_deg;           // 1 度あたりの分割数
+  double el_min;          // 仰角の最小値
+  double el_max;          // 仰角の最大値
+
+public:
+  Horizon(const float*, unsigned int);  // コンストラクタ
+  double at(double az) const {          // 参照: 方位角(度)の仰角
+    double x = az * n_deg;
+    std::size_t i;
+    if (!(x >= 0.0)) x = 0.0;
+    i = static_cast<std::size_t>(x);
+    if (i >= el.size() - 1) i = el.size() - 2;
+    return el[i] + (x - i) * (el[i + 1] - el[i]);
+  }
+  double get_bin_w() const { return 1.0 / n_deg; }  // 取得: 分割の幅(度)
+  double get_min() const { return el_min; }         // 取得: 仰角の最小値
+  double get_max() const { return el_max; }         // 取得: 仰角の最大値
+};
+
+// 地平線プロファイル一覧（緯度・経度で参照）
+class HorizonSet {
+  std::vector<Horizon> hzs;                                // 地点毎のプロファイル
+  std::unordered_map<std::uint64_t, std::size_t> idx;      // 緯度・経度 -> 添字
+
+public:
+  bool load(const std::string&);                           // 読込: 地平線プロファイルファイル
+  const Horizon* find(double, double) const;               // 参照: 緯度・経度の地点
+  std::size_t size() const { return hzs.size(); }          // 取得: 地点数
+
+private:
+  static std::uint64_t key(double, double);                // 計算: 緯度・経度の索引キー
+};
+
+int run_horizon_build(const std::string&, const std::string&);
+                                 // 実行: 地平線プロファイルファイルの作成（テキストから）
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,258 @@
+#include "input.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sun_moon {
+
+// 定数
+static constexpr std::size_t kChunk = 1 << 20;  // 標準入力の読込単位 (bytes)
+static constexpr double kPow10[] = {
+  1.0e0,  1.0e1,  1.0e2,  1.0e3,  1.0e4,  1.0e5,  1.0e6,  1.0e7,  1.0e8,
+  1.0e9,  1.0e10, 1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15, 1.0e16, 1.0e17,
+  1.0e18, 1.0e19
+};
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+Input::Input() : fd(-1), p_map(nullptr), s_map(0), cur(nullptr), end(nullptr),
+                 f_eof(false), n_line(0), n_seq(0), n_bad(0),
+                 ymd_last(-1), sec_last(0) {}
+
+/*
+ * @brief  デストラクタ
+ *
+ * @param  none
+ */
+Input::~Input() {
+  if (p_map != nullptr) munmap(const_cast<char*>(p_map), s_map);
+  if (fd > 0) close(fd);
+}
+
+/*
+ * @brief      OPEN
+ *             (通常ファイルはメモリマップ、それ以外は逐次読込)
+ *
+ * @param[in]  ファイル名 ("-" は標準入力) (string)
+ * @return     成否 (bool)
+ */
+bool Input::open(const std::string& f) {
+  struct stat st;
+  void* p;
+
+  try {
+    fd = (f == "-") ? 0 : ::open(f.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        p_map = static_cast<const char*>(p);
+        s_map = st.st_size;
+        cur   = p_map;
+        end   = p_map + s_map;
+        f_eof = true;
+        return true;
+      }
+    }
+    buf.resize(kChunk);
+    cur = end = buf.data();
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief       読込: 最大 n 件
+ *              (不正行は行番号を標準エラー出力へ報告して読み飛ばす)
+ *
+ * @param[ref]  読込結果 (vector<Row>, 追記)
+ * @param[in]   最大件数 (size_t)
+ * @return      読込件数（0 の場合は入力終了） (size_t)
+ */
+std::size_t Input::read(std::vector<Row>& rows, std::size_t n) {
+  const char* nl;  // 行末
+  Row row;
+  std::size_t cnt = 0;
+
+  try {
+    while (cnt < n) {
+      nl = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+      if (nl == nullptr) {
+        if (!f_eof && fill()) continue;
+        if (cur == end) break;
+        nl = end;  // 最終行（改行なし）
+      }
+      ++n_line;
+      const char* b = cur;
+      const char* e = nl;
+      cur = (nl == end) ? end : nl + 1;
+      if (e > b && e[-1] == '\r') --e;
+      while (b < e && (*b == ' ' || *b == '\t')) ++b;
+      if (b == e || *b == '#') continue;
+      row.seq  = n_seq++;
+      row.line = n_line;
+      if (!parse(b, e, row)) {
+        ++n_bad;
+        std::cerr << "[WARN] line " << n_line << ": malformed row" << std::endl;
+        continue;
+      }
+      rows.push_back(row);
+      ++cnt;
+    }
+  } catch (...) {
+    throw;
+  }
+
+  return cnt;
+}
+
+/*
+ * @brief   補充: 標準入力
+ *          (未解析の残りをバッファ先頭へ移し、後ろへ追加で読み込む)
+ *
+ * @param   none
+ * @return  追加有無 (bool)
+ */
+bool Input::fill() {
+  std::size_t rest = end - cur;  // 未解析バイト数
+  ssize_t s;
+
+  if (rest > 0 && cur != buf.data()) std::memmove(buf.data(), cur, rest);
+  if (buf.size() - rest < kChunk / 2) buf.resize(buf.size() * 2);  // 長大な行
+  do {
+    s = ::read(fd, buf.data() + rest, buf.size() - rest);
+  } while (s < 0 && errno == EINTR);
+  cur = buf.data();
+  end = buf.data() + rest + (s > 0 ? s : 0);
+  if (s <= 0) f_eof = true;
+
+  return s > 0;
+}
+
+/*
+ * @brief       解析: 1 行（その場で解析）
+ *
+ * @param[in]   行頭 (const char*)
+ * @param[in]   行末 (const char*)
+ * @param[ref]  入力行 (Row)
+ * @return      成否 (bool)
+ */
+bool Input::parse(const char* b, const char* e, Row& row) {
+  int ymd;
+  double v[3];  // 緯度・経度・標高
+  unsigned int i;
+
+  auto skip = [&b, e]() {
+    while (b < e && (*b == ',' || *b == ' ' || *b == '\t')) ++b;
+  };
+  if (e - b < 8) return false;
+  auto r = std::from_chars(b, b + 8, ymd);
+  if (r.ec != std::errc() || r.ptr != b + 8) return false;
+  b += 8;
+  for (i = 0; i < 3; ++i) {
+    const char* b0 = b;
+    skip();
+    if (b == b0 || !parse_num(b, e, v[i])) return false;
+  }
+  skip();
+  if (b != e) return false;
+  if (std::abs(v[0]) > 90.0 || std::abs(v[1]) > 360.0 || v[2] < 0.0)
+    return false;
+  if (!to_jst(ymd, row.q.jst)) return false;
+  row.q.lat = v[0];
+  row.q.lng = v[1];
+  row.q.ht  = v[2];
+
+  return true;
+}
+
+/*
+ * @brief       変換: YYYYMMDD -> JST
+ *              (同一日付が続く場合は変換を省略)
+ *
+ * @param[in]   日付 (int)
+ * @param[ref]  JST (timespec)
+ * @return      成否 (bool)
+ */
+bool Input::to_jst(int ymd, struct timespec& jst) {
+  struct tm t = {};
+  time_t sec;
+
+  if (ymd != ymd_last) {
+    t.tm_year  = ymd / 10000 - 1900;
+    t.tm_mon   = ymd / 100 % 100 - 1;
+    t.tm_mday  = ymd % 100;
+    t.tm_isdst = -1;
+    if (t.tm_mon < 0 || t.tm_mon > 11 || t.tm_mday < 1) return false;
+    sec = mktime_jst(t);
+    if (t.tm_mday != ymd % 100) return false;  // 存在しない日付
+    ymd_last = ymd;
+    sec_last = sec;
+  }
+  jst.tv_sec  = sec_last;
+  jst.tv_nsec = 0;
+
+  return true;
+}
+
+/*
+ * @brief       解析: 10 進数（[+-]digits[.digits][(e|E)[+-]digits]）
+ *              (整数部・小数部の数字列を from_chars で整数として読み、
+ *               10 の冪で合成する。有効桁 19 桁まで)
+ *
+ * @param[ref]  解析位置 (const char*, 解析後は数値の直後)
+ * @param[in]   終端 (const char*)
+ * @param[ref]  数値 (double)
+ * @return      成否 (bool)
+ */
+bool parse_num(const char*& p, const char* e, double& v) {
+  std::uint64_t m_i = 0;  // 整数部
+  std::uint64_t m_f = 0;  // 小数部
+  int  n_f = 0;           // 小数部桁数
+  int  ex  = 0;           // 指数
+  bool neg = false;
+  const char* q;
+
+  if (p < e && (*p == '+' || *p == '-')) neg = (*p++ == '-');
+  q = p;
+  auto r = std::from_chars(p, e, m_i);
+  if (r.ec == std::errc::result_out_of_range) return false;
+  p = r.ptr;
+  if (p < e && *p == '.') {
+    const char* f = ++p;
+    while (p < e && *p >= '0' && *p <= '9') ++p;
+    n_f = p - f;
+    if (n_f > 19) n_f = 19;  // 20 桁目以降は切り捨て
+    if (n_f > 0) std::from_chars(f, f + n_f, m_f);
+  }
+  if (p == q || (p == q + 1 && *q == '.')) return false;  // 数字なし
+  if (p < e && (*p == 'e' || *p == 'E')) {
+    const char* x = p + 1;
+    if (x < e && *x == '+') ++x;
+    r = std::from_chars(x, e, ex);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+  }
+  v = m_i + m_f / kPow10[n_f];
+  if (ex > 0) v *= std::pow(10.0, ex);
+  if (ex < 0) v /= std::pow(10.0, -ex);
+  if (neg) v = -v;
+
+  return true;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,65 @@
+#ifndef SUN_MOON_INPUT_HPP_
+#define SUN_MOON_INPUT_HPP_
+
+#include "engine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 入力行（問い合わせ）
+struct Row {
+  std::uint64_t seq;   // データ行番号（0 始まり, 不正行を含む）
+  std::uint64_t line;  // ファイル上の行番号（1 始まり）
+  struct Query  q;     // 問い合わせ
+};
+
+// 問い合わせの供給元
+class Source {
+public:
+  virtual ~Source() {}
+  virtual std::size_t read(std::vector<Row>&, std::size_t) = 0;  // 読込: 最大 n 件
+  virtual std::uint64_t get_bad() { return 0; }                 // 取得: 不正行数
+};
+
+// 一括問い合わせ入力
+// * 1 行 1 件: "YYYYMMDD,LATITUDE,LONGITUDE,HEIGHT"（区切りはカンマ・空白・タブ）
+// * 空行・'#' で始まる行は無視
+// * ファイルはメモリマップ、標準入力("-")は大きな単位で読込み、その場で解析する
+class Input : public Source {
+  int                fd;        // ファイルディスクリプタ
+  const char*        p_map;     // マップ先頭
+  std::size_t        s_map;     // マップサイズ
+  std::vector<char>  buf;       // 標準入力用バッファ
+  const char*        cur;       // 解析位置
+  const char*        end;       // 解析終端
+  bool               f_eof;     // 入力終了フラグ
+  std::uint64_t      n_line;    // 読込済み行数
+  std::uint64_t      n_seq;     // 読込済みデータ行数
+  std::uint64_t      n_bad;     // 不正行数
+  int                ymd_last;  // 直前の日付(YYYYMMDD)
+  time_t             sec_last;  // 直前の日付の JST
+
+public:
+  Input();   // コンストラクタ
+  ~Input();  // デストラクタ
+  bool open(const std::string&);                   // OPEN（"-" は標準入力）
+  std::size_t read(std::vector<Row>&, std::size_t) override;  // 読込: 最大 n 件
+  std::uint64_t get_bad() override { return n_bad; }         // 取得: 不正行数
+
+private:
+  bool fill();                                 // 補充: 標準入力
+  bool parse(const char*, const char*, Row&);  // 解析: 1 行
+  bool to_jst(int, struct timespec&);          // 変換: YYYYMMDD -> JST
+};
+
+bool parse_num(const char*&, const char*, double&);  // 解析: 10 進数
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,181 @@
+#include "libsun_moon.h"
+#include "engine.hpp"
+#include "eop.hpp"
+#include "track.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+
+// コンテキスト
+struct sm_ctx {
+  sun_moon::Eop eop;  // EOP スナップショット管理
+  explicit sm_ctx(const std::string& dir) : eop(dir) {}
+};
+
+namespace {
+
+namespace ns = sun_moon;
+
+/*
+ * @brief       変換: 日付 -> JST
+ *
+ * @param[in]   日付 (sm_date)
+ * @param[ref]  JST (timespec)
+ * @return      成否 (bool)
+ */
+bool to_jst(const sm_date& d, struct timespec& jst) {
+  struct tm t = {};
+
+  if (d.month < 1 || d.month > 12 || d.day < 1 || d.day > 31) return false;
+  t.tm_year  = d.year - 1900;
+  t.tm_mon   = d.month - 1;
+  t.tm_mday  = d.day;
+  jst.tv_sec  = ns::mktime_jst(t);
+  jst.tv_nsec = 0;
+  // 存在しない日付(2月30日等)は不正とする
+  return t.tm_mday == d.day && t.tm_mon == d.month - 1;
+}
+
+/*
+ * @brief       変換: 時刻・方位角/高度 -> イベント
+ *
+ * @param[in]   時刻・方位角/高度 (TmAh)
+ * @param[in]   イベントの状態 (CalcSt)
+ * @param[ref]  イベント (sm_event)
+ * @return      none
+ */
+void to_event(const ns::TmAh& ta, ns::CalcSt st, sm_event& ev) {
+  ev.sec    = ta.time.tv_sec;
+  ev.nsec   = ta.time.tv_nsec;
+  ev.ah     = ta.ah;
+  ev.status = st;
+  if (st != ns::kStOk) {
+    ev.sec = 0;
+    ev.nsec = 0;
+  }
+}
+
+/*
+ * @brief       計算: 1 件（例外を送出しない経路。不正な入力・失敗は状態コードで返す）
+ *
+ * @param[in]   EOP 一覧 (shared_ptr<const EopTable>)
+ * @param[in]   日付 (sm_date)
+ * @param[in]   観測者 (sm_observer)
+ * @param[ref]  計算結果 (sm_result)
+ * @return      成否 (bool)
+ */
+bool calc_one(const std::shared_ptr<const ns::EopTable>& eop,
+              const sm_date& d, const sm_observer& o, sm_result& r) noexcept {
+  struct ns::Query  q;
+  struct ns::Result res;
+  struct ns::ResSt  rs;
+  unsigned int i;
+
+  r.eop_ver = eop->ver;
+  r.flags   = 0;
+  q.lat = o.lat;
+  q.lng = o.lng;
+  q.ht  = o.ht;
+  if (!to_jst(d, q.jst)) q.jst.tv_sec = time_t(-1);
+  r.status = ns::calc_all_st(q, eop, nullptr, res, rs);
+  if (r.status != SM_OK) {
+    for (i = 0; i < 3; ++i) r.sun[i] = r.moon[i] = {0, 0, r.status, 0.0};
+    return false;
+  }
+  for (i = 0; i < 3; ++i) {
+    to_event(res.sun[i],  rs.ev[i],     r.sun[i]);
+    to_event(res.moon[i], rs.ev[3 + i], r.moon[i]);
+  }
+  if (!rs.f_eop) r.flags |= SM_F_NO_EOP;
+
+  return true;
+}
+
+}  // namespace
+
+extern "C" {
+
+int sm_abi_version(void) {
+  return SM_ABI_VERSION;
+}
+
+sm_ctx* sm_ctx_new(const char* dir) {
+  try {
+    return new sm_ctx(dir ? dir : "");
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void sm_ctx_free(sm_ctx* ctx) {
+  delete ctx;
+}
+
+int sm_ctx_reload(sm_ctx* ctx) {
+  if (!ctx) return -1;
+  try {
+    return ctx->eop.reload() ? 1 : 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+uint64_t sm_ctx_eop_ver(const sm_ctx* ctx) {
+  return ctx ? ctx->eop.get()->ver : 0;
+}
+
+ptrdiff_t sm_calc_batch(sm_ctx* ctx, const sm_date* dates,
+                        const sm_observer* obs, size_t n, sm_result* out) {
+  ptrdiff_t n_ok = 0;  // 正常件数
+
+  if (!ctx || (n > 0 && (!dates || !obs || !out))) return -1;
+  // 1 回の呼び出し中は同一スナップショットを使用
+  auto eop = ctx->eop.get();
+  for (size_t i = 0; i < n; ++i)
+    if (calc_one(eop, dates[i], obs[i], out[i])) ++n_ok;
+
+  return n_ok;
+}
+
+ptrdiff_t sm_calc_cross(sm_ctx* ctx, const sm_observer* obs, size_t n_obs,
+                        const sm_date* dates, size_t n_date, sm_result* out) {
+  ptrdiff_t n_ok = 0;  // 正常件数
+
+  if (!ctx || (n_obs > 0 && n_date > 0 && (!dates || !obs || !out)))
+    return -1;
+  // 件数 n_obs × n_date があふれる場合（戻り値の ptrdiff_t に収まらない場合を含む）
+  if (n_date > 0 && n_obs > size_t(PTRDIFF_MAX) / n_date) return -1;
+  auto eop = ctx->eop.get();
+  for (size_t i = 0; i < n_obs; ++i)
+    for (size_t j = 0; j < n_date; ++j)
+      if (calc_one(eop, dates[j], obs[i], out[i * n_date + j])) ++n_ok;
+
+  return n_ok;
+}
+
+int sm_track(sm_ctx* ctx, int body, const sm_observer* obs,
+             int64_t t0_sec, int32_t t0_nsec, int64_t step_ns,
+             size_t n, sm_altaz* out) {
+  struct timespec t_0 = {time_t(t0_sec), long(t0_nsec)};
+
+  if (!ctx || !obs || (n > 0 && !out) || (body != SM_SUN && body != SM_MOON)
+      || !std::isfinite(obs->lat) || !std::isfinite(obs->lng)
+      || std::abs(obs->lat) > 90.0 || std::abs(obs->lng) > 360.0 || step_ns <= 0
+      || t0_nsec < 0 || t0_nsec >= 1000000000) return SM_BAD_INPUT;
+  try {
+    ns::Track o_tr(ns::Body(body), obs->lat, obs->lng, ctx->eop.get());
+    // sm_altaz は AltAz と同一レイアウト
+    static_assert(sizeof(sm_altaz) == sizeof(ns::AltAz), "layout mismatch");
+    o_tr.run(t_0, step_ns, n, reinterpret_cast<ns::AltAz*>(out));
+  } catch (...) {
+    return SM_FAILED;
+  }
+
+  return SM_OK;
+}
+
+}  // extern "C"
+
@@ -0,0 +1,112 @@
+/*
+ * libsun_moon: 日・月の出・南中・入 計算の C ABI
+ *
+ * * 時刻は JST(UTC+9) 日付を基準に計算する（プロセスのタイムゾーンには依存しない）
+ * * 結果配列は呼び出し側で確保し、1 回の呼び出しで一括計算する
+ * * コンテキストは複数スレッドから同時に使用可能
+ */
+#ifndef LIBSUN_MOON_H_
+#define LIBSUN_MOON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SM_ABI_VERSION 3  /* 2: sm_track 追加, 3: SM_NO_CONV・sm_result.flags 追加 */
+
+/* 状態コード */
+enum {
+  SM_OK        = 0,  /* 正常 */
+  SM_NO_EVENT  = 1,  /* 該当日に出・入・南中なし */
+  SM_BAD_INPUT = 2,  /* 入力値不正 */
+  SM_FAILED    = 3,  /* 計算失敗 */
+  SM_NO_CONV   = 4   /* 反復が収束しない（イベント毎） */
+};
+
+/* 補足フラグ（sm_result.flags） */
+enum {
+  SM_F_NO_EOP = 1  /* EOP 一覧の範囲外（ΔT は近似式） */
+};
+
+/* 区分（sm_result の sun[], moon[] の添字） */
+enum {
+  SM_RISE    = 0,  /* 出 */
+  SM_SET     = 1,  /* 入 */
+  SM_TRANSIT = 2   /* 南中 */
+};
+
+/* 天体（sm_track） */
+enum {
+  SM_SUN  = 0,  /* 太陽 */
+  SM_MOON = 1   /* 月 */
+};
+
+/* コンテキスト（EOP 一覧を保持。内容は非公開） */
+typedef struct sm_ctx sm_ctx;
+
+/* 日付（JST, グレゴリオ暦） */
+typedef struct {
+  int32_t year;
+  int32_t month;
+  int32_t day;
+} sm_date;
+
+/* 観測者 */
+typedef struct {
+  double lat;  /* 緯度(度, 北緯がプラス) */
+  double lng;  /* 経度(度, 東経がプラス) */
+  double ht;   /* 標高(m, 0 以上) */
+} sm_observer;
+
+/* イベント（出・入・南中） */
+typedef struct {
+  int64_t sec;     /* 時刻: UNIX 秒 */
+  int32_t nsec;    /* 時刻: ナノ秒 */
+  int32_t status;  /* 状態コード */
+  double  ah;      /* 出・入: 方位角(度), 南中: 高度(度) */
+} sm_event;
+
+/* 計算結果 */
+typedef struct {
+  sm_event sun[3];   /* 日の出・入・南中 */
+  sm_event moon[3];  /* 月の出・入・南中 */
+  uint64_t eop_ver;  /* 計算に使用した EOP 一覧の版数 */
+  int32_t  status;   /* 状態コード（SM_OK, SM_BAD_INPUT, SM_FAILED） */
+  int32_t  flags;    /* 補足フラグ（SM_F_*） */
+} sm_result;
+
+/* 視位置（sm_track） */
+typedef struct {
+  double alt;  /* 高度(度, 大気差補正済み。月は視差補正済み) */
+  double az;   /* 方位角(度, 北 = 0, 東回り) */
+} sm_altaz;
+
+int       sm_abi_version(void);
+sm_ctx*   sm_ctx_new(const char* dir);  /* dir: EOP ファイル格納ディレクトリ(NULL: カレント) */
+void      sm_ctx_free(sm_ctx* ctx);
+int       sm_ctx_reload(sm_ctx* ctx);   /* 戻り値: 1 = 差し替えあり, 0 = なし, -1 = 失敗 */
+uint64_t  sm_ctx_eop_ver(const sm_ctx* ctx);
+
+/* 日付・観測者の組 n 件を計算（戻り値: SM_OK となった件数, -1 = 引数不正） */
+ptrdiff_t sm_calc_batch(sm_ctx* ctx, const sm_date* dates,
+                        const sm_observer* obs, size_t n, sm_result* out);
+/* 観測者 n_obs 件 × 日付 n_date 件を計算（out[i_obs * n_date + i_date]）
+   （戻り値: SM_OK となった件数, -1 = 引数不正・件数が PTRDIFF_MAX を超える） */
+ptrdiff_t sm_calc_cross(sm_ctx* ctx, const sm_observer* obs, size_t n_obs,
+                        const sm_date* dates, size_t n_date, sm_result* out);
+/* 時系列: 時刻 (t0_sec, t0_nsec) から step_ns 間隔で n 点の視位置（観測者の ht は未使用,
+   lat・lng の範囲は sm_calc_batch と同じ）
+   （戻り値: SM_OK, SM_BAD_INPUT, SM_FAILED） */
+int       sm_track(sm_ctx* ctx, int body, const sm_observer* obs,
+                   int64_t t0_sec, int32_t t0_nsec, int64_t step_ns,
+                   size_t n, sm_altaz* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
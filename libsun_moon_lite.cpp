@@ -0,0 +1,522 @@
+#include "libsun_moon_lite.h"
+#include "delta_t.hpp"
+#include "ephem.hpp"
+#include "eop_tbl.hpp"
+
+#include <cmath>
+
+// 軽量版（組込み機器向け）
+// * Calc・Time と同じ計算を、例外・ヒープ・iostream・タイムゾーンを使わずに行う
+//   （計算式・演算順は Calc と同一のため、結果も同一）
+// * 反復計算には回数の上限を設ける（超えた場合は SM_NO_CONV）
+
+namespace {
+
+namespace ns = sun_moon;
+
+// 定数
+constexpr std::int64_t  kJstOffset = 32400;            // JST - UTC (secs)
+constexpr unsigned int  kJstUtc    = 9;                // JST - UTC (hours)
+constexpr unsigned int  kSecDay    = 86400;            // Seconds in a day (secs)
+constexpr double        kDipCoef   = 0.0353333;        // 地平線伏角計算用係数
+constexpr double        kEps       = 0.5e-4;           // ループ処理閾値
+constexpr double        kPi        = atan(1.0) * 4.0;  // 円周率
+constexpr double        kPi180     = kPi / 180.0;      // 円周率 / 180
+constexpr double        kAstrRef   = 0.585556;         // 大気差(astro refract)
+constexpr unsigned int  kMaxIter   = 1000;             // 出入・南中: 反復回数の上限
+constexpr double        kSynMonth  = 29.530589;        // 平均朔望月(日)
+constexpr double        kAuKm      = 149597870.7;      // 天文単位(km)
+constexpr double        kEarthR    = 6378.14;          // 地球赤道半径(km)
+constexpr double        kTtTai     = 32.184;           // TT - TAI
+constexpr double        kTrnEdge   = 0.485;            // 日南中: 直接計算する平均南中時刻の範囲(0.5 ± 日)
+
+/*
+ * @brief      計算: 月の日数
+ *
+ * @param[in]  年 (int)
+ * @param[in]  月 (int)
+ * @return     日数 (int)
+ */
+int days_in_month(int y, int m) {
+  static constexpr int kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+
+  return m == 2 && leap ? 29 : kDays[m - 1];
+}
+
+/*
+ * @brief      変換: 年月日(先発グレゴリオ暦) -> 1970年1月1日からの日数
+ *
+ * @param[in]  年（天文学的年: 紀元前 1 年 = 0） (int)
+ * @param[in]  月 (unsigned int)
+ * @param[in]  日 (unsigned int)
+ * @return     日数 (int64_t)
+ */
+std::int64_t days_from_civil(int y, unsigned int m, unsigned int d) {
+  std::int64_t era;
+  unsigned int yoe;  // 400 年周期内の年
+  unsigned int doy;  // 3 月起算の年内日数
+  unsigned int doe;  // 400 年周期内の日数
+
+  y  -= m <= 2;
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = unsigned(y - era * 400);
+  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + std::int64_t(doe) - 719468;
+}
+
+/*
+ * @brief      計算: 2000年1月1日力学時正午からの経過日数（day_progress と同じ式）
+ *
+ * @param[in]  日付(JST) (sm_date)
+ * @return     経過日数 (double)
+ */
+double day_progress(const sm_date& dt) {
+  int          y = dt.year - 2000;
+  unsigned int m = dt.month;
+  unsigned int d = dt.day;
+
+  // 1月,2月は前年の13月,14月とする
+  if (m < 3) {
+    --y;
+    m += 12;
+  }
+
+  return 365.0 * y + 30.0 * m + d
+       - 33.5 - kJstUtc / 24.0
+       + int(3 * (m + 1) / 5.0)
+       + int(y / 4.0);
+}
+
+/*
+ * @brief      計算: ΔT（Time と同じく JST 00:00:00 の 9 時間前、すなわち前日の日付で求める）
+ *
+ * @param[in]   日付(JST) (sm_date)
+ * @param[out]  EOP 一覧から求めた (int32_t, 0: 範囲外のため近似式)
+ * @return      ΔT (float)
+ */
+float calc_dlt_t(const sm_date& dt, std::int32_t& f_eop) {
+  int y = dt.year;
+  int m = dt.month;
+  int d = dt.day - 1;
+  std::int32_t ymd;
+  int   utc_tai = 0;
+  float dut1    = 0.0;
+  double yy;
+  int i;
+
+  // 前日
+  if (d < 1) {
+    if (--m < 1) {
+      m = 12;
+      --y;
+    }
+    d = days_in_month(y, m);
+  }
+  ymd = y * 10000 + m * 100 + d;
+  // うるう秒, DUT1（末尾から探索）
+  for (i = sizeof(ns::kEopLs) / sizeof(ns::kEopLs[0]) - 1; i >= 0; --i) {
+    if (ns::kEopLs[i].ymd <= ymd) {
+      utc_tai = ns::kEopLs[i].utc_tai;
+      break;
+    }
+  }
+  for (i = sizeof(ns::kEopDut) / sizeof(ns::kEopDut[0]) - 1; i >= 0; --i) {
+    if (ns::kEopDut[i].ymd <= ymd) {
+      dut1 = ns::kEopDut[i].dut1;
+      break;
+    }
+  }
+  f_eop = utc_tai != 0;
+  if (f_eop) return kTtTai - utc_tai - dut1;
+  yy = y + (m - 0.5) / 12;
+  if (y <  -500) return ns::calc_dlt_t_bf_m500(yy);
+  if (y <   500) return ns::calc_dlt_t_bf_0500(yy);
+  if (y <  1600) return ns::calc_dlt_t_bf_1600(yy);
+  if (y <  1700) return ns::calc_dlt_t_bf_1700(yy);
+  if (y <  1800) return ns::calc_dlt_t_bf_1800(yy);
+  if (y <  1860) return ns::calc_dlt_t_bf_1860(yy);
+  if (y <  1900) return ns::calc_dlt_t_bf_1900(yy);
+  if (y <  1920) return ns::calc_dlt_t_bf_1920(yy);
+  if (y <  1941) return ns::calc_dlt_t_bf_1941(yy);
+  if (y <  1961) return ns::calc_dlt_t_bf_1961(yy);
+  if (y <  1986) return ns::calc_dlt_t_bf_1986(yy);
+  if (y <  2005) return ns::calc_dlt_t_bf_2005(yy);
+  if (y <  2050) return ns::calc_dlt_t_bf_2050(yy);
+  if (y <= 2150) return ns::calc_dlt_t_to_2150(yy);
+  return ns::calc_dlt_t_af_2150(yy);
+}
+
+/*
+ * @brief      計算: 観測地点の恒星時Θ(度)
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  経過ユリウス年 (double)
+ * @param[in]  時刻 (double)
+ * @return     恒星時Θ(度) (double)
+ */
+double tm_sidereal(const sm_lite_state& st, double jy, double tm) {
+  return ns::norm_ang(325.4606
+                    + 360.007700536 * jy
+                    + 0.00000003879 * jy * jy
+                    + 360.0 * tm + st.lng);
+}
+
+/*
+ * @brief      計算: 出入点(k)の時角(tk)と天体の時角(t)との差(dt=tk-t)
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  天体の赤緯・赤経 (Coord)
+ * @param[in]  恒星時Θ(度) (double)
+ * @param[in]  観測地点の出没高度(度) (double)
+ * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
+ * @return     時角差 (double)
+ */
+double hour_ang_diff(const sm_lite_state& st, ns::Coord cd_s, double tm_sd, double ht,
+                     unsigned int kbn) {
+  double dt;
+  double tk;
+
+  // 南中の場合は天体の時角を返す
+  if (kbn == 2) {
+    tk = 0.0;
+  } else {
+    tk  = std::sin(kPi180 * ht)
+        - std::sin(kPi180 * cd_s.lat) * std::sin(kPi180 * st.lat);
+    tk /= std::cos(kPi180 * cd_s.lat) * std::cos(kPi180 * st.lat);
+    // 出没点の時角
+    tk = std::acos(tk) / kPi180;
+    // tkは出のときマイナス、入のときプラス
+    if (kbn == 0 && tk > 0.0) { tk = std::abs(tk) * -1.0; }
+    if (kbn == 1 && tk < 0.0) { tk = std::abs(tk); }
+  }
+  // 天体の時角
+  dt = tk - tm_sd + cd_s.lng;
+  // dtの絶対値を180°以下に調整
+  while (dt >  180.0) { dt -= 360.0; }
+  while (dt < -180.0) { dt += 360.0; }
+
+  return dt;
+}
+
+/*
+ * @brief      計算: 赤道座標・恒星時における天体の方位角
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  天体の赤道座標 (Coord)
+ * @param[in]  恒星時Θ(度) (double)
+ * @return     方位角(度) (double)
+ */
+double calc_azimuth(const sm_lite_state& st, ns::Coord cd_s, double tm_sd) {
+  double hang = tm_sd - cd_s.lng;  // 天体の時角
+  double a_0;
+  double a_1;
+  double ang;
+
+  a_0 = -std::cos(kPi180 * cd_s.lat) * std::sin(kPi180 * hang);
+  a_1 =  std::sin(kPi180 * cd_s.lat) * std::cos(kPi180 * st.lat)
+      -  std::cos(kPi180 * cd_s.lat) * std::sin(kPi180 * st.lat)
+       * std::cos(kPi180 * hang);
+  ang = std::atan(a_0 / a_1) / kPi180;
+  // 分母がプラスのときは -90°< ang < 90°
+  if (a_1 > 0.0 && ang < 0.0) { ang += 360.0; }
+  // 分母がマイナスのときは 90°< ang < 270° → 180°加算する
+  if (a_1 < 0.0) { ang += 180.0; }
+
+  return ang;
+}
+
+/*
+ * @brief      計算: 時刻(t)における黄経、黄緯の天体の高度（ラドーの式で大気差を補正）
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  天体の黄道座標 (Coord)
+ * @param[in]  時刻(日) (double)
+ * @param[in]  経過ユリウス年 (double)
+ * @return     高度(度) (double)
+ */
+double calc_height(const sm_lite_state& st, ns::Coord cd_k, double dd, double jy) {
+  ns::Coord cd_s  = ns::ko2se(jy, cd_k);        // 赤道座標
+  double    tm_sd = tm_sidereal(st, jy, dd);    // 恒星時
+  double    hang  = tm_sd - cd_s.lng;           // 天体の時角
+  double    tan_ht;
+  double    ht;
+
+  ht  = std::sin(kPi180 * cd_s.lat) * sin(kPi180 * st.lat)
+      + std::cos(kPi180 * cd_s.lat) * cos(kPi180 * st.lat)
+      * std::cos(kPi180 * hang);
+  ht  = std::asin(ht) / kPi180;
+  tan_ht = std::tan(kPi180 * (90.0 - ht));
+  ht += (58.76 - (0.406 - 0.0192 * tan_ht) * tan_ht) * tan_ht / 3600.0;
+
+  return ht;
+}
+
+/*
+ * @brief      計算: 日の出・入・南中時刻
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
+ * @param[out] 時刻(日) (double)
+ * @return     成否（反復回数の上限に達した場合は false） (bool)
+ */
+bool calc_time_sun(const sm_lite_state& st, unsigned int kbn, double& tm) {
+  double jy;
+  double rev = 1.0;
+  double dist;
+  double ht;
+  ns::Coord cd_k = {0.0, 0.0};
+  ns::Coord cd_s;
+  unsigned int n_it = 0;
+
+  tm = 0.5;
+  while (std::abs(rev) > kEps) {
+    if (++n_it > kMaxIter) return false;
+    jy       = (st.day_p + tm + st.dlt_t_d) / 365.25;
+    cd_k.lng = ns::lmd_sun(jy);
+    dist     = ns::dist_sun(jy);
+    cd_s     = ns::ko2se(jy, cd_k);
+    ht       = -(0.266994 / dist) - kAstrRef - st.dip + 0.0024428 / dist;
+    rev      = hour_ang_diff(st, cd_s, tm_sidereal(st, jy, tm), ht, kbn) / 360.0;
+    tm      += rev;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      計算: 日の南中時刻（Calc::calc_transit_sun と同じく平均南中時刻から直接, 補正 1 回）
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[out] 時刻(日) (double)
+ * @return     成否 (bool)
+ */
+bool calc_transit_sun(const sm_lite_state& st, double& tm) {
+  double jy;
+  ns::Coord cd_k = {0.0, 0.0};
+  ns::Coord cd_s;
+  unsigned int i;
+
+  // 平均南中時刻（JST 正午に最も近いもの）。日付の境界付近は反復で求める
+  tm = (135.0 - st.lng) / 360.0;
+  tm = 0.5 + tm - std::floor(tm + 0.5);
+  if (std::abs(tm - 0.5) > kTrnEdge) return calc_time_sun(st, 2, tm);
+  for (i = 0; i < 2; ++i) {
+    jy       = (st.day_p + tm + st.dlt_t_d) / 365.25;
+    cd_k.lng = ns::lmd_sun(jy);
+    cd_s     = ns::ko2se(jy, cd_k);
+    tm      += hour_ang_diff(st, cd_s, tm_sidereal(st, jy, tm), 0.0, 2) / 360.0;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      計算: 月の出・入・南中時刻
+ *
+ * @param[in]  計算状態 (sm_lite_state)
+ * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
+ * @param[out] 時刻(日, 当日中にない場合は -1.0) (double)
+ * @return     成否（反復回数の上限に達した場合は false） (bool)
+ */
+bool calc_time_moon(const sm_lite_state& st, unsigned int kbn, double& tm) {
+  double jy;
+  double rev = 1.0;
+  double ht  = 0.0;
+  ns::Coord cd_k = {0.0, 0.0};
+  ns::Coord cd_s;
+  unsigned int n_it = 0;
+
+  tm = 0.5;
+  while (std::abs(rev) > kEps) {
+    if (++n_it > kMaxIter) return false;
+    jy       = (st.day_p + tm + st.dlt_t_d) / 365.25;
+    cd_k.lng = ns::lmd_moon(jy);
+    cd_k.lat = ns::bet_moon(jy);
+    cd_s     = ns::ko2se(jy, cd_k);
+    // 南中の時は計算しない
+    if (kbn != 2) ht = ns::diff_moon(jy) - st.dip - kAstrRef;
+    rev      = hour_ang_diff(st, cd_s, tm_sidereal(st, jy, tm), ht, kbn) / 347.8;
+    tm      += rev;
+  }
+  if (tm < 0.0 || tm >= 1.0) { tm = -1.0; }
+
+  return true;
+}
+
+/*
+ * @brief       設定: イベント（時刻は Calc と同じく秒未満をナノ秒に切り捨て）
+ *
+ * @param[in]   計算状態 (sm_lite_state)
+ * @param[in]   時刻(日) (double)
+ * @param[in]   方位角／高度 (double)
+ * @param[out]  イベント (sm_event)
+ * @return      none
+ */
+void set_event(const sm_lite_state& st, double dd, double ah, sm_event& ev) {
+  double dd_s = dd * kSecDay;
+
+  ev.sec    = st.jst + int(dd_s);
+  ev.nsec   = std::int32_t((dd_s - int(dd_s)) * 1.0e9);
+  ev.status = SM_OK;
+  ev.ah     = ah;
+  if (ev.nsec >= 1000000000) {
+    ev.nsec -= 1000000000;
+    ++ev.sec;
+  }
+}
+
+/*
+ * @brief       設定: 状態のみのイベント
+ *
+ * @param[in]   状態コード (int)
+ * @param[in]   方位角／高度 (double)
+ * @param[out]  イベント (sm_event)
+ * @return      状態コード (int)
+ */
+int set_status(int status, double ah, sm_event& ev) {
+  ev.sec    = 0;
+  ev.nsec   = 0;
+  ev.status = status;
+  ev.ah     = ah;
+
+  return status;
+}
+
+}  // namespace
+
+extern "C" {
+
+uint64_t sm_lite_eop_ver(void) {
+  return ns::kEopVer;
+}
+
+int sm_lite_init(sm_lite_state* st, const sm_date* date, const sm_observer* obs) {
+  if (!st || !date || !obs || date->month < 1 || date->month > 12 || date->day < 1
+      || date->day > days_in_month(date->year, date->month)
+      || !std::isfinite(obs->lat) || !std::isfinite(obs->lng)
+      || std::abs(obs->lat) > 90.0 || !(obs->ht >= 0.0)) return SM_BAD_INPUT;
+  st->jst      = days_from_civil(date->year, date->month, date->day) * kSecDay - kJstOffset;
+  st->lat      = obs->lat;
+  st->lng      = obs->lng;
+  st->dlt_t_d  = double(calc_dlt_t(*date, st->f_eop)) / kSecDay;
+  st->dip      = kDipCoef * std::sqrt(obs->ht);
+  st->day_p    = day_progress(*date);
+  st->jy_mt    = 0.0;
+  st->mt_lat   = 0.0;
+  st->mt_lng   = 0.0;
+  st->f_mt     = 0;
+
+  return SM_OK;
+}
+
+int sm_lite_sun(const sm_lite_state* st, int kbn, sm_event* ev) {
+  double dd;
+  double jy;
+  ns::Coord cd_k;
+
+  if (!st || !ev || kbn < SM_RISE || kbn > SM_TRANSIT) return SM_BAD_INPUT;
+  if (!(kbn == SM_TRANSIT ? calc_transit_sun(*st, dd) : calc_time_sun(*st, kbn, dd)))
+    return set_status(SM_NO_CONV, -1.0, *ev);
+  // 白夜・極夜（出没点の時角が求まらない）
+  if (std::isnan(dd)) return set_status(SM_NO_EVENT, -1.0, *ev);
+  jy   = (st->day_p + dd + st->dlt_t_d) / 365.25;
+  cd_k = {0.0, ns::lmd_sun(jy)};
+  set_event(*st, dd, kbn == SM_TRANSIT
+                   ? calc_height(*st, cd_k, dd, jy)
+                   : calc_azimuth(*st, ns::ko2se(jy, cd_k), tm_sidereal(*st, jy, dd)), *ev);
+
+  return SM_OK;
+}
+
+int sm_lite_moon(sm_lite_state* st, int kbn, sm_event* ev) {
+  double dd;
+  double jy;
+  ns::Coord cd_k;
+
+  if (!st || !ev || kbn < SM_RISE || kbn > SM_TRANSIT) return SM_BAD_INPUT;
+  if (!calc_time_moon(*st, kbn, dd)) return set_status(SM_NO_CONV, -1.0, *ev);
+  if (std::isnan(dd) || dd < 0.0) return set_status(SM_NO_EVENT, -1.0, *ev);
+  jy   = (st->day_p + dd + st->dlt_t_d) / 365.25;
+  cd_k = {ns::bet_moon(jy), ns::lmd_moon(jy)};
+  if (kbn == SM_TRANSIT) {
+    // 位相の計算用に保持
+    st->f_mt   = 1;
+    st->jy_mt  = jy;
+    st->mt_lat = cd_k.lat;
+    st->mt_lng = cd_k.lng;
+    set_event(*st, dd, calc_height(*st, cd_k, dd, jy), *ev);
+  } else {
+    set_event(*st, dd, calc_azimuth(*st, ns::ko2se(jy, cd_k), tm_sidereal(*st, jy, dd)), *ev);
+  }
+
+  return SM_OK;
+}
+
+int sm_lite_phase_calc(const sm_lite_state* st, sm_lite_phase* ph) {
+  double jy;
+  ns::Coord cd_k;
+  ns::Coord cd_sm;
+  ns::Coord cd_ss;
+  double lmd_s;
+  double r_s;
+  double r_m;
+  double elg;
+  double da;
+
+  if (!st || !ph) return SM_BAD_INPUT;
+  if (st->f_mt) {
+    jy   = st->jy_mt;
+    cd_k = {st->mt_lat, st->mt_lng};
+  } else {
+    jy   = (st->day_p + 0.5 + st->dlt_t_d) / 365.25;
+    cd_k = {ns::bet_moon(jy), ns::lmd_moon(jy)};
+  }
+  lmd_s = ns::lmd_sun(jy);
+  r_s   = ns::dist_sun(jy) * kAuKm;
+  r_m   = kEarthR / std::sin(kPi180 * ns::diff_moon(jy));
+  // 月齢（黄経差を平均朔望月で換算）
+  elg = ns::norm_ang(cd_k.lng - lmd_s);
+  if (elg < 0.0) elg += 360.0;
+  ph->age = elg / 360.0 * kSynMonth;
+  // 離角 -> 位相角・輝面比
+  elg = std::acos(std::cos(kPi180 * cd_k.lat)
+                * std::cos(kPi180 * (cd_k.lng - lmd_s)));
+  ph->ph_ang = std::atan2(r_s * std::sin(elg), r_m - r_s * std::cos(elg)) / kPi180;
+  ph->illum  = (1.0 + std::cos(kPi180 * ph->ph_ang)) / 2.0;
+  // 明縁の位置角
+  cd_sm = ns::ko2se(jy, cd_k);
+  cd_ss = ns::ko2se(jy, {0.0, lmd_s});
+  da    = kPi180 * (cd_ss.lng - cd_sm.lng);
+  ph->limb = std::atan2(
+      std::cos(kPi180 * cd_ss.lat) * std::sin(da),
+      std::sin(kPi180 * cd_ss.lat) * std::cos(kPi180 * cd_sm.lat)
+    - std::cos(kPi180 * cd_ss.lat) * std::sin(kPi180 * cd_sm.lat) * std::cos(da))
+    / kPi180;
+  if (ph->limb < 0.0) ph->limb += 360.0;
+
+  return SM_OK;
+}
+
+int sm_lite_calc(const sm_date* date, const sm_observer* obs, sm_result* out) {
+  sm_lite_state st;
+  int i;
+
+  if (!out) return SM_BAD_INPUT;
+  out->eop_ver = ns::kEopVer;
+  out->flags   = 0;
+  out->status  = sm_lite_init(&st, date, obs);
+  if (out->status != SM_OK) {
+    for (i = 0; i < 3; ++i) out->sun[i] = out->moon[i] = {0, 0, SM_BAD_INPUT, 0.0};
+    return out->status;
+  }
+  for (i = 0; i < 3; ++i) sm_lite_sun(&st, i, &out->sun[i]);
+  for (i = 0; i < 3; ++i) sm_lite_moon(&st, i, &out->moon[i]);
+  if (!st.f_eop) out->flags |= SM_F_NO_EOP;
+
+  return out->status;
+}
+
+}  // extern "C"
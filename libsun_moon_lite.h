@@ -0,0 +1,63 @@
+/*
+ * libsun_moon_lite: 日・月の出・南中・入 計算の軽量版 C ABI（組込み機器向け）
+ *
+ * * libsun_moon.h の型・状態コードを使用し、関数は本ヘッダのもののみ提供する
+ * * ヒープ確保・iostream・例外を使用しない（-fno-exceptions -fno-rtti でビルド）
+ * * EOP(うるう秒, DUT1)一覧はビルド時の LEAP_SEC.txt, DUT1.txt から生成した静的な表
+ *   （実行時のファイル読込なし。更新は再ビルド）
+ * * 状態は呼び出し側で確保する（スタック上の sm_lite_state で可）
+ * * 日付は JST（グレゴリオ暦）。プロセスのタイムゾーンには依存しない
+ * * 結果は libsun_moon の sm_calc_batch と同一（同じ EOP 一覧の場合）。
+ *   出没点の時角が求まらない日（白夜・極夜等）は SM_NO_EVENT、反復が収束しない場合は
+ *   SM_NO_CONV（イベント毎）
+ */
+#ifndef LIBSUN_MOON_LITE_H_
+#define LIBSUN_MOON_LITE_H_
+
+#include "libsun_moon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 計算状態（1 日・1 地点分。内容は sm_lite_init で設定） */
+typedef struct {
+  int64_t jst;       /* JST 00:00:00 (UNIX 秒) */
+  double  lat;       /* 観測者: 緯度 */
+  double  lng;       /* 観測者: 経度 */
+  double  dlt_t_d;   /* ΔT の日換算値 */
+  double  dip;       /* 地平線伏角 */
+  double  day_p;     /* 2000年1月1日力学時正午からの経過日数 */
+  double  jy_mt;     /* 月南中時の経過ユリウス年 */
+  double  mt_lat;    /* 月南中時の黄緯 */
+  double  mt_lng;    /* 月南中時の黄経 */
+  int32_t f_mt;      /* 月南中の黄道座標を保持済み */
+  int32_t f_eop;     /* ΔT を EOP 一覧から求めた */
+} sm_lite_state;
+
+/* 月の位相（月南中時, 南中がない日は正午の値） */
+typedef struct {
+  double ph_ang;  /* 位相角(度, 0: 満月 〜 180: 新月) */
+  double illum;   /* 輝面比(0: 新月 〜 1: 満月) */
+  double age;     /* 月齢(日) */
+  double limb;    /* 明縁の位置角(度, 天の北極方向から東回り) */
+} sm_lite_phase;
+
+/* 静的 EOP 一覧の版数（DUT1 一覧の最終日付 YYYYMMDD） */
+uint64_t sm_lite_eop_ver(void);
+/* 初期化: 日付・観測者（戻り値: SM_OK, SM_BAD_INPUT） */
+int sm_lite_init(sm_lite_state* st, const sm_date* date, const sm_observer* obs);
+/* 計算: 日の出・入・南中（kbn: SM_RISE, SM_SET, SM_TRANSIT。戻り値は ev->status） */
+int sm_lite_sun(const sm_lite_state* st, int kbn, sm_event* ev);
+/* 計算: 月の出・入・南中（同上。SM_TRANSIT の計算で位相用の座標を st に保持） */
+int sm_lite_moon(sm_lite_state* st, int kbn, sm_event* ev);
+/* 計算: 月の位相（sm_lite_moon(SM_TRANSIT) の後に呼ぶと再計算を省く） */
+int sm_lite_phase_calc(const sm_lite_state* st, sm_lite_phase* ph);
+/* 計算: 日付・観測者 1 件の出・入・南中一括（戻り値: out->status） */
+int sm_lite_calc(const sm_date* date, const sm_observer* obs, sm_result* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
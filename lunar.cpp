@@ -0,0 +1,133 @@
+#include "lunar.hpp"
+#include "ephem.hpp"
+#include "time.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double       kSynMonth = 29.530588861;   // 平均朔望月(日)
+static constexpr double       kNewMoon0 = 5.09766;        // 朔望月番号 0 の平均朔（J2000.0 からの日数, TT）
+static constexpr double       kElgRate  = 360.0 / kSynMonth;  // 黄経差の平均変化率(度/日)
+static constexpr double       kUnixJ2k  = 946728000.0;    // J2000.0 (2000-01-01 12:00) の UNIX 秒
+static constexpr double       kTol      = 1.0e-7;         // 収束判定(日, 約 0.01 秒)
+static constexpr double       kBrk      = 2.0;            // 初期の挟み込み: 平均月相からの幅(日)
+static constexpr unsigned int kMaxIter  = 40;             // 反復回数の上限（二分法のみでも収束する回数）
+
+/*
+ * @brief      計算: 経過日数(TT) 直前の朔望月番号（平均朔による概算）
+ *
+ * @param[in]  2000年1月1日力学時正午からの経過日数 (double)
+ * @return     朔望月番号 (int64_t)
+ */
+std::int64_t lunation_of(double t) {
+  return std::int64_t(std::floor((t - kNewMoon0) / kSynMonth));
+}
+
+/*
+ * @brief      計算: 黄経差の目標値からのずれ（-180° 〜 180°）
+ *
+ * @param[in]  月の黄経 (double)
+ * @param[in]  太陽の黄経 (double)
+ * @param[in]  区分 (unsigned int, 目標は 90° × 区分)
+ * @return     ずれ(度) (double)
+ */
+static double elong_err(double lmd_m, double lmd_s, unsigned int q) {
+  double d = std::fmod(lmd_m - lmd_s - 90.0 * q, 360.0);
+
+  if (d >= 180.0) d -= 360.0;
+  if (d < -180.0) d += 360.0;
+
+  return d;
+}
+
+/*
+ * @brief       計算: 朔望月 n 個分の月相
+ *              (黄経差のずれの根を、平均月相の時刻から割線法で求める。
+ *               * 挟み込み: 平均月相 ± kBrk 日から始め（黄経差は単調に増加し、真の時刻と
+ *                 平均月相の差は 1 日未満のため、両端でずれの符号は異なる）、評価した点の
+ *                 ずれの符号で狭める。割線法の次の点が挟み込みの外になれば二分法で進める
+ *               * kMaxIter 回で収束しない場合は例外を送出する
+ *               全月相をまとめて 1 反復ずつ進め、未収束の分の黄経を lmd_sun_n /
+ *               lmd_moon_n で一括評価する。ΔT は各月相の時刻について Time::calc_dlt_t で求める)
+ *
+ * @param[in]   先頭の朔望月番号 (int64_t)
+ * @param[in]   朔望月数 n (size_t)
+ * @param[in]   EOP 一覧 (shared_ptr<const EopTable>)
+ * @param[out]  月相 (PhaseEv[n * 4], 時刻順)
+ * @return      none
+ */
+void find_phases(std::int64_t k_0, std::size_t n,
+                 std::shared_ptr<const EopTable> eop, PhaseEv* out) {
+  std::size_t m = n * 4;          // 件数
+  std::vector<double> t0(m);      // 割線法: 前回の時刻
+  std::vector<double> f0(m);      // 割線法: 前回のずれ
+  std::vector<double> t1(m);      // 割線法: 今回の時刻
+  std::vector<double> lo(m);      // 挟み込み: 下端（ずれ < 0）
+  std::vector<double> hi(m);      // 挟み込み: 上端（ずれ >= 0）
+  std::vector<std::size_t> act;   // 未収束の添字
+  std::vector<double> jy;         // 評価点（経過ユリウス年）
+  std::vector<double> ls;         // 太陽の黄経
+  std::vector<double> lm;         // 月の黄経
+  std::size_t i;
+  std::size_t j;
+  unsigned int it;
+  double f;
+  double t;
+  struct timespec ts;
+
+  try {
+    for (i = 0; i < m; ++i) {
+      t1[i] = kNewMoon0 + kSynMonth * (double(k_0 + std::int64_t(i / 4)) + 0.25 * (i % 4));
+      lo[i] = t1[i] - kBrk;
+      hi[i] = t1[i] + kBrk;
+      act.push_back(i);
+    }
+    for (it = 0; it < kMaxIter && !act.empty(); ++it) {
+      jy.resize(act.size());
+      ls.resize(act.size());
+      lm.resize(act.size());
+      for (j = 0; j < act.size(); ++j) jy[j] = t1[act[j]] / 365.25;
+      lmd_sun_n(jy.data(), jy.size(), ls.data());
+      lmd_moon_n(jy.data(), jy.size(), lm.data());
+      for (j = 0, i = 0; j < act.size(); ++j) {
+        std::size_t a = act[j];
+        f = elong_err(lm[j], ls[j], a % 4);
+        (f < 0.0 ? lo[a] : hi[a]) = t1[a];
+        if (it == 0 || f == f0[a]) {
+          t = t1[a] - f / kElgRate;                            // 平均変化率で 1 歩
+        } else {
+          t = t1[a] - f * (t1[a] - t0[a]) / (f - f0[a]);       // 割線法
+        }
+        if (!(t >= lo[a] && t <= hi[a])) t = 0.5 * (lo[a] + hi[a]);  // 挟み込みの外: 二分法
+        t0[a] = t1[a];
+        f0[a] = f;
+        t1[a] = t;
+        if (std::abs(t - t0[a]) > kTol) act[i++] = a;
+      }
+      act.resize(i);
+    }
+    if (!act.empty()) throw std::runtime_error("Lunar phase did not converge");
+    for (i = 0; i < m; ++i) {
+      out[i].k    = k_0 + std::int64_t(i / 4);
+      out[i].q    = LunarPhase(i % 4);
+      out[i].t_tt = t1[i];
+      // ΔT（その時刻の UT による）
+      ts.tv_sec  = std::llround(kUnixJ2k + t1[i] * 86400.0);
+      ts.tv_nsec = 0;
+      Time o_tm(eop);
+      int   utc_tai = o_tm.get_utc_tai(ts);
+      float dut1    = o_tm.get_dut1(ts);
+      out[i].dlt_t = o_tm.calc_dlt_t(ts, utc_tai, dut1);
+      out[i].unix  = kUnixJ2k + t1[i] * 86400.0 - out[i].dlt_t;
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,36 @@
+#ifndef SUN_MOON_LUNAR_HPP_
+#define SUN_MOON_LUNAR_HPP_
+
+#include "eop.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace sun_moon {
+
+// 月相（朔・上弦・望・下弦, 太陽との黄経差 0°, 90°, 180°, 270°）
+enum LunarPhase : unsigned int {
+  kLpNew = 0,  // 朔（新月）
+  kLpFirst,    // 上弦
+  kLpFull,     // 望（満月）
+  kLpLast,     // 下弦
+};
+
+// 月相の瞬間
+struct PhaseEv {
+  std::int64_t k;      // 朔望月番号（2000年1月6日の朔を 0 とする）
+  LunarPhase   q;      // 区分
+  double       t_tt;   // 時刻（2000年1月1日力学時正午からの経過日数, TT）
+  double       dlt_t;  // ΔT(秒)
+  double       unix;   // 時刻（UNIX 秒, UT）
+};
+
+std::int64_t lunation_of(double);  // 計算: 経過日数(TT) 直前の朔望月番号
+void find_phases(std::int64_t, std::size_t, std::shared_ptr<const EopTable>, PhaseEv*);
+                                   // 計算: 朔望月 n 個分の月相（n × 4 件）
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,220 @@
+#include "poa.hpp"
+#include "input.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double kPi    = atan(1.0) * 4.0;  // 円周率
+static constexpr double kPi180 = kPi / 180.0;      // 円周率 / 180
+
+/*
+ * @brief      設定: 太陽の時系列（方向ベクトルに変換して保持）
+ *
+ * @param[in]  太陽の視位置 (AltAz[n])
+ * @param[in]  点数 (size_t)
+ * @return     none
+ */
+void PoaKernel::set_sun(const struct AltAz* sun, std::size_t n) {
+  double ca;  // cos(高度)
+
+  sx.resize(n);
+  sy.resize(n);
+  sz.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    ca    = std::cos(kPi180 * sun[i].alt);
+    sx[i] = ca * std::sin(kPi180 * sun[i].az);
+    sy[i] = ca * std::cos(kPi180 * sun[i].az);
+    sz[i] = std::sin(kPi180 * sun[i].alt);
+  }
+}
+
+/*
+ * @brief       計算: 1 面 × 時刻範囲
+ *
+ * @param[in]   受光面 (Surface)
+ * @param[in]   先頭の点番号 (size_t)
+ * @param[in]   点数 (size_t)
+ * @param[out]  計算結果 (Poa[点数])
+ * @return      none
+ */
+void PoaKernel::run(const Surface& sf, std::size_t i_0, std::size_t n,
+                    Poa* out) const {
+  if (sf.type == kSfFixed) {
+    run_fixed(sf, i_0, n, out);
+  } else {
+    run_track(sf, i_0, n, out);
+  }
+}
+
+/*
+ * @brief       計算: 固定面（法線ベクトルとの内積）
+ *
+ * @param[in]   受光面 (Surface)
+ * @param[in]   先頭の点番号 (size_t)
+ * @param[in]   点数 (size_t)
+ * @param[out]  計算結果 (Poa[点数])
+ * @return      none
+ */
+void PoaKernel::run_fixed(const Surface& sf, std::size_t i_0, std::size_t n,
+                          Poa* out) const {
+  const double nx = std::sin(kPi180 * sf.tilt) * std::sin(kPi180 * sf.az);
+  const double ny = std::sin(kPi180 * sf.tilt) * std::cos(kPi180 * sf.az);
+  const double nz = std::cos(kPi180 * sf.tilt);
+  const double* px = sx.data() + i_0;
+  const double* py = sy.data() + i_0;
+  const double* pz = sz.data() + i_0;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i].cos_aoi = nx * px[i] + ny * py[i] + nz * pz[i];
+    out[i].rot     = 0.0;
+  }
+}
+
+/*
+ * @brief       計算: 一軸追尾
+ *              (太陽方向を回転軸の座標系へ変換し、理想回転角 atan2(x', z') を求める。
+ *               地表被覆率 gcr が指定されていれば、前後の列の影がかからない角度まで
+ *               戻し（バックトラッキング）、最大回転角で制限する)
+ *
+ * @param[in]   受光面 (Surface)
+ * @param[in]   先頭の点番号 (size_t)
+ * @param[in]   点数 (size_t)
+ * @param[out]  計算結果 (Poa[点数])
+ * @return      none
+ */
+void PoaKernel::run_track(const Surface& sf, std::size_t i_0, std::size_t n,
+                          Poa* out) const {
+  const double sa = std::sin(kPi180 * sf.az);    // 軸方位
+  const double ca = std::cos(kPi180 * sf.az);
+  const double st = std::sin(kPi180 * sf.tilt);  // 軸傾斜
+  const double ct = std::cos(kPi180 * sf.tilt);
+  const double r_max = kPi180 * sf.max_rot;
+  const double* px = sx.data() + i_0;
+  const double* py = sy.data() + i_0;
+  const double* pz = sz.data() + i_0;
+  double xp;   // 軸座標系: 軸の右方向
+  double zp;   // 軸座標系: 軸に垂直な面内の上方向
+  double r;    // 回転角(rad)
+  double c;    // バックトラッキング: |cos(理想回転角)| / gcr
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (pz[i] <= 0.0) {
+      // 太陽が地平線下: 水平待機
+      out[i].cos_aoi = ct * pz[i] + st * (sa * px[i] + ca * py[i]);
+      out[i].rot     = 0.0;
+      continue;
+    }
+    xp = px[i] * ca - py[i] * sa;
+    zp = px[i] * st * sa + py[i] * st * ca + pz[i] * ct;
+    r  = std::atan2(xp, zp);
+    if (sf.gcr > 0.0) {
+      c = std::abs(std::cos(r)) / sf.gcr;  // pvlib singleaxis と同じく絶対値（|r| > 90° でも 0 以上）
+      if (c < 1.0) r -= std::copysign(std::acos(c), r);
+    }
+    r = std::max(-r_max, std::min(r_max, r));
+    out[i].cos_aoi = xp * std::sin(r) + zp * std::cos(r);
+    out[i].rot     = r / kPi180;
+  }
+}
+
+/*
+ * @brief       計算: 太陽 n 点 × 受光面 m 面
+ *
+ * @param[in]   太陽の視位置 (AltAz[n])
+ * @param[in]   点数 (size_t)
+ * @param[in]   受光面 (Surface[m])
+ * @param[in]   面数 (size_t)
+ * @param[out]  計算結果 (Poa[m * n], 面 j・点 i は out[j * n + i])
+ * @return      none
+ */
+void calc_poa(const struct AltAz* sun, std::size_t n,
+              const Surface* sf, std::size_t m, Poa* out) {
+  PoaKernel o_k;
+
+  o_k.set_sun(sun, n);
+  for (std::size_t j = 0; j < m; ++j) o_k.run(sf[j], 0, n, out + j * n);
+}
+
+/*
+ * @brief       解析: 受光面 1 行
+ *              ("fixed,TILT,AZ" / "track,AXIS_TILT,AXIS_AZ,MAX_ROT,GCR",
+ *               区切りはカンマ・空白・タブ)
+ *
+ * @param[in]   行頭 (const char*)
+ * @param[in]   行末 (const char*)
+ * @param[ref]  受光面 (Surface)
+ * @return      成否 (bool)
+ */
+bool parse_surface(const char* p, const char* e, Surface& sf) {
+  const char* q;
+  double v[4] = {0.0, 0.0, 0.0, 0.0};
+  unsigned int n_v;
+  unsigned int i;
+
+  while (p < e && (*p == ' ' || *p == '\t')) ++p;
+  for (q = p; q < e && *q != ',' && *q != ' ' && *q != '\t'; ++q) {}
+  if (q - p == 5 && std::memcmp(p, "fixed", 5) == 0) {
+    sf.type = kSfFixed;
+    n_v = 2;
+  } else if (q - p == 5 && std::memcmp(p, "track", 5) == 0) {
+    sf.type = kSfTrack;
+    n_v = 4;
+  } else {
+    return false;
+  }
+  p = q;
+  for (i = 0; i < n_v; ++i) {
+    while (p < e && (*p == ',' || *p == ' ' || *p == '\t')) ++p;
+    if (!parse_num(p, e, v[i])) return false;
+  }
+  while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+  if (p != e) return false;
+  sf.tilt    = v[0];
+  sf.az      = v[1];
+  sf.max_rot = sf.type == kSfTrack ? v[2] : 0.0;
+  sf.gcr     = sf.type == kSfTrack ? v[3] : 0.0;
+
+  return std::isfinite(sf.tilt) && std::isfinite(sf.az)
+      && sf.max_rot >= 0.0 && sf.gcr >= 0.0 && sf.gcr <= 1.0;
+}
+
+/*
+ * @brief       読込: 受光面一覧（1 行 1 面, 空行・'#' で始まる行は無視）
+ *
+ * @param[in]   ファイル名 (string)
+ * @param[ref]  受光面一覧 (vector<Surface>)
+ * @return      成否 (bool)
+ */
+bool load_surfaces(const std::string& f, std::vector<Surface>& sfs) {
+  std::string ln;
+  unsigned int n_ln = 0;
+  Surface sf;
+
+  try {
+    std::ifstream ifs(f);
+    if (!ifs) return false;
+    while (std::getline(ifs, ln)) {
+      ++n_ln;
+      if (ln.empty() || ln[0] == '#' || ln == "\r") continue;
+      if (!parse_surface(ln.data(), ln.data() + ln.size(), sf)) {
+        std::cerr << "[ERROR] " << f << " line " << n_ln
+                  << ": malformed surface" << std::endl;
+        return false;
+      }
+      sfs.push_back(sf);
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return !sfs.empty();
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,62 @@
+#ifndef SUN_MOON_POA_HPP_
+#define SUN_MOON_POA_HPP_
+
+#include "track.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 受光面の種類
+enum SurfType : unsigned int {
+  kSfFixed = 0,  // 固定（傾斜角・方位角）
+  kSfTrack,      // 一軸追尾（バックトラッキング付き）
+};
+
+// 受光面
+// * 方位角は北 = 0, 東回り（度）
+// * 一軸追尾の回転角は、回転軸の方位を向いて右側へ傾く向きが正（軸方位 180° なら西向きが正）
+struct Surface {
+  SurfType type;     // 種類
+  double   tilt;     // 固定: 傾斜角, 一軸: 回転軸の傾斜角（度）
+  double   az;       // 固定: 面の方位角, 一軸: 回転軸の方位角（度）
+  double   max_rot;  // 一軸: 最大回転角（度）
+  double   gcr;      // 一軸: 地表被覆率（0: バックトラッキングなし）
+};
+
+// 入射角計算結果
+struct Poa {
+  double cos_aoi;  // 入射角の余弦（負は裏面側）
+  double rot;      // 一軸: 回転角（度, 太陽が地平線下では 0 = 水平待機）, 固定: 0
+};
+
+// 入射角計算
+// * 太陽の方向ベクトルを一度だけ求めて保持し、受光面毎に使い回す
+// * 太陽の時系列を連続配列(SoA)で持ち、受光面毎に時系列方向へ分岐の少ないループで計算する
+class PoaKernel {
+  std::vector<double> sx;  // 太陽方向: 東
+  std::vector<double> sy;  // 太陽方向: 北
+  std::vector<double> sz;  // 太陽方向: 天頂
+
+public:
+  void set_sun(const struct AltAz*, std::size_t);  // 設定: 太陽の時系列
+  std::size_t size() const { return sx.size(); }   // 取得: 時系列の点数
+  void run(const Surface&, std::size_t, std::size_t, Poa*) const;
+                                                   // 計算: 1 面 × 時刻範囲
+
+private:
+  void run_fixed(const Surface&, std::size_t, std::size_t, Poa*) const;  // 計算: 固定
+  void run_track(const Surface&, std::size_t, std::size_t, Poa*) const;  // 計算: 一軸追尾
+};
+
+void calc_poa(const struct AltAz*, std::size_t, const Surface*, std::size_t, Poa*);
+                            // 計算: 太陽 n 点 × 受光面 m 面（out[面 × n + 点]）
+bool parse_surface(const char*, const char*, Surface&);        // 解析: 受光面 1 行
+bool load_surfaces(const std::string&, std::vector<Surface>&);  // 読込: 受光面一覧
+
+}  // namespace sun_moon
+
+#endif
+
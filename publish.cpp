@@ -0,0 +1,340 @@
+#include "publish.hpp"
+#include "eop.hpp"
+#include "format.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>   // for EXIT_XXXX
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double       kPubHzMax  = 1000.0;  // 更新頻度の上限(Hz)
+static constexpr std::int64_t kNsSec     = 1000000000;  // 1 秒(ns)
+static constexpr std::int64_t kEopChkNs  = 1000000000;  // EOP ファイル監視間隔(ns)
+
+static volatile std::sig_atomic_t f_stop = 0;  // SIGINT / SIGTERM 受信フラグ
+
+/*
+ * @brief      SIGINT / SIGTERM ハンドラ（フラグを立てるのみ）
+ *
+ * @param[in]  シグナル番号 (int)
+ * @return     none
+ */
+static void on_stop(int) {
+  f_stop = 1;
+}
+
+/*
+ * @brief      現在時刻(ns, 時計の種類指定)
+ *
+ * @param[in]  時計 (clockid_t)
+ * @return     時刻(ns) (int64_t)
+ */
+static std::int64_t clock_ns(clockid_t clk) {
+  struct timespec ts;
+
+  clock_gettime(clk, &ts);
+  return std::int64_t(ts.tv_sec) * kNsSec + ts.tv_nsec;
+}
+
+/*
+ * @brief      計算: 共有メモリ内の各領域の位置・全体の大きさ
+ *
+ * @param[in]   地点数 (uint32_t)
+ * @param[out]  地点一覧の位置 (uint64_t)
+ * @param[out]  視位置の位置 (uint64_t)
+ * @return      全体の大きさ (uint64_t)
+ */
+static std::uint64_t pub_layout(std::uint32_t n_site,
+                                std::uint64_t& off_site, std::uint64_t& off_slot) {
+  off_site = (sizeof(PubHead) + 63) / 64 * 64;
+  off_slot = (off_site + std::uint64_t(n_site) * sizeof(AlmSite) + 63) / 64 * 64;
+  return off_slot + std::uint64_t(n_site) * 2 * sizeof(PubSlot);
+}
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+PubReader::PubReader()
+  : fd(-1), p_map(nullptr), s_map(0), head(nullptr), sites(nullptr), slots(nullptr) {}
+
+/*
+ * @brief  デストラクタ
+ */
+PubReader::~PubReader() {
+  if (p_map != nullptr) munmap(p_map, s_map);
+  if (fd >= 0) close(fd);
+}
+
+/*
+ * @brief      OPEN
+ *             (ヘッダを照合し、各領域が共有メモリ内に収まることを確かめる)
+ *
+ * @param[in]  共有メモリ名 (string, "/NAME")
+ * @return     成否 (bool)
+ */
+bool PubReader::open(const std::string& name) {
+  struct stat st;
+  std::uint64_t off_site;
+  std::uint64_t off_slot;
+  void* p;
+
+  try {
+    fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0 || fstat(fd, &st) != 0) return false;
+    s_map = st.st_size;
+    if (s_map < sizeof(PubHead)) return false;
+    p = mmap(nullptr, s_map, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    p_map = static_cast<char*>(p);
+    head  = reinterpret_cast<const PubHead*>(p_map);
+    if (std::memcmp(head->magic, kPubMagic, sizeof(kPubMagic)) != 0
+        || head->s_slot != sizeof(PubSlot) || head->period_ns <= 0
+        || pub_layout(head->n_site, off_site, off_slot) != s_map
+        || head->off_site != off_site || head->off_slot != off_slot)
+      return false;
+    sites = reinterpret_cast<const AlmSite*>(p_map + head->off_site);
+    slots = reinterpret_cast<const PubSlot*>(p_map + head->off_slot);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      参照: 地点 ID の番号
+ *
+ * @param[in]  地点 ID (const char*)
+ * @return     番号 (int64_t, ない場合は -1)
+ */
+std::int64_t PubReader::find(const char* id) const {
+  std::uint32_t s;
+
+  for (s = 0; s < head->n_site; ++s) {
+    if (std::strncmp(sites[s].id, id, kAlmIdLen) == 0) return s;
+  }
+
+  return -1;
+}
+
+/*
+ * @brief      計算: 視位置の経過時間（計算時刻から現在まで）
+ *
+ * @param[in]  視位置 (PubVec)
+ * @return     経過時間(ns) (int64_t)
+ */
+std::int64_t PubReader::age_ns(const struct PubVec& v) const {
+  return clock_ns(CLOCK_REALTIME) - (std::int64_t(v.sec) * kNsSec + v.nsec);
+}
+
+/*
+ * @brief      判定: 古い視位置
+ *             (書き手が停止した、または kPubStaleN 周期を超えて更新されていない)
+ *
+ * @param[in]  視位置 (PubVec)
+ * @return     古い (bool)
+ */
+bool PubReader::stale(const struct PubVec& v) const {
+  return head->pid.load(std::memory_order_relaxed) == 0
+      || age_ns(v) > std::int64_t(kPubStaleN) * head->period_ns;
+}
+
+/*
+ * @brief      実行: 視位置の定期計算・共有メモリへの公開
+ *             (一定周期（CLOCK_MONOTONIC の絶対時刻）で全地点の太陽・月の視高度・方位角を
+ *              Track と同じ式で計算し、地点毎の 2 スロットへ交互に書き込む。天体の黄道座標は
+ *              地点によらないため 1 周期 1 回のみ計算する。周期に遅れた場合は次の周期から再開し、
+ *              遅れた回数を終了時に報告する。EOP ファイルは 1 秒毎に更新を確認し、SIGHUP でも
+ *              再読込する。SIGINT / SIGTERM で停止し、停止を共有メモリに記録する)
+ *
+ * @param[in]  地点一覧 (vector<AlmSite>)
+ * @param[in]  共有メモリ名 (string, "/NAME")
+ * @param[in]  更新頻度(Hz) (double)
+ * @return     終了コード (int)
+ */
+int run_publish(const std::vector<AlmSite>& sites, const std::string& name, double hz) {
+  std::vector<Track> trk_s;   // 太陽（地点毎）
+  std::vector<Track> trk_m;   // 月（地点毎）
+  std::uint64_t off_site;
+  std::uint64_t off_slot;
+  std::uint64_t s_map;
+  std::int64_t  period;       // 更新周期(ns)
+  std::int64_t  t_next;       // 次の更新時刻(CLOCK_MONOTONIC, ns)
+  std::int64_t  t_eop;        // 次の EOP 確認時刻(CLOCK_MONOTONIC, ns)
+  std::uint64_t n_tick = 0;   // 更新回数
+  std::uint64_t n_late = 0;   // 周期に遅れた回数
+  struct timespec ts;
+  struct PubVec v;
+  PubHead* head;
+  PubSlot* slots;
+  void* p;
+  int fd;
+  std::size_t i;
+
+  try {
+    if (!(hz > 0.0 && hz <= kPubHzMax) || name.size() < 2 || name[0] != '/'
+        || name.find('/', 1) != std::string::npos) {
+      std::cerr << "[ERROR] Invalid argument!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    period = std::llround(kNsSec / hz);
+    Eop o_eop;
+    auto eop = o_eop.get();
+    auto make_tracks = [&] {
+      trk_s.clear();
+      trk_m.clear();
+      for (const auto& st : sites) {
+        trk_s.emplace_back(kBdSun,  st.lat, st.lng, eop);
+        trk_m.emplace_back(kBdMoon, st.lat, st.lng, eop);
+      }
+    };
+    make_tracks();
+
+    // 共有メモリ（既存の場合は作り直し。読み手はヘッダの照合で大きさの変化を検知する）
+    s_map = pub_layout(sites.size(), off_site, off_slot);
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, s_map) != 0) {
+      std::cerr << "[ERROR] Cannot create shared memory " << name << std::endl;
+      if (fd >= 0) close(fd);
+      return EXIT_FAILURE;
+    }
+    p = mmap(nullptr, s_map, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      std::cerr << "[ERROR] Cannot map shared memory " << name << std::endl;
+      return EXIT_FAILURE;
+    }
+    head  = static_cast<PubHead*>(p);
+    slots = reinterpret_cast<PubSlot*>(static_cast<char*>(p) + off_slot);
+    std::memcpy(static_cast<char*>(p) + off_site, sites.data(), sites.size() * sizeof(AlmSite));
+    head->n_site    = sites.size();
+    head->s_slot    = sizeof(PubSlot);
+    head->period_ns = period;
+    head->off_site  = off_site;
+    head->off_slot  = off_slot;
+    head->t_beat.store(0, std::memory_order_relaxed);
+    head->pid.store(getpid(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(head->magic, kPubMagic, sizeof(kPubMagic));  // 最後に書き、読み手に公開
+
+    Eop::catch_hup();
+    std::signal(SIGINT,  on_stop);
+    std::signal(SIGTERM, on_stop);
+    std::cerr << "[INFO] Publishing " << sites.size() << " sites to " << name
+              << " at " << hz << " Hz" << std::endl;
+    t_next = clock_ns(CLOCK_MONOTONIC);
+    t_eop  = t_next + kEopChkNs;
+    while (!f_stop) {
+      // 計算（黄道座標等は全地点で共用）
+      clock_gettime(CLOCK_REALTIME, &ts);
+      struct EclPos ep_s = trk_s[0].ecl(ts);
+      struct EclPos ep_m = trk_m[0].ecl(ts);
+      ++n_tick;
+      v.sec     = ts.tv_sec;
+      v.nsec    = ts.tv_nsec;
+      v.n_upd   = std::uint32_t(n_tick);
+      v.eop_ver = eop->ver;
+      for (i = 0; i < sites.size(); ++i) {
+        v.sun  = trk_s[i].at(ep_s);
+        v.moon = trk_m[i].at(ep_m);
+        // 書込（シーケンスロック: 奇数にしてから書き、偶数に戻す）
+        PubSlot& sl = slots[2 * i + (n_tick & 1)];
+        std::uint32_t sq = sl.seq.load(std::memory_order_relaxed);
+        sl.seq.store(sq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&sl.v, &v, sizeof(v));
+        sl.seq.store(sq + 2, std::memory_order_release);
+      }
+      head->t_beat.store(clock_ns(CLOCK_REALTIME), std::memory_order_release);
+
+      // EOP ファイルの更新確認（周期の空き時間に行う）
+      t_next += period;
+      if (clock_ns(CLOCK_MONOTONIC) >= t_eop) {
+        t_eop += kEopChkNs;
+        o_eop.check();
+        if (o_eop.get()->ver != eop->ver) {
+          eop = o_eop.get();
+          make_tracks();
+        }
+      }
+      // 次の周期まで待機（遅れた場合は次の周期から）
+      if (clock_ns(CLOCK_MONOTONIC) >= t_next) {
+        ++n_late;
+        t_next = clock_ns(CLOCK_MONOTONIC) + period;
+        continue;
+      }
+      ts.tv_sec  = t_next / kNsSec;
+      ts.tv_nsec = t_next % kNsSec;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR
+             && !f_stop) {}
+    }
+    head->pid.store(0, std::memory_order_release);
+    munmap(p, s_map);
+    std::cerr << "[INFO] " << n_tick << " updates, " << n_late << " late" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * @brief      実行: 共有メモリの視位置の表示
+ *             (地点毎に 1 行 "ID 計算時刻 太陽高度 太陽方位角 月高度 月方位角 経過時間(ms)"。
+ *              古い視位置は末尾に STALE を付ける)
+ *
+ * @param[in]  共有メモリ名 (string, "/NAME")
+ * @return     終了コード (int)
+ */
+int run_peek(const std::string& name) {
+  PubReader o_rd;
+  Formatter o_fmt(1, kLyLine);
+  struct PubVec v;
+  struct tm t;
+  time_t sec;
+  char buf[160];
+  std::uint32_t s;
+
+  try {
+    if (!o_rd.open(name)) {
+      std::cerr << "[ERROR] Cannot open " << name << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (s = 0; s < o_rd.get_n_site(); ++s) {
+      if (!o_rd.read(s, v)) {
+        std::snprintf(buf, sizeof(buf), "%s ---\n", o_rd.get_site(s).id);
+      } else {
+        sec = v.sec;
+        localtime_jst(sec, t);
+        std::snprintf(buf, sizeof(buf),
+                      "%s %04d-%02d-%02dT%02d:%02d:%02d.%03d %.4f %.4f %.4f %.4f %.1f%s\n",
+                      o_rd.get_site(s).id, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                      t.tm_hour, t.tm_min, t.tm_sec, int(v.nsec / 1000000),
+                      v.sun.alt, v.sun.az, v.moon.alt, v.moon.az,
+                      o_rd.age_ns(v) / 1.0e6, o_rd.stale(v) ? " STALE" : "");
+      }
+      o_fmt.put_str(buf);
+    }
+    if (!o_fmt.flush()) return EXIT_FAILURE;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,112 @@
+#ifndef SUN_MOON_PUBLISH_HPP_
+#define SUN_MOON_PUBLISH_HPP_
+
+#include "almanac.hpp"
+#include "track.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 視位置の共有メモリ（POSIX 共有メモリ, 書き手 1 プロセス・読み手複数プロセス）
+// * ヘッダ: PubHead
+// * 地点:   AlmSite × 地点数（地点一覧ファイルの順, 変更しない）
+// * 視位置: PubSlot × 2 × 地点数（64 バイト境界, 1 スロット 1 キャッシュライン）
+// * 各スロットはシーケンスロック（seq が奇数の間は書込中）。書き手は地点毎に 2 つのスロットへ
+//   交互に書き込み、読み手は両方をロック・システムコールなしでコピーして、前後の seq が
+//   一致したもののうち新しい方を使う。書込中のスロットを待たないため、読み手は書き手の
+//   状態（書込中の停止を含む）によらず一定時間で終わる
+// * 数値はホストのバイト順（リトルエンディアン前提）
+static constexpr char kPubMagic[8] = {'S', 'M', 'P', 'U', 'B', '0', '1', '\0'};
+static constexpr unsigned int kPubStaleN = 3;  // 古いとみなす更新周期数
+
+struct PubHead {
+  char          magic[8];   // "SMPUB01\0"
+  std::uint32_t n_site;     // 地点数
+  std::uint32_t s_slot;     // スロットサイズ
+  std::int64_t  period_ns;  // 更新周期(ns)
+  std::uint64_t off_site;   // 地点一覧の位置
+  std::uint64_t off_slot;   // 視位置の位置
+  std::atomic<std::int64_t> t_beat;  // 最終更新の完了時刻(UNIX 時刻, ns)
+  std::atomic<std::int32_t> pid;     // 書き手のプロセス ID（0: 停止）
+};
+// 視位置（1 地点, 1 時刻）
+struct PubVec {
+  std::int64_t  sec;        // 計算時刻: UNIX 秒
+  std::int32_t  nsec;       // 計算時刻: ナノ秒
+  std::uint32_t n_upd;      // 更新回数（下位 32 ビット, 1 から）
+  struct AltAz  sun;        // 太陽の視高度・方位角
+  struct AltAz  moon;       // 月の視高度・方位角
+  std::uint64_t eop_ver;    // 計算に使用した EOP 一覧の版数
+};
+struct alignas(64) PubSlot {
+  std::atomic<std::uint32_t> seq;  // シーケンス番号（奇数: 書込中, 0: 未書込）
+  std::uint32_t pad;
+  struct PubVec v;                 // 視位置
+};
+static_assert(sizeof(PubSlot) == 64, "PubSlot must be 64 bytes");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free
+              && std::atomic<std::int64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+// 読み手: 視位置の共有メモリ（読込専用でマップ）
+class PubReader {
+  int            fd;     // ファイルディスクリプタ
+  char*          p_map;  // マップ先頭
+  std::size_t    s_map;  // マップサイズ
+  const PubHead* head;   // ヘッダ
+  const AlmSite* sites;  // 地点一覧
+  const PubSlot* slots;  // 視位置（地点毎に 2 つ）
+
+public:
+  PubReader();   // コンストラクタ
+  ~PubReader();  // デストラクタ
+  bool open(const std::string&);  // OPEN（ヘッダ・各領域の大きさを照合）
+  std::uint32_t get_n_site() const { return head->n_site; }            // 取得: 地点数
+  const AlmSite& get_site(std::uint32_t s) const { return sites[s]; }  // 取得: 地点
+  std::int64_t get_period() const { return head->period_ns; }          // 取得: 更新周期(ns)
+  std::int64_t find(const char*) const;  // 参照: 地点 ID の番号（ない場合は -1）
+  bool read(std::uint32_t s, struct PubVec& v) const {  // 参照: 視位置（false: 未書込）
+    struct PubVec w[2];
+    bool f[2];
+    for (;;) {
+      for (unsigned int i = 0; i < 2; ++i) {
+        const PubSlot& sl = slots[2 * s + i];
+        std::uint32_t s_0 = sl.seq.load(std::memory_order_acquire);
+        std::memcpy(&w[i], &sl.v, sizeof(w[i]));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        f[i] = s_0 != 0 && (s_0 & 1u) == 0
+            && sl.seq.load(std::memory_order_relaxed) == s_0;
+      }
+      if (f[0] && f[1]) {
+        v = std::int32_t(w[1].n_upd - w[0].n_upd) > 0 ? w[1] : w[0];
+      } else if (f[0] || f[1]) {
+        v = f[0] ? w[0] : w[1];
+      } else if (slots[2 * s].seq.load(std::memory_order_relaxed) == 0
+                 || slots[2 * s + 1].seq.load(std::memory_order_relaxed) == 0) {
+        return false;  // 未書込（初回の書込中を含む）
+      } else {
+        continue;      // 両方とも読込中に書き換えられた（2 周期以上の中断時のみ）
+      }
+      return true;
+    }
+  }
+  std::int64_t age_ns(const struct PubVec&) const;  // 計算: 視位置の経過時間(ns)
+  bool stale(const struct PubVec&) const;
+                      // 判定: 古い（書き手の停止, または kPubStaleN 周期を超えて未更新）
+};
+
+int run_publish(const std::vector<AlmSite>&, const std::string&, double);
+                                 // 実行: 視位置の定期計算・共有メモリへの公開
+int run_peek(const std::string&);  // 実行: 共有メモリの視位置の表示
+
+}  // namespace sun_moon
+
+#endif
+
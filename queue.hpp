@@ -0,0 +1,73 @@
+#ifndef SUN_MOON_QUEUE_HPP_
+#define SUN_MOON_QUEUE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace sun_moon {
+
+// 上限付きキュー（満杯時は push 側を待たせる）
+template <typename T>
+class Queue {
+  std::deque<T>           q;       // 要素
+  std::size_t             cap;     // 上限件数
+  bool                    f_cls;   // クローズ済みフラグ
+  std::mutex              mtx;
+  std::condition_variable cv_put;  // 空き待ち
+  std::condition_variable cv_get;  // 要素待ち
+
+public:
+  explicit Queue(std::size_t cap) : cap(cap), f_cls(false) {}
+
+  /*
+   * @brief      追加（満杯の間は待つ）
+   *
+   * @param[in]  要素 (T)
+   * @return     成否（クローズ済みの場合は false） (bool)
+   */
+  bool push(T v) {
+    std::unique_lock<std::mutex> lk(mtx);
+    cv_put.wait(lk, [this] { return f_cls || q.size() < cap; });
+    if (f_cls) return false;
+    q.push_back(std::move(v));
+    cv_get.notify_one();
+    return true;
+  }
+
+  /*
+   * @brief       取出（空の間は待つ）
+   *
+   * @param[ref]  要素 (T)
+   * @return      成否（クローズ済みかつ空の場合は false） (bool)
+   */
+  bool pop(T& v) {
+    std::unique_lock<std::mutex> lk(mtx);
+    cv_get.wait(lk, [this] { return f_cls || !q.empty(); });
+    if (q.empty()) return false;
+    v = std::move(q.front());
+    q.pop_front();
+    cv_put.notify_one();
+    return true;
+  }
+
+  /*
+   * @brief   クローズ（以後の push は失敗、残りの要素は pop 可能）
+   *
+   * @param   none
+   * @return  none
+   */
+  void close() {
+    std::lock_guard<std::mutex> lk(mtx);
+    f_cls = true;
+    cv_put.notify_all();
+    cv_get.notify_all();
+  }
+};
+
+}  // namespace sun_moon
+
+#endif
+
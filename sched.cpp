@@ -0,0 +1,203 @@
+#include "sched.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace sun_moon {
+
+// 定数
+static constexpr double      kTgtNs   = 200000.0;  // 1 回の取出しの目標処理時間(ns)
+static constexpr double      kEwma    = 0.25;      // 指数移動平均の重み
+static constexpr std::size_t kChunkMx = 4096;      // 1 回の取出し最大件数
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  スレッド数 (0: ハードウェアスレッド数) (unsigned int)
+ */
+Sched::Sched(unsigned int n_th) : gen(0), f_stop(false), fn(nullptr),
+                                  n_all(0), n_done(0) {
+  unsigned int i;
+
+  try {
+    if (n_th == 0) n_th = std::max(1u, std::thread::hardware_concurrency());
+    for (i = 0; i < n_th; ++i) {
+      wks.emplace_back(new Worker);
+      wks[i]->ns_1 = 0.0;
+      wks[i]->rnd  = 0x9e3779b97f4a7c15ULL * (i + 1);
+    }
+    for (i = 1; i < n_th; ++i) ths.emplace_back(&Sched::loop, this, i);
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief  デストラクタ
+ *
+ * @param  none
+ */
+Sched::~Sched() {
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    f_stop = true;
+  }
+  cv_job.notify_all();
+  for (auto& th : ths) th.join();
+}
+
+/*
+ * @brief      実行: [0, n) の各添字について処理（全件完了まで戻らない）
+ *             (初期状態では範囲をスレッド数で等分して各キューへ積む)
+ *
+ * @param[in]  件数 (size_t)
+ * @param[in]  処理 (function<void(size_t)>)
+ * @return     none
+ */
+void Sched::run(std::size_t n, const std::function<void(std::size_t)>& f) {
+  std::size_t n_wk = wks.size();
+  std::size_t i;
+
+  if (n == 0) return;
+  {
+    // 処理を設定してからキューへ積む（前のジョブから残ったスレッドが
+    // キュー経由で範囲を得た時点で、処理が見えるようにするため）
+    std::lock_guard<std::mutex> lk(mtx);
+    fn     = &f;
+    n_all  = n;
+    n_done = 0;
+    ex     = nullptr;
+    for (i = 0; i < n_wk; ++i) {
+      std::lock_guard<std::mutex> lk_w(wks[i]->mtx);
+      std::size_t b = n * i / n_wk;
+      std::size_t e = n * (i + 1) / n_wk;
+      if (b < e) wks[i]->dq.push_back({b, e});
+    }
+    ++gen;
+  }
+  cv_job.notify_all();
+  work(0);
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    cv_done.wait(lk, [this] { return n_done.load() == n_all; });
+    fn = nullptr;
+  }
+  if (ex) std::rethrow_exception(ex);
+}
+
+/*
+ * @brief      スレッド本体（ジョブ毎に起こされて処理）
+ *
+ * @param[in]  ワーカ番号 (unsigned int)
+ * @return     none
+ */
+void Sched::loop(unsigned int w) {
+  std::uint64_t g = 0;  // 処理済みジョブ世代
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lk(mtx);
+      cv_job.wait(lk, [this, g] { return f_stop || gen != g; });
+      if (f_stop) return;
+      g = gen;
+    }
+    work(w);
+  }
+}
+
+/*
+ * @brief      処理: 1 ジョブ分（自キュー → 他キューの順に、なくなるまで）
+ *
+ * @param[in]  ワーカ番号 (unsigned int)
+ * @return     none
+ */
+void Sched::work(unsigned int w) {
+  Worker& wk = *wks[w];
+  Range r;
+  std::size_t i;
+
+  while (pop(w, r) || steal(w, r)) {
+    auto t0 = std::chrono::steady_clock::now();
+    try {
+      for (i = r.b; i < r.e; ++i) (*fn)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lk(mtx);
+      if (!ex) ex = std::current_exception();
+    }
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count() / (r.e - r.b);
+    wk.ns_1 = wk.ns_1 == 0.0 ? ns : wk.ns_1 + kEwma * (ns - wk.ns_1);
+    if (n_done.fetch_add(r.e - r.b) + (r.e - r.b) == n_all) {
+      std::lock_guard<std::mutex> lk(mtx);
+      cv_done.notify_all();
+    }
+  }
+}
+
+/*
+ * @brief       取出: 自キュー先頭から適応サイズ分
+ *              (残りはキュー先頭へ戻し、他スレッドが奪えるようにする)
+ *
+ * @param[in]   ワーカ番号 (unsigned int)
+ * @param[ref]  取り出した範囲 (Range)
+ * @return      成否 (bool)
+ */
+bool Sched::pop(unsigned int w, Range& r) {
+  Worker& wk = *wks[w];
+  std::size_t c;  // 取出し件数
+
+  std::lock_guard<std::mutex> lk(wk.mtx);
+  if (wk.dq.empty()) return false;
+  c = wk.ns_1 == 0.0 ? 1 : std::size_t(kTgtNs / wk.ns_1);
+  c = std::min(std::max<std::size_t>(c, 1), kChunkMx);
+  Range& f = wk.dq.front();
+  r = {f.b, std::min(f.b + c, f.e)};
+  f.b = r.e;
+  if (f.b == f.e) wk.dq.pop_front();
+
+  return true;
+}
+
+/*
+ * @brief       奪取: 他キュー末尾の範囲の後ろ半分
+ *              (乱数で選んだ相手から順に全スレッドを試す)
+ *
+ * @param[in]   ワーカ番号 (unsigned int)
+ * @param[ref]  奪った範囲 (Range)
+ * @return      成否 (bool)
+ */
+bool Sched::steal(unsigned int w, Range& r) {
+  Worker& wk = *wks[w];
+  std::size_t n_wk = wks.size();
+  std::size_t i;
+
+  wk.rnd ^= wk.rnd << 13;
+  wk.rnd ^= wk.rnd >> 7;
+  wk.rnd ^= wk.rnd << 17;
+  for (i = 0; i < n_wk; ++i) {
+    std::size_t v = (wk.rnd + i) % n_wk;  // 相手
+    if (v == w) continue;
+    {
+      Worker& vk = *wks[v];
+      std::lock_guard<std::mutex> lk(vk.mtx);
+      if (vk.dq.empty()) continue;
+      Range& b = vk.dq.back();
+      std::size_t m = b.b + (b.e - b.b) / 2;  // 分割点
+      r = {m, b.e};
+      b.e = m;
+      if (b.b == b.e) vk.dq.pop_back();
+    }
+    {
+      // 奪った範囲を自キューへ積み、適応サイズで取り出し直す
+      // （相手のロックを外してから積む: ロック順序による行き詰まり防止）
+      std::lock_guard<std::mutex> lk_w(wk.mtx);
+      wk.dq.push_back(r);
+    }
+    if (pop(w, r)) return true;
+  }
+
+  return false;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,65 @@
+#ifndef SUN_MOON_SCHED_HPP_
+#define SUN_MOON_SCHED_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sun_moon {
+
+// ワークスティーリング方式のスケジューラ（並列 for）
+// * スレッド毎の両端キューに添字範囲を積み、自分のキューの先頭から取り出して処理
+// * 自分のキューが空になったら、他スレッドのキュー末尾の範囲を半分奪う
+// * 1 回に取り出す件数は、スレッド毎に計測した 1 件あたりの処理時間から決める
+//   （重い問い合わせが続く範囲では小さく、軽い範囲では大きく）
+// * 結果は呼び出し側が添字位置に格納するため、出力順は入力順のまま
+class Sched {
+  struct Range {
+    std::size_t b;  // 開始（含む）
+    std::size_t e;  // 終了（含まない）
+  };
+  struct Worker {
+    std::mutex        mtx;    // キュー操作用（自スレッドと奪う側のみ）
+    std::deque<Range> dq;     // 未処理範囲
+    double            ns_1;   // 1 件あたりの処理時間(ns, 指数移動平均)
+    std::uint64_t     rnd;    // 奪う相手の選択用乱数
+  };
+
+  std::vector<std::unique_ptr<Worker>> wks;  // ワーカ（0 は呼び出し元スレッド）
+  std::vector<std::thread>  ths;             // スレッド（ワーカ 1 以降）
+  std::mutex                mtx;             // ジョブ通知用
+  std::condition_variable   cv_job;          // ジョブ開始通知
+  std::condition_variable   cv_done;         // ジョブ完了通知
+  std::uint64_t             gen;             // ジョブ世代
+  bool                      f_stop;          // 停止フラグ
+  const std::function<void(std::size_t)>* fn;  // 処理
+  std::size_t               n_all;           // 総件数
+  std::atomic<std::size_t>  n_done;          // 処理済み件数
+  std::exception_ptr        ex;              // 最初に発生した例外
+
+public:
+  explicit Sched(unsigned int = 0);  // コンストラクタ（0: ハードウェアスレッド数）
+  ~Sched();                          // デストラクタ
+  void run(std::size_t, const std::function<void(std::size_t)>&);
+                                     // 実行: [0, n) の各添字について処理
+  unsigned int size() { return wks.size(); }  // スレッド数
+
+private:
+  void loop(unsigned int);          // スレッド本体
+  void work(unsigned int);          // 処理: 1 ジョブ分
+  bool pop(unsigned int, Range&);   // 取出: 自キュー先頭から適応サイズ分
+  bool steal(unsigned int, Range&); // 奪取: 他キュー末尾の半分
+};
+
+}  // namespace sun_moon
+
+#endif
+
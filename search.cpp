@@ -0,0 +1,248 @@
+#include "search.hpp"
+#include "ephem.hpp"
+#include "time.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sun_moon {
+
+// 定数
+static constexpr unsigned int kJstOffset = 32400;            // JST - UTC (secs)
+static constexpr unsigned int kSecDay    = 86400;            // Seconds in a day (secs)
+static constexpr double       kDipCoef   = 0.0353333;        // 地平線伏角計算用係数
+static constexpr double       kPi        = atan(1.0) * 4.0;  // 円周率
+static constexpr double       kPi180     = kPi / 180.0;      // 円周率 / 180
+static constexpr double       kAstrRef   = 0.585556;         // 大気差(astro refract)
+static constexpr double       kTol       = 0.01;             // 根: 収束判定(秒)
+static constexpr unsigned int kMaxIter   = 60;               // 根: 反復回数の上限
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  天体 (Body)
+ * @param[in]  緯度 (double)
+ * @param[in]  経度 (double)
+ * @param[in]  標高 (double)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ */
+Search::Search(Body bd, double lat, double lng, double ht,
+               std::shared_ptr<const EopTable> eop)
+    : bd(bd), lat_o(lat), lng_o(lng), eop(eop), day_c(-1), day_p_c(0.0), dlt_t_c(0.0) {
+  try {
+    dip = kDipCoef * std::sqrt(ht);
+    if (!this->eop) {
+      Eop o_eop;
+      this->eop = o_eop.get();
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief       探索: 期間内の出・入・南中（時刻順）
+ *              (開始・終了と、その間の kStep 秒の倍数（UNIX 秒）の時刻を標本とし、
+ *               出入は「地心高度 - 出入高度」、南中は時角の符号変化で区間を挟み込む。
+ *               区間 (t, t + kStep] 毎に根を 1 回だけ求めるため、期間を任意の位置で
+ *               分割して探索しても重複・欠落はない。kStep の倍数で分割した場合は、
+ *               分割しない場合と結果が一致する)
+ *              * 標本の間隔内で 2 回符号が変わる（出入が kStep 以内に続く）場合は
+ *                検出されない（極地方で地平線をかすめる場合のみ）
+ *
+ * @param[in]   開始(UNIX 秒, 含まない) (time_t)
+ * @param[in]   終了(UNIX 秒, 含む) (time_t)
+ * @param[ref]  出・入・南中 (vector<Event>, 末尾に追加)
+ * @return      none
+ */
+void Search::run(time_t t_0, time_t t_1, std::vector<Event>& evs) {
+  struct Sample s_0;       // 区間の始点
+  struct Sample s_1;       // 区間の終点
+  struct Sample s_r;       // 根
+  time_t t_n;              // 次の標本の時刻
+  Event  fnd[3];           // 区間内の根
+  unsigned int n_f;        // 区間内の根の数
+  unsigned int i;
+
+  try {
+    if (t_1 <= t_0) return;
+    s_0 = eval(double(t_0));
+    t_n = t_0 - ((t_0 % kStep) + kStep) % kStep;  // kStep の倍数に切り下げ
+    while (s_0.t < double(t_1)) {
+      t_n = std::min<time_t>(t_n + kStep, t_1);
+      s_1 = eval(double(t_n));
+      n_f = 0;
+      if (s_0.g <  0.0 && s_1.g >= 0.0) fnd[n_f++].kbn = 0;
+      if (s_0.g >= 0.0 && s_1.g <  0.0) fnd[n_f++].kbn = 1;
+      // 時角は -180° → 180° の折り返しを除き増加のみ
+      if (s_0.h <  0.0 && s_1.h >= 0.0) fnd[n_f++].kbn = 2;
+      for (i = 0; i < n_f; ++i) {
+        s_r = refine(s_0, s_1, fnd[i].kbn);
+        fnd[i].ev.time.tv_sec  = time_t(std::floor(s_r.t));
+        fnd[i].ev.time.tv_nsec = long((s_r.t - std::floor(s_r.t)) * 1.0e9);
+        fnd[i].ev.ah = fnd[i].kbn == 2 ? calc_height(s_r) : calc_azimuth(s_r);
+      }
+      std::sort(fnd, fnd + n_f, [](const Event& a, const Event& b) {
+        return a.ev.time.tv_sec < b.ev.time.tv_sec
+            || (a.ev.time.tv_sec == b.ev.time.tv_sec
+             && a.ev.time.tv_nsec < b.ev.time.tv_nsec);
+      });
+      evs.insert(evs.end(), fnd, fnd + n_f);
+      s_0 = s_1;
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 1 時刻の地心高度と出入高度の差・時角
+ *             (経過ユリウス年は Calc と同じく JST 日付の 00:00:00 を基準とし、
+ *              ΔT 等の日毎の値は日付が変わった時のみ求め直す)
+ *
+ * @param[in]  時刻(UNIX 秒) (double)
+ * @return     標本 (Sample)
+ */
+struct Search::Sample Search::eval(double t) {
+  struct Sample s;
+  struct tm tm_l;
+  struct timespec utc;  // UTC（Calc と同じく JST 00:00:00 から 9 時間戻した値）
+  time_t ts = time_t(std::floor(t));
+  double dist;          // 太陽: 距離
+  double ht;            // 出入高度
+  double alt;           // 地心高度
+  Coord  cd_k = {0.0, 0.0};  // 黄道座標
+
+  try {
+    if (day_c < 0 || ts < day_c || ts >= day_c + time_t(kSecDay)) {
+      localtime_jst(ts, tm_l);
+      tm_l.tm_hour = 0;
+      tm_l.tm_min  = 0;
+      tm_l.tm_sec  = 0;
+      day_c = mktime_jst(tm_l);
+      utc.tv_sec  = day_c - kJstOffset;
+      utc.tv_nsec = 0;
+      Time o_tm(eop);
+      int    utc_tai = o_tm.get_utc_tai(utc);
+      double dut1    = o_tm.get_dut1(utc);
+      dlt_t_c = o_tm.calc_dlt_t(utc, utc_tai, dut1) / kSecDay;
+      day_p_c = day_progress(day_c);
+    }
+    s.t  = t;
+    s.jy = (day_p_c + (t - day_c) / kSecDay + dlt_t_c) / 365.25;
+    if (bd == kBdSun) {
+      cd_k.lng = lmd_sun(s.jy);
+      dist     = dist_sun(s.jy);
+      ht       = -0.266994 / dist - kAstrRef - dip + 0.0024428 / dist;
+    } else {
+      cd_k.lng = lmd_moon(s.jy);
+      cd_k.lat = bet_moon(s.jy);
+      ht       = diff_moon(s.jy) - dip - kAstrRef;
+    }
+    s.cd_s  = ko2se(s.jy, cd_k);
+    s.tm_sd = norm_ang(325.4606
+                     + 360.007700536 * s.jy
+                     + 0.00000003879 * s.jy * s.jy
+                     + 360.0 * (t - day_c) / kSecDay + lng_o);
+    s.h = std::remainder(s.tm_sd - s.cd_s.lng, 360.0);
+    alt = std::sin(kPi180 * s.cd_s.lat) * std::sin(kPi180 * lat_o)
+        + std::cos(kPi180 * s.cd_s.lat) * std::cos(kPi180 * lat_o)
+        * std::cos(kPi180 * s.h);
+    alt = std::asin(std::max(-1.0, std::min(1.0, alt))) / kPi180;
+    s.g = alt - ht;
+  } catch (...) {
+    throw;
+  }
+
+  return s;
+}
+
+/*
+ * @brief      計算: 挟み込んだ区間の根
+ *             (Illinois 法。区間の両端は常に根を挟むため、kTol 秒まで確実に収束する)
+ *
+ * @param[in]  区間の始点 (Sample)
+ * @param[in]  区間の終点 (Sample)
+ * @param[in]  区分(0: 出, 1: 入, 2: 南中) (unsigned int)
+ * @return     根 (Sample)
+ */
+struct Search::Sample Search::refine(struct Sample s_a, struct Sample s_b, unsigned int kbn) {
+  struct Sample s_c = s_b;
+  double f_a = kbn == 2 ? s_a.h : s_a.g;
+  double f_b = kbn == 2 ? s_b.h : s_b.g;
+  double f_c;
+  unsigned int i;
+
+  try {
+    for (i = 0; i < kMaxIter && std::abs(s_b.t - s_a.t) > kTol; ++i) {
+      s_c = eval((s_a.t * f_b - s_b.t * f_a) / (f_b - f_a));
+      f_c = kbn == 2 ? s_c.h : s_c.g;
+      if (f_c == 0.0) break;
+      if ((f_c < 0.0) != (f_b < 0.0)) {
+        s_a = s_b;
+        f_a = f_b;
+      } else {
+        f_a *= 0.5;  // 同じ側が続く場合は反対側の重みを下げる
+      }
+      s_b = s_c;
+      f_b = f_c;
+    }
+  } catch (...) {
+    throw;
+  }
+
+  return s_c;
+}
+
+/*
+ * @brief      計算: 南中高度（Calc::calc_height と同じく Radau の式で大気差を補正）
+ *
+ * @param[in]  標本 (Sample)
+ * @return     高度(度) (double)
+ */
+double Search::calc_height(const Sample& s) {
+  double tan_ht;  // 計算用
+  double ht;      // 高度
+
+  try {
+    ht = std::sin(kPi180 * s.cd_s.lat) * std::sin(kPi180 * lat_o)
+       + std::cos(kPi180 * s.cd_s.lat) * std::cos(kPi180 * lat_o)
+       * std::cos(kPi180 * s.h);
+    ht = std::asin(ht) / kPi180;
+    tan_ht = std::tan(kPi180 * (90.0 - ht));
+    ht += (58.76 - (0.406 - 0.0192 * tan_ht) * tan_ht) * tan_ht / 3600.0;
+  } catch (...) {
+    throw;
+  }
+
+  return ht;
+}
+
+/*
+ * @brief      計算: 方位角（Calc::calc_azimuth と同じ）
+ *
+ * @param[in]  標本 (Sample)
+ * @return     方位角(度) (double)
+ */
+double Search::calc_azimuth(const Sample& s) {
+  double a_0;
+  double a_1;
+  double ang;
+
+  try {
+    a_0 = -std::cos(kPi180 * s.cd_s.lat) * std::sin(kPi180 * s.h);
+    a_1 =  std::sin(kPi180 * s.cd_s.lat) * std::cos(kPi180 * lat_o)
+        -  std::cos(kPi180 * s.cd_s.lat) * std::sin(kPi180 * lat_o)
+         * std::cos(kPi180 * s.h);
+    ang = std::atan(a_0 / a_1) / kPi180;
+    if (a_1 > 0.0 && ang < 0.0) { ang += 360.0; }
+    if (a_1 < 0.0) { ang += 180.0; }
+  } catch (...) {
+    throw;
+  }
+
+  return ang;
+}
+
+}  // namespace sun_moon
+
@@ -0,0 +1,70 @@
+#ifndef SUN_MOON_SEARCH_HPP_
+#define SUN_MOON_SEARCH_HPP_
+
+#include "calc.hpp"
+#include "eop.hpp"
+#include "track.hpp"
+
+#include <ctime>
+#include <memory>
+#include <vector>
+
+namespace sun_moon {
+
+// 出・入・南中（任意の期間）
+struct Event {
+  unsigned int kbn;  // 区分(0: 出, 1: 入, 2: 南中)
+  struct TmAh  ev;   // 時刻と方位角／南中高度
+};
+
+// 探索の範囲
+struct SearchSpec {
+  Body   bd;   // 天体
+  time_t t_0;  // 開始時刻(UNIX 秒, 含まない)
+  time_t t_1;  // 終了時刻(UNIX 秒, 含む)
+  double lat;  // 緯度
+  double lng;  // 経度
+  double ht;   // 標高
+};
+
+// 探索: 期間内の出・入・南中
+// * 期間を一定間隔で標本化し、符号変化で挟み込んだ区間毎に 1 回だけ根を求める
+//   （日付の区切りによらないため、同じ日に 2 回ある月の入等も漏れ・重複なく求まる）
+// * 出入の高度・方位角・南中高度の定義は Calc と同じ
+class Search {
+  Body          bd;       // 天体
+  double        lat_o;    // 観測者: 緯度
+  double        lng_o;    // 観測者: 経度
+  double        dip;      // 地平線伏角
+  std::shared_ptr<const EopTable> eop;  // EOP 一覧
+  time_t        day_c;    // 日毎の値: JST 当日 00:00:00（-1: 未設定）
+  double        day_p_c;  // 日毎の値: 2000年1月1日力学時正午からの経過日数
+  double        dlt_t_c;  // 日毎の値: ΔTの日換算値
+
+  // 標本
+  struct Sample {
+    double t;      // 時刻(UNIX 秒)
+    double g;      // 地心高度 - 出入高度(度)
+    double h;      // 時角(度, -180 〜 180)
+    double jy;     // 経過ユリウス年
+    double tm_sd;  // 恒星時(度)
+    Coord  cd_s;   // 赤道座標
+  };
+
+public:
+  Search(Body, double, double, double, std::shared_ptr<const EopTable>);  // コンストラクタ
+  static constexpr time_t kStep = 3600;  // 標本化の間隔(秒)
+  void run(time_t, time_t, std::vector<Event>&);  // 探索: (開始, 終了]（UNIX 秒）
+
+private:
+  struct Sample eval(double);                  // 計算: 1 時刻の高度差・時角
+  struct Sample refine(struct Sample, struct Sample, unsigned int);
+                                               // 計算: 挟み込んだ区間の根
+  double calc_height(const Sample&);           // 計算: 南中高度（大気差補正済み）
+  double calc_azimuth(const Sample&);          // 計算: 方位角
+};
+
+}  // namespace sun_moon
+
+#endif
+
@@ -0,0 +1,288 @@
+#include "shard.hpp"
+#include "colfile.hpp"
+
+#include <cstdio>    // for rename
+#include <cstdlib>   // for EXIT_XXXX
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace sun_moon {
+
+// 定数
+static constexpr std::uint64_t kShardBlk = 4096;  // 巡回分割の単位(データ行数)
+static constexpr const char* kShardTag = "SMSHARD1";  // 記録ファイルの識別子
+
+/*
+ * @brief      連続分割の範囲 [b, e) の端点
+ *             (n_all * i / n をオーバーフローなしで求める)
+ *
+ * @param[in]  全体の件数 (uint64_t)
+ * @param[in]  担当番号 (unsigned int)
+ * @param[in]  分割数 (unsigned int)
+ * @return     行番号 (uint64_t)
+ */
+static std::uint64_t range_at(std::uint64_t n_all, unsigned int i, unsigned int n) {
+  return n_all / n * i + n_all % n * i / n;
+}
+
+/*
+ * @brief      コンストラクタ（巡回: 件数不明の入力）
+ *             (各プロセスが入力全体を解析し、kShardBlk 件毎のブロックを順に
+ *              割り当てる。行番号は入力から決まるため、全プロセスで一致する)
+ *
+ * @param[in]  供給元 (Source)
+ * @param[in]  分割指定 (ShardSpec)
+ */
+Shard::Shard(Source& src, const ShardSpec& sh) : src(src) {
+  info.sh    = sh;
+  info.mode  = kShCyclic;
+  info.n_all = 0;
+  info.n_out = 0;
+}
+
+/*
+ * @brief      コンストラクタ（連続: 日付範囲・格子点）
+ *             (行番号を N 等分した連続範囲のみを生成する。格子は 日付 → 緯度 →
+ *              経度 の順のため、日付範囲で分けることになる)
+ *
+ * @param[in]  格子点 (Grid)
+ * @param[in]  分割指定 (ShardSpec)
+ */
+Shard::Shard(Grid& grid, const ShardSpec& sh) : src(grid) {
+  info.sh    = sh;
+  info.mode  = kShRange;
+  info.n_all = grid.size();
+  info.n_out = 0;
+  grid.limit(range_at(info.n_all, sh.i, sh.n),
+             range_at(info.n_all, sh.i + 1, sh.n));
+}
+
+/*
+ * @brief       読込: 最大 n 件（担当分のみ）
+ *
+ * @param[ref]  読込結果 (vector<Row>, 追記)
+ * @param[in]   最大件数 (size_t)
+ * @return      読込件数（0 の場合は終了） (size_t)
+ */
+std::size_t Shard::read(std::vector<Row>& rows, std::size_t n) {
+  std::size_t cnt = 0;
+
+  try {
+    if (info.mode == kShRange) {
+      cnt = src.read(rows, n);
+    } else {
+      while (cnt == 0) {
+        buf.clear();
+        if (src.read(buf, n) == 0) break;
+        info.n_all += buf.size();
+        for (const auto& r : buf) {
+          if (!in_shard(info, r.seq)) continue;
+          rows.push_back(r);
+          ++cnt;
+        }
+      }
+    }
+    info.n_out += cnt;
+  } catch (...) {
+    throw;
+  }
+
+  return cnt;
+}
+
+/*
+ * @brief      書出: 分割実行の記録（出力ファイル名 + ".shard"）
+ *             (1 行: "SMSHARD1 i N range|cyclic 全体件数 担当件数")
+ *
+ * @param[in]  出力ファイル名 (string)
+ * @return     成否 (bool)
+ */
+bool Shard::put_info(const std::string& f_out) {
+  try {
+    std::ofstream ofs(f_out + ".shard", std::ios::trunc);
+    if (!ofs) return false;
+    ofs << kShardTag << " " << info.sh.i << " " << info.sh.n << " "
+        << (info.mode == kShRange ? "range" : "cyclic") << " "
+        << info.n_all << " " << info.n_out << "\n";
+    return bool(ofs);
+  } catch (...) {
+    return false;
+  }
+}
+
+/*
+ * @brief      解析: "i/N"（0 <= i < N）
+ *
+ * @param[in]  文字列 (string)
+ * @param[ref] 分割指定 (ShardSpec)
+ * @return     成否 (bool)
+ */
+bool parse_shard(const std::string& s, ShardSpec& sh) {
+  std::size_t p = s.find('/');
+  unsigned long i;
+  unsigned long n;
+
+  try {
+    if (p == std::string::npos || p == 0 || p + 1 >= s.size()) return false;
+    if (s.find_first_not_of("0123456789/") != std::string::npos) return false;
+    i = std::stoul(s.substr(0, p));
+    n = std::stoul(s.substr(p + 1));
+    if (n == 0 || i >= n || n > 65536) return false;
+    sh.i = i;
+    sh.n = n;
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      判定: 担当分の行番号か
+ *
+ * @param[in]  分割実行の記録 (ShardInfo)
+ * @param[in]  データ行番号 (uint64_t)
+ * @return     判定 (bool)
+ */
+bool in_shard(const ShardInfo& info, std::uint64_t seq) {
+  if (info.mode == kShCyclic)
+    return (seq / kShardBlk) % info.sh.n == info.sh.i;
+  return seq >= range_at(info.n_all, info.sh.i, info.sh.n)
+      && seq <  range_at(info.n_all, info.sh.i + 1, info.sh.n);
+}
+
+/*
+ * @brief       読込: 分割実行の記録
+ *
+ * @param[in]   分割出力のファイル名 (string)
+ * @param[ref]  分割実行の記録 (ShardInfo)
+ * @return      成否 (bool)
+ */
+static bool get_info(const std::string& f, ShardInfo& info) {
+  std::string tag;
+  std::string mode;
+
+  try {
+    std::ifstream ifs(f + ".shard");
+    if (!ifs) return false;
+    ifs >> tag >> info.sh.i >> info.sh.n >> mode >> info.n_all >> info.n_out;
+    if (!ifs || tag != kShardTag || info.sh.n == 0 || info.sh.i >= info.sh.n)
+      return false;
+    if (mode == "range") {
+      info.mode = kShRange;
+    } else if (mode == "cyclic") {
+      info.mode = kShCyclic;
+    } else {
+      return false;
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      実行: 分割出力（列形式バイナリ）の併合
+ *             (各分割の記録を照合して全担当が揃っていることを確認した上で、
+ *              行番号順に k-way マージする。行番号の重複・担当外の行・件数の
+ *              不一致はいずれもエラー)
+ *
+ * @param[in]  出力ファイル名 (string)
+ * @param[in]  分割出力のファイル名 (vector<string>)
+ * @return     終了コード (int)
+ */
+int run_merge(const std::string& f_out, const std::vector<std::string>& f_in) {
+  std::vector<ShardInfo> infos(f_in.size());  // 分割実行の記録
+  std::vector<ColReader> rds(f_in.size());    // 分割出力
+  std::vector<std::uint64_t> n_rd(f_in.size(), 0);  // 読込件数
+  std::vector<bool> f_sh;                     // 担当番号の出現
+  std::priority_queue<std::pair<std::uint64_t, std::size_t>,
+                      std::vector<std::pair<std::uint64_t, std::size_t>>,
+                      std::greater<std::pair<std::uint64_t, std::size_t>>> pq;
+  std::uint64_t n_sum = 0;  // 担当件数の合計
+  std::uint64_t n_row = 0;  // 書出件数
+  std::uint64_t seq_prv = 0;
+  std::string f_tmp = f_out == "-" ? f_out : f_out + ".part";  // 書出中のファイル
+  bool f_open = false;      // 書出中フラグ
+  struct stat st;
+  std::size_t i;
+
+  // エラー時は書出中のファイルを残さない
+  auto err = [&](const std::string& msg) {
+    std::cerr << "[ERROR] merge: " << msg << std::endl;
+    if (f_open && f_tmp != "-") unlink(f_tmp.c_str());
+    return EXIT_FAILURE;
+  };
+
+  try {
+    if (f_in.empty()) return err("no input");
+    // 記録の照合: 分割数・方式・全体件数が一致し、全担当が 1 つずつ揃うこと
+    for (i = 0; i < f_in.size(); ++i) {
+      if (!get_info(f_in[i], infos[i]))
+        return err("no valid shard record for " + f_in[i]);
+      if (i == 0) f_sh.assign(infos[0].sh.n, false);
+      if (infos[i].sh.n != infos[0].sh.n || infos[i].mode != infos[0].mode
+          || infos[i].n_all != infos[0].n_all)
+        return err("shard record mismatch: " + f_in[i]);
+      if (f_sh[infos[i].sh.i])
+        return err("duplicate shard " + std::to_string(infos[i].sh.i) + ": " + f_in[i]);
+      f_sh[infos[i].sh.i] = true;
+      n_sum += infos[i].n_out;
+    }
+    for (i = 0; i < f_sh.size(); ++i)
+      if (!f_sh[i]) return err("missing shard " + std::to_string(i)
+                               + "/" + std::to_string(f_sh.size()));
+    if (n_sum != infos[0].n_all)
+      return err("row count mismatch (" + std::to_string(n_sum) + " / "
+                 + std::to_string(infos[0].n_all) + ")");
+    // 出力先は新規のみ（分割出力の上書きを防ぐ）
+    if (f_out != "-" && stat(f_out.c_str(), &st) == 0 && st.st_size > 0)
+      return err(f_out + " already exists");
+    for (i = 0; i < f_in.size(); ++i) {
+      if (!rds[i].open(f_in[i])) return err("cannot read " + f_in[i]);
+      if (rds[i].next()) pq.emplace(rds[i].get_seq(), i);
+    }
+    ColWriter o_col;
+    if (f_tmp != "-") unlink(f_tmp.c_str());
+    f_open = true;
+    if (!o_col.open(f_tmp)) return err("cannot open " + f_tmp);
+    // 行番号順に併合
+    while (!pq.empty()) {
+      auto top = pq.top();
+      pq.pop();
+      i = top.second;
+      if (n_row > 0 && top.first <= seq_prv)
+        return err("duplicate seq " + std::to_string(top.first) + " in " + f_in[i]);
+      if (!in_shard(infos[i], top.first))
+        return err("seq " + std::to_string(top.first) + " outside shard in " + f_in[i]);
+      o_col.put_row(rds[i]);
+      seq_prv = top.first;
+      ++n_row;
+      ++n_rd[i];
+      if (rds[i].next()) pq.emplace(rds[i].get_seq(), i);
+    }
+    for (i = 0; i < f_in.size(); ++i) {
+      if (rds[i].is_bad()) return err("corrupt chunk in " + f_in[i]);
+      if (n_rd[i] != infos[i].n_out)
+        return err("row count mismatch in " + f_in[i]);
+    }
+    if (!o_col.flush()) return err("write error");
+    if (f_tmp != "-" && rename(f_tmp.c_str(), f_out.c_str()) != 0)
+      return err("cannot rename " + f_tmp);
+    std::cerr << "[INFO] merged " << n_row << " rows from "
+              << f_in.size() << " shards" << std::endl;
+  } catch (...) {
+    throw;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace sun_moon
+
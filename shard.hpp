@@ -0,0 +1,55 @@
+#ifndef SUN_MOON_SHARD_HPP_
+#define SUN_MOON_SHARD_HPP_
+
+#include "grid.hpp"
+#include "input.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sun_moon {
+
+// 分割指定（"i/N": N 分割中の i 番目, 0 始まり）
+struct ShardSpec {
+  unsigned int i;  // 担当番号
+  unsigned int n;  // 分割数（1: 分割なし）
+};
+
+// 分割の方式
+enum ShardMode {
+  kShRange,   // 連続: 総件数が既知（日付範囲・格子点）。行番号を N 等分
+  kShCyclic,  // 巡回: 総件数が未知（ファイル・標準入力）。kShardBlk 件毎に順に割当て
+};
+
+// 分割実行の記録（出力ファイル名 + ".shard"）
+struct ShardInfo {
+  ShardSpec     sh;     // 分割指定
+  ShardMode     mode;   // 分割の方式
+  std::uint64_t n_all;  // 全体の件数（不正行を除く）
+  std::uint64_t n_out;  // 担当分の件数
+};
+
+// 問い合わせ供給元: 分割の担当分のみ
+class Shard : public Source {
+  Source&          src;   // 供給元
+  ShardInfo        info;  // 分割実行の記録
+  std::vector<Row> buf;   // 読込用
+
+public:
+  Shard(Source&, const ShardSpec&);  // コンストラクタ（巡回）
+  Shard(Grid&, const ShardSpec&);    // コンストラクタ（連続）
+  std::size_t read(std::vector<Row>&, std::size_t) override;  // 読込: 最大 n 件
+  std::uint64_t get_bad() override { return src.get_bad(); }  // 取得: 不正行数
+  bool put_info(const std::string&);  // 書出: 分割実行の記録
+};
+
+bool parse_shard(const std::string&, ShardSpec&);  // 解析: "i/N"
+bool in_shard(const ShardInfo&, std::uint64_t);     // 判定: 担当分の行番号か
+int run_merge(const std::string&, const std::vector<std::string>&);  // 実行: 併合
+
+}  // namespace sun_moon
+
+#endif
+
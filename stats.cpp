@@ -0,0 +1,284 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace sun_moon {
+
+// 定数
+static constexpr const char* kMtName[kMtNum] = {
+  "queue_wait", "eop_lookup",
+  "sun_rise", "sun_set", "sun_transit",
+  "moon_rise", "moon_set", "moon_transit",
+  "serialize"
+};
+static constexpr const char* kCtName[kCtNum] = {
+  "query", "cache_hit", "cache_miss", "error"
+};
+
+// スレッド毎の計測値
+struct StatSet {
+  Hist                       hist[kMtNum];  // ヒストグラム
+  std::atomic<std::uint64_t> ctr[kCtNum];   // 計数
+  StatSet() { for (auto& c : ctr) c.store(0, std::memory_order_relaxed); }
+};
+
+// 全スレッドの計測値（登録・解放時のみロック）
+// * 記録は stats_enable 後のみ（常駐モード）。一括処理等では計測値を確保しない
+// * 終了したスレッドの計測値は g_done に合算して解放する（スレッド数によらず一定量）
+static std::atomic<bool> g_on(false);
+static std::mutex g_mtx;
+static std::vector<std::unique_ptr<StatSet>> g_sets;
+static StatSet g_done;                       // 終了したスレッドの合算
+static const std::uint64_t g_t0 = now_ns();  // 開始時刻(ns)
+
+// 自スレッドの計測値の登録（スレッド終了時に合算・解放）
+struct StatReg {
+  StatSet* p = nullptr;
+  ~StatReg();
+};
+
+/*
+ * @brief  デストラクタ（計測値を g_done に合算して解放）
+ *
+ * @param  none
+ */
+StatReg::~StatReg() {
+  unsigned int i;
+  unsigned int j;
+
+  if (p == nullptr) return;
+  std::lock_guard<std::mutex> lk(g_mtx);
+  for (i = 0; i < kMtNum; ++i) {
+    for (j = 0; j < Hist::kBkt; ++j) {
+      if (p->hist[i].get(j) > 0) g_done.hist[i].add_n(j, p->hist[i].get(j));
+    }
+  }
+  for (i = 0; i < kCtNum; ++i) {
+    g_done.ctr[i].store(g_done.ctr[i].load(std::memory_order_relaxed)
+                        + p->ctr[i].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+  }
+  g_sets.erase(std::find_if(g_sets.begin(), g_sets.end(),
+                            [this](const std::unique_ptr<StatSet>& s) {
+                              return s.get() == p;
+                            }));
+}
+
+/*
+ * @brief   取得: 自スレッドの計測値
+ *          (初回のみ登録。スレッド終了時に合算して解放)
+ *
+ * @param   none
+ * @return  計測値 (StatSet&)
+ */
+static StatSet& local_set() {
+  thread_local StatReg reg;
+
+  if (reg.p == nullptr) {
+    std::lock_guard<std::mutex> lk(g_mtx);
+    g_sets.emplace_back(new StatSet);
+    reg.p = g_sets.back().get();
+  }
+
+  return *reg.p;
+}
+
+/*
+ * @brief  コンストラクタ
+ *
+ * @param  none
+ */
+Hist::Hist() {
+  for (auto& c : cnt) c.store(0, std::memory_order_relaxed);
+}
+
+/*
+ * @brief      追加: 計測値
+ *
+ * @param[in]  計測値(ns) (uint64_t)
+ * @return     none
+ */
+void Hist::add(std::uint64_t v) {
+  auto& c = cnt[idx(v)];
+  c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/*
+ * @brief      追加: 度数（階級指定, 合算用）
+ *
+ * @param[in]  階級 (unsigned int)
+ * @param[in]  度数 (uint64_t)
+ * @return     none
+ */
+void Hist::add_n(unsigned int i, std::uint64_t n) {
+  auto& c = cnt[i];
+  c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/*
+ * @brief      取得: 度数
+ *
+ * @param[in]  階級 (unsigned int)
+ * @return     度数 (uint64_t)
+ */
+std::uint64_t Hist::get(unsigned int i) const {
+  return cnt[i].load(std::memory_order_relaxed);
+}
+
+/*
+ * @brief      変換: 計測値 -> 階級
+ *
+ * @param[in]  計測値 (uint64_t)
+ * @return     階級 (unsigned int)
+ */
+unsigned int Hist::idx(std::uint64_t v) {
+  unsigned int e;  // 最上位ビット位置
+
+  if (v < kSub) return v;
+  e = 63 - __builtin_clzll(v);
+  return (e - kSubBits + 1) * kSub + ((v >> (e - kSubBits)) & (kSub - 1));
+}
+
+/*
+ * @brief      変換: 階級 -> 代表値（階級の中央値）
+ *
+ * @param[in]  階級 (unsigned int)
+ * @return     代表値 (uint64_t)
+ */
+std::uint64_t Hist::val(unsigned int i) {
+  unsigned int e;  // 最上位ビット位置
+
+  if (i < kSub) return i;
+  e = i / kSub + kSubBits - 1;
+  return (std::uint64_t(kSub + i % kSub) << (e - kSubBits))
+       + (std::uint64_t(1) << (e - kSubBits)) / 2;
+}
+
+/*
+ * @brief   現在時刻（単調増加）
+ *
+ * @param   none
+ * @return  時刻(ns) (uint64_t)
+ */
+std::uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * @brief   開始: 記録
+ *
+ * @param   none
+ * @return  none
+ */
+void stats_enable() {
+  g_on.store(true, std::memory_order_relaxed);
+}
+
+/*
+ * @brief   判定: 記録中
+ *
+ * @param   none
+ * @return  記録中 (bool)
+ */
+bool stats_on() {
+  return g_on.load(std::memory_order_relaxed);
+}
+
+/*
+ * @brief      記録: 計測値（記録中のみ）
+ *
+ * @param[in]  計測項目 (Metric)
+ * @param[in]  計測値(ns) (uint64_t)
+ * @return     none
+ */
+void stats_add(Metric mt, std::uint64_t ns) {
+  if (!stats_on()) return;
+  local_set().hist[mt].add(ns);
+}
+
+/*
+ * @brief      記録: 計数（記録中のみ）
+ *
+ * @param[in]  計数項目 (Counter)
+ * @param[in]  加算値 (uint64_t)
+ * @return     none
+ */
+void stats_count(Counter ct, std::uint64_t n) {
+  if (!stats_on()) return;
+  auto& c = local_set().ctr[ct];
+  c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/*
+ * @brief   生成: 統計 JSON
+ *          (全スレッドのヒストグラムを合算し、p50/p99/p999・スループット・
+ *           キャッシュヒット率を出力)
+ *
+ * @param   none
+ * @return  JSON 文字列 (string)
+ */
+std::string stats_json() {
+  static constexpr double kQs[3] = {0.5, 0.99, 0.999};
+  static constexpr const char* kQn[3] = {"p50", "p99", "p999"};
+  std::vector<std::uint64_t> h(Hist::kBkt);  // 合算度数
+  std::uint64_t ctr[kCtNum] = {};            // 合算計数
+  std::ostringstream oss;
+  double sec;                                // 経過時間(秒)
+  unsigned int i;
+  unsigned int j;
+
+  try {
+    std::lock_guard<std::mutex> lk(g_mtx);
+    sec = (now_ns() - g_t0) / 1.0e9;
+    for (i = 0; i < kCtNum; ++i) {
+      ctr[i] = g_done.ctr[i].load(std::memory_order_relaxed);
+      for (const auto& s : g_sets) ctr[i] += s->ctr[i].load(std::memory_order_relaxed);
+    }
+    oss << std::fixed << std::setprecision(3)
+        << "{\"uptime_s\":" << sec
+        << ",\"throughput_qps\":" << (sec > 0.0 ? ctr[kCtQuery] / sec : 0.0);
+    for (i = 0; i < kCtNum; ++i)
+      oss << ",\"" << kCtName[i] << "\":" << ctr[i];
+    oss << ",\"cache_hit_ratio\":"
+        << (ctr[kCtCacheHit] + ctr[kCtCacheMiss] > 0
+            ? double(ctr[kCtCacheHit]) / (ctr[kCtCacheHit] + ctr[kCtCacheMiss])
+            : 0.0)
+        << ",\"latency_ns\":{";
+    for (i = 0; i < kMtNum; ++i) {
+      std::uint64_t n = 0;   // 件数
+      std::uint64_t mx = 0;  // 最大値（階級代表値）
+      for (j = 0; j < Hist::kBkt; ++j) h[j] = g_done.hist[i].get(j);
+      for (const auto& s : g_sets)
+        for (j = 0; j < Hist::kBkt; ++j) h[j] += s->hist[i].get(j);
+      for (j = 0; j < Hist::kBkt; ++j) {
+        n += h[j];
+        if (h[j] > 0) mx = Hist::val(j);
+      }
+      oss << (i ? "," : "") << "\"" << kMtName[i] << "\":{\"count\":" << n;
+      for (unsigned int k = 0; k < 3; ++k) {
+        std::uint64_t c = 0;  // 累積度数
+        std::uint64_t v = 0;  // 分位点
+        for (j = 0; j < Hist::kBkt && n > 0; ++j) {
+          c += h[j];
+          if (c >= kQs[k] * n) { v = Hist::val(j); break; }
+        }
+        oss << ",\"" << kQn[k] << "\":" << v;
+      }
+      oss << ",\"max\":" << mx << "}";
+    }
+    oss << "}}";
+  } catch (...) {
+    throw;
+  }
+
+  return oss.str();
+}
+
+}  // namespace sun_moon
+
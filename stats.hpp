@@ -0,0 +1,74 @@
+#ifndef SUN_MOON_STATS_HPP_
+#define SUN_MOON_STATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace sun_moon {
+
+// 計測項目
+enum Metric : unsigned int {
+  kMtQueueWait = 0,  // キュー待ち
+  kMtEop,            // EOP 参照（Calc 初期化）
+  kMtSunRise,        // calc_sun(0)
+  kMtSunSet,         // calc_sun(1)
+  kMtSunTransit,     // calc_sun(2)
+  kMtMoonRise,       // calc_moon(0)
+  kMtMoonSet,        // calc_moon(1)
+  kMtMoonTransit,    // calc_moon(2)
+  kMtSerialize,      // 結果整形
+  kMtNum
+};
+// 計数項目
+enum Counter : unsigned int {
+  kCtQuery = 0,  // 問い合わせ件数
+  kCtCacheHit,   // キャッシュヒット
+  kCtCacheMiss,  // キャッシュミス
+  kCtError,      // エラー
+  kCtNum
+};
+
+// HDR 形式（対数・線形）ヒストグラム
+// * 2 の冪ごとに 16 分割（相対誤差 6.25% 以内）
+// * 書き込みはスレッド専用（終了スレッドの合算はロック下）のため relaxed で十分（読み手は集計時のみ）
+class Hist {
+public:
+  static constexpr unsigned int kSubBits = 4;
+  static constexpr unsigned int kSub     = 1 << kSubBits;
+  static constexpr unsigned int kBkt     = (64 - kSubBits + 1) * kSub;
+
+private:
+  std::atomic<std::uint64_t> cnt[kBkt];  // 度数
+
+public:
+  Hist();
+  void add(std::uint64_t);                        // 追加: 計測値(ns)
+  void add_n(unsigned int, std::uint64_t);        // 追加: 度数（階級指定, 合算用）
+  std::uint64_t get(unsigned int) const;          // 取得: 度数
+  static unsigned int idx(std::uint64_t);         // 計測値 -> 階級
+  static std::uint64_t val(unsigned int);         // 階級 -> 代表値
+};
+
+std::uint64_t now_ns();                            // 現在時刻(ns, 単調増加)
+void stats_enable();                               // 開始: 記録（既定は記録しない）
+bool stats_on();                                   // 判定: 記録中
+void stats_add(Metric, std::uint64_t);             // 記録: 計測値(ns)
+void stats_count(Counter, std::uint64_t = 1);      // 記録: 計数
+std::string stats_json();                          // 生成: 統計 JSON
+
+// 区間計測（スコープ終了時に記録。記録中でなければ時刻も取得しない）
+class Lap {
+  Metric        mt;  // 計測項目
+  std::uint64_t t0;  // 開始時刻(ns, 0: 記録しない)
+
+public:
+  explicit Lap(Metric mt) : mt(mt), t0(stats_on() ? now_ns() : 0) {}
+  ~Lap() { if (t0 != 0) stats_add(mt, now_ns() - t0); }
+};
+
+}  // namespace sun_moon
+
+#endif
+
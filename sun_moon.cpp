@@ -23,38 +23,372 @@
               標高をメートルで指定(マイナス値は指定不可)
               (桁数は特に制限なし)
 ***********************************************************/
+#include "batch.hpp"
 #include "calc.hpp"
+#include "daemon.hpp"
+#include "engine.hpp"
+#include "format.hpp"
+#include "grid.hpp"
+#include "horizon.hpp"
+#include "input.hpp"
+#include "poa.hpp"
+#include "publish.hpp"
+#include "shard.hpp"
 #include "time.hpp"
+#include "track.hpp"
 
+#include <cmath>
 #include <cstdlib>   // for EXIT_XXXX
 #include <ctime>
+#include <exception>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+
+namespace ns = sun_moon;
+
+/*
+ * @brief       一括計算の出力指定取得
+ *              （[--format F] [--output FILE] [--threads N] [--shard i/N]
+ *                [--events riseset|twilight] [--adaptive TOL] [--targets LIST]
+ *                [--horizon FILE]）
+ *
+ * @param[in]   引数の数 (int)
+ * @param[in]   引数 (char*[])
+ * @param[in]   解析開始位置 (int)
+ * @param[ref]  出力指定 (BatchOpt)
+ * @param[in]   既定の出力形式 (Layout, kLyGeoJson の場合は GeoJSON のみ可)
+ * @return      成否 (bool)
+ */
+static bool parse_opt(int argc, char* argv[], int i, ns::BatchOpt& opt,
+                      ns::Layout ly_def = ns::kLyLine) {
+  std::string k;  // オプション名
+
+  opt.ly    = ly_def;
+  opt.f_out = "-";
+  opt.n_th  = 0;
+  opt.sh.i  = 0;
+  opt.sh.n  = 1;
+  opt.f_twi = false;
+  opt.tol_ad = 0.0;
+  opt.tgts.clear();
+  opt.tgt_names.clear();
+  opt.hz.reset();
+  for (; i < argc; i += 2) {
+    k = argv[i];
+    if (i + 1 >= argc) return false;
+    if (k == "--format") {
+      if (!ns::parse_layout(argv[i + 1], opt.ly)) return false;
+    } else if (k == "--output") {
+      opt.f_out = argv[i + 1];
+    } else if (k == "--threads") {
+      opt.n_th = std::stoi(argv[i + 1]);
+    } else if (k == "--shard") {
+      if (!ns::parse_shard(argv[i + 1], opt.sh)) return false;
+    } else if (k == "--events") {
+      k = argv[i + 1];
+      if (k != "riseset" && k != "twilight") return false;
+      opt.f_twi = k == "twilight";
+    } else if (k == "--targets") {
+      if (!ns::parse_targets(argv[i + 1], opt.tgts, opt.tgt_names)) return false;
+    } else if (k == "--horizon") {
+      auto hz = std::make_shared<ns::HorizonSet>();
+      if (!hz->load(argv[i + 1])) {
+        std::cout << "[ERROR] Cannot load " << argv[i + 1] << std::endl;
+        return false;
+      }
+      opt.hz = hz;
+    } else if (k == "--adaptive") {
+      opt.tol_ad = std::stod(argv[i + 1]);
+      if (!(opt.tol_ad > 0.0)) return false;
+    } else {
+      return false;
+    }
+  }
+
+  // GeoJSON は等高度線モードのみで、等高度線モードは GeoJSON のみ
+  if ((opt.ly == ns::kLyGeoJson) != (ly_def == ns::kLyGeoJson)) return false;
+  // 適応補間は格子点の日・月の出・入・南中のみ（分割実行の対象外）
+  if (opt.tol_ad > 0.0 && (opt.sh.n > 1 || opt.f_twi)) return false;
+  // 逆算は他の計算対象・適応補間・分割実行と併用しない
+  if (!opt.tgts.empty() && (opt.f_twi || opt.tol_ad > 0.0 || opt.sh.n > 1)) return false;
+  // 地平線プロファイルは日・月の出・入・南中の一括計算のみ（格子点の適応補間の対象外）
+  if (opt.hz && (opt.f_twi || opt.tol_ad > 0.0 || !opt.tgts.empty())) return false;
+  // 分割実行では出力ファイル名に記録を付けるため、ファイル出力が必須。併合は列形式バイナリ
+  // のみ読めるため、出力形式も bin のみ
+  // (薄明等は列形式バイナリに対応しないため、分割実行・併合の対象外)
+  return opt.sh.n == 1 || (opt.f_out != "-" && !opt.f_twi && opt.ly == ns::kLyBin);
+}
+
+/*
+ * @brief       変換: UTC 日時文字列(YYYYMMDDHHMMSS) -> UNIX 秒
+ *
+ * @param[in]   日時文字列 (char*)
+ * @param[ref]  UNIX 秒 (time_t)
+ * @return      成否 (bool)
+ */
+static bool parse_utc(const char* str, time_t& t) {
+  std::string s = str;
+  struct tm tm_u = {};
+
+  if (s.size() != 14 || s.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  std::istringstream is(s);
+  is >> std::get_time(&tm_u, "%Y%m%d%H%M%S");
+  if (is.fail()) return false;
+  t = timegm(&tm_u);
+
+  return true;
+}
+
+/*
+ * @brief       一括計算（分割指定があれば担当分のみ計算し、記録を書き出す）
+ *
+ * @param[in]   分割の担当分 (Shard)
+ * @param[in]   出力指定 (BatchOpt)
+ * @return      終了コード (int)
+ */
+static int run_shard(ns::Shard& o_sh, const ns::BatchOpt& opt) {
+  int ret = ns::run_batch(o_sh, opt);
+
+  if (ret == EXIT_SUCCESS && !o_sh.put_info(opt.f_out)) {
+    std::cerr << "[ERROR] Cannot write " << opt.f_out << ".shard" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return ret;
+}
 
 int main(int argc, char* argv[]) {
-  namespace ns = sun_moon;
   std::string tm_str;        // time string
   unsigned int s_tm;         // size of time string
-  struct timespec jst;       // JST
   struct tm t = {};          // for work
-  double lat;                // latitude
-  double lng;                // lngitude
-  double ht;                 // hight
-  char   s_lat = 'N';        // N: 北緯, S: 南緯
-  char   s_lng = 'E';        // E: 東経, W: 西経
-  struct ns::TmAh tm_ah_sr;  // 日の出
-  struct ns::TmAh tm_ah_ss;  // 日の入
-  struct ns::TmAh tm_ah_sm;  // 日の南中
-  struct ns::TmAh tm_ah_mr;  // 月の出
-  struct ns::TmAh tm_ah_ms;  // 月の入
-  struct ns::TmAh tm_ah_mm;  // 月の南中
+  struct ns::Query  q;       // 日付・観測地点
+  struct ns::Result res;     // 日・月の出・入・南中
+  struct ns::ResSt  rs;      // 計算状態
+  ns::BatchOpt opt;          // 出力指定（一括計算）
+  ns::GridSpec gs;           // 日付範囲 × 格子点
 
   try {
+    // 常駐モード
+    if (argc >= 2 && std::string(argv[1]) == "--daemon") {
+      ns::Daemon o_d;
+      return o_d.run();
+    }
+    // 一括問い合わせモード
+    if (argc >= 3 && std::string(argv[1]) == "--input") {
+      ns::Input o_in;
+      if (!parse_opt(argc, argv, 3, opt) || opt.tol_ad > 0.0) {
+        std::cout << "[ERROR] Invalid option!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (!o_in.open(argv[2])) {
+        std::cout << "[ERROR] Cannot open " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (opt.sh.n > 1) {
+        ns::Shard o_sh(o_in, opt.sh);
+        return run_shard(o_sh, opt);
+      }
+      if (opt.f_twi) return ns::run_twilight(o_in, opt);
+      if (!opt.tgts.empty()) return ns::run_inverse(o_in, opt);
+      return ns::run_batch(o_in, opt);
+    }
+    // 日付範囲・格子点モード
+    if ((argc >= 7 && std::string(argv[1]) == "--range") ||
+        (argc >= 10 && std::string(argv[1]) == "--grid")) {
+      bool f_rng = std::string(argv[1]) == "--range";
+      if (!ns::parse_date(argv[2], gs.d_0) || !ns::parse_date(argv[3], gs.d_1)
+          || !parse_opt(argc, argv, f_rng ? 7 : 10, opt)) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (f_rng) {
+        gs.lat_0 = gs.lat_1 = std::stod(argv[4]);
+        gs.lng_0 = gs.lng_1 = std::stod(argv[5]);
+        gs.step  = 1.0;
+        gs.ht    = std::stod(argv[6]);
+      } else {
+        gs.lat_0 = std::stod(argv[4]);
+        gs.lat_1 = std::stod(argv[5]);
+        gs.lng_0 = std::stod(argv[6]);
+        gs.lng_1 = std::stod(argv[7]);
+        gs.step  = std::stod(argv[8]);
+        gs.ht    = std::stod(argv[9]);
+      }
+      ns::Grid o_g(gs);
+      if (opt.tol_ad > 0.0) return ns::run_grid_adapt(o_g, opt);
+      if (opt.sh.n > 1) {
+        ns::Shard o_sh(o_g, opt.sh);
+        return run_shard(o_sh, opt);
+      }
+      if (opt.f_twi) return ns::run_twilight(o_g, opt);
+      if (!opt.tgts.empty()) return ns::run_inverse(o_g, opt);
+      return ns::run_batch(o_g, opt);
+    }
+    // 時系列モード
+    if (argc >= 8 && std::string(argv[1]) == "--track") {
+      ns::TrackSpec ts;
+      double step;
+      if (!ns::parse_body(argv[2], ts.bd) || !ns::parse_date(argv[3], ts.t_0)
+          || !ns::parse_date(argv[4], ts.t_1) || !parse_opt(argc, argv, 8, opt)
+          || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      step = std::stod(argv[5]);
+      ts.step_ns = std::llround(step * 1.0e9);
+      ts.lat = std::stod(argv[6]);
+      ts.lng = std::stod(argv[7]);
+      ts.t_1.tv_sec += 86400;  // 終了日を含む
+      return ns::run_track(ts, opt);
+    }
+    // 等高度線
+    if (argc >= 7 && std::string(argv[1]) == "--contour") {
+      ns::Body bd;
+      struct timespec ts;
+      std::vector<double> hts;
+      std::string hms = argv[4];
+      std::istringstream iss(argv[5]);
+      std::string h;
+      if (!ns::parse_body(argv[2], bd) || !ns::parse_date(argv[3], ts)
+          || hms.size() != 6 || hms.find_first_not_of("0123456789") != std::string::npos
+          || !parse_opt(argc, argv, 7, opt, ns::kLyGeoJson) || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      ts.tv_sec += std::stoi(hms.substr(0, 2)) * 3600 + std::stoi(hms.substr(2, 2)) * 60
+                 + std::stoi(hms.substr(4, 2));
+      while (std::getline(iss, h, ',')) hts.push_back(std::stod(h));
+      return ns::run_contour(bd, ts, hts, std::stod(argv[6]), opt);
+    }
+    // 月相一覧
+    if (argc >= 4 && std::string(argv[1]) == "--phases") {
+      if (!parse_opt(argc, argv, 4, opt) || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      return ns::run_phases(std::stoi(argv[2]), std::stoi(argv[3]), opt);
+    }
+    // 暦ファイルの作成・参照
+    if (argc >= 6 && std::string(argv[1]) == "--almanac-build") {
+      struct timespec d_0;
+      struct timespec d_1;
+      std::vector<ns::AlmSite> sites;
+      if (!ns::parse_date(argv[3], d_0) || !ns::parse_date(argv[4], d_1)
+          || !parse_opt(argc, argv, 6, opt) || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (!ns::load_sites(argv[2], sites)) {
+        std::cout << "[ERROR] Cannot load " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+      }
+      opt.f_out = argv[5];
+      return ns::run_almanac(sites, d_0, d_1, opt);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--almanac-update") {
+      if (!parse_opt(argc, argv, 3, opt) || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      return ns::run_almanac_update(argv[2], opt);
+    }
+    // 地平線プロファイルファイルの作成
+    if (argc >= 4 && std::string(argv[1]) == "--horizon-build") {
+      return ns::run_horizon_build(argv[2], argv[3]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--lookup") {
+      return ns::run_lookup(argv[2]);
+    }
+    // 視位置の共有メモリへの公開
+    if (argc >= 5 && std::string(argv[1]) == "--publish") {
+      std::vector<ns::AlmSite> sites;
+      if (!ns::load_sites(argv[2], sites)) {
+        std::cout << "[ERROR] Cannot load " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+      }
+      return ns::run_publish(sites, argv[3], std::stod(argv[4]));
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--peek") {
+      return ns::run_peek(argv[2]);
+    }
+    // 期間内の出・入・南中
+    if (argc >= 8 && std::string(argv[1]) == "--search") {
+      ns::SearchSpec ss;
+      if (!ns::parse_body(argv[2], ss.bd) || !parse_utc(argv[3], ss.t_0)
+          || !parse_utc(argv[4], ss.t_1) || !parse_opt(argc, argv, 8, opt)
+          || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      ss.lat = std::stod(argv[5]);
+      ss.lng = std::stod(argv[6]);
+      ss.ht  = std::stod(argv[7]);
+      return ns::run_search(ss, opt);
+    }
+    // 受光面の入射角
+    if (argc >= 8 && std::string(argv[1]) == "--poa") {
+      ns::TrackSpec ts;
+      std::vector<ns::Surface> sfs;
+      double step;
+      if (!ns::parse_date(argv[2], ts.t_0) || !ns::parse_date(argv[3], ts.t_1)
+          || !parse_opt(argc, argv, 8, opt) || opt.sh.n > 1 || opt.hz) {
+        std::cout << "[ERROR] Invalid argument!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (!ns::load_surfaces(argv[7], sfs)) {
+        std::cout << "[ERROR] Cannot load " << argv[7] << std::endl;
+        return EXIT_FAILURE;
+      }
+      step = std::stod(argv[4]);
+      ts.bd = ns::kBdSun;
+      ts.step_ns = std::llround(step * 1.0e9);
+      ts.lat = std::stod(argv[5]);
+      ts.lng = std::stod(argv[6]);
+      ts.t_1.tv_sec += 86400;  // 終了日を含む
+      return ns::run_poa(ts, sfs, opt);
+    }
+    // 分割出力の併合
+    if (argc >= 4 && std::string(argv[1]) == "--merge") {
+      return ns::run_merge(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
     // コマンドライン引数取得
     if (argc < 5) {
       std::cout << "[USAGE] ./sun_moon YYYYMMDD LATITUDE LONGITUDE HEIGHT"
-                << std::endl;
+                << std::endl
+                << "        ./sun_moon --daemon" << std::endl
+                << "        ./sun_moon --input FILE|- [OPTIONS]" << std::endl
+                << "        ./sun_moon --range FROM TO LATITUDE LONGITUDE HEIGHT"
+                << " [OPTIONS]" << std::endl
+                << "        ./sun_moon --grid FROM TO LAT_0 LAT_1 LNG_0 LNG_1"
+                << " STEP HEIGHT [OPTIONS]" << std::endl
+                << "        ./sun_moon --track sun|moon FROM TO STEP LATITUDE"
+                << " LONGITUDE [OPTIONS]" << std::endl
+                << "        ./sun_moon --contour sun|moon YYYYMMDD HHMMSS ALT[,ALT...]"
+                << " STEP [--output FILE] [--format geojson]" << std::endl
+                << "        ./sun_moon --phases FROM_YEAR TO_YEAR [OPTIONS]"
+                << std::endl
+                << "        ./sun_moon --search sun|moon FROM_UTC TO_UTC LATITUDE"
+                << " LONGITUDE HEIGHT [OPTIONS]" << std::endl
+                << "        ./sun_moon --poa FROM TO STEP LATITUDE LONGITUDE"
+                << " SURFACE_FILE [OPTIONS]" << std::endl
+                << "        ./sun_moon --almanac-build SITE_FILE FROM TO OUTPUT"
+                << " [--threads N]" << std::endl
+                << "        ./sun_moon --almanac-update ALMANAC_FILE [--threads N]" << std::endl
+                << "        ./sun_moon --lookup ALMANAC_FILE" << std::endl
+                << "        ./sun_moon --horizon-build TEXT_FILE OUTPUT" << std::endl
+                << "        ./sun_moon --publish SITE_FILE SHM_NAME HZ" << std::endl
+                << "        ./sun_moon --peek SHM_NAME" << std::endl
+                << "        ./sun_moon --merge OUTPUT SHARD_FILE..." << std::endl
+                << "        OPTIONS: --format human|line|csv|jsonl|bin"
+                << " --output FILE --threads N --shard i/N"
+                << " --events riseset|twilight --adaptive TOL" << std::endl
+                << "                 --targets alt:X|az:X|noon:H|moon_alt:X|moon_az:X[,...]"
+                << " --horizon FILE" << std::endl;
       return EXIT_FAILURE;
     }
     // [日付]
@@ -66,71 +400,27 @@ int main(int argc, char* argv[]) {
     }
     std::istringstream is(tm_str);
     is >> std::get_time(&t, "%Y%m%d%H%M%S");
-    jst.tv_sec  = mktime(&t);
-    jst.tv_nsec = 0;
+    q.jst.tv_sec  = ns::mktime_jst(t);
+    q.jst.tv_nsec = 0;
     // [緯度・経度・標高]
-    lat = std::stod(argv[2]);
-    lng = std::stod(argv[3]);
-    ht  = std::stod(argv[4]);
-    if (lat < 0.0) {
-      s_lat = 'S';
-      lat = std::abs(lat);
-    }
-    if (lng < 0.0) {
-      s_lng = 'W';
-      lng = std::abs(lng);
-    }
-
-    // 各種計算
-    ns::Calc o_c(jst, lat, lng, ht);
-    tm_ah_sr = o_c.calc_sun(0);   // 日の出
-    tm_ah_ss = o_c.calc_sun(1);   // 日の入
-    tm_ah_sm = o_c.calc_sun(2);   // 日南中
-    tm_ah_mr = o_c.calc_moon(0);  // 月の出
-    tm_ah_ms = o_c.calc_moon(1);  // 月の入
-    tm_ah_mm = o_c.calc_moon(2);  // 月南中
-
-    std::cout << "[" << ns::gen_time_str(jst).substr(0, 10) << "JST "
-              << std::fixed << std::setprecision(4)
-              << lat << s_lat << " " << lng << s_lng << " " << ht << "m]"
-              << std::endl;
-    std::cout << std::fixed << std::setprecision(2);
-    std::cout << "日の出 " << ns::gen_time_str(tm_ah_sr.time).substr(11, 8)
-              << " (方位角 "
-              << std::setw(6) << tm_ah_sr.ah << "°)"
-              << std::endl;
-    std::cout << "日南中 " << ns::gen_time_str(tm_ah_sm.time).substr(11, 8)
-              << " (　高度 "
-              << std::setw(6) << tm_ah_sm.ah << "°)"
-              << std::endl;
-    std::cout << "日の入 " << ns::gen_time_str(tm_ah_ss.time).substr(11, 8)
-              << " (方位角 "
-              << std::setw(6) << tm_ah_ss.ah << "°)"
-              << std::endl;
-    if (tm_ah_mr.ah < 0.0) {
-      std::cout << "月の出 --:--:-- (方位角 ---.--°)" << std::endl;
-    } else {
-      std::cout << "月の出 " << ns::gen_time_str(tm_ah_mr.time).substr(11, 8)
-                << " (方位角 "
-                << std::setw(6) << tm_ah_mr.ah << "°)"
-                << std::endl;
-    }
-    if (tm_ah_mm.ah < 0.0) {
-      std::cout << "月南中 --:--:-- (　高度 ---.--°)" << std::endl;
-    } else {
-      std::cout << "月南中 " << ns::gen_time_str(tm_ah_mm.time).substr(11, 8)
-                << " (　高度 "
-                << std::setw(6) << tm_ah_mm.ah << "°)"
-                << std::endl;
-    }
-    if (tm_ah_ms.ah < 0.0) {
-      std::cout << "月の入 --:--:-- (方位角 ---.--°)" << std::endl;
-    } else {
-      std::cout << "月の入 " << ns::gen_time_str(tm_ah_ms.time).substr(11, 8)
-                << " (方位角 "
-                << std::setw(6) << tm_ah_ms.ah << "°)"
-                << std::endl;
+    q.lat = std::stod(argv[2]);
+    q.lng = std::stod(argv[3]);
+    q.ht  = std::stod(argv[4]);
+    if (!ns::check_query(q)) {
+      std::cout << "[ERROR] Invalid argument!" << std::endl;
+      return EXIT_FAILURE;
     }
+
+    // 各種計算（一括処理と同じく状態付き）
+    ns::calc_all_st(q, nullptr, nullptr, res, rs);
+
+    // 出力
+    ns::Formatter o_fmt(1, ns::kLyHuman);
+    o_fmt.put(q, res, &rs);
+    if (rs.st != ns::kStOk) return EXIT_FAILURE;
+  } catch (const std::exception& e) {
+      std::cerr << "EXCEPTION! " << e.what() << std::endl;
+      return EXIT_FAILURE;
   } catch (...) {
       std::cerr << "EXCEPTION!" << std::endl;
       return EXIT_FAILURE;
@@ -1,5 +1,7 @@
 #include "time.hpp"
 
+#include <stdexcept>
+
 namespace sun_moon {
 
 // 定数
@@ -26,6 +28,32 @@ struct timespec jst2utc(struct timespec ts_jst) {
   return ts;
 }
 
+/*
+ * @brief       変換: JST の年月日時分秒 -> UNIX 秒
+ *              (mktime の JST(UTC+9) 固定版。プロセスのタイムゾーンによらず、範囲外の値は
+ *               mktime と同様に正規化する。tm_isdst は使用しない)
+ *
+ * @param[ref]  年月日時分秒 (tm, 正規化した値を返す)
+ * @return      UNIX 秒 (time_t)
+ */
+time_t mktime_jst(struct tm& t) {
+  return timegm(&t) - time_t(kJstOffset * kSecHour);
+}
+
+/*
+ * @brief       変換: UNIX 秒 -> JST の年月日時分秒
+ *              (localtime_r の JST(UTC+9) 固定版。プロセスのタイムゾーンによらない)
+ *
+ * @param[in]   UNIX 秒 (time_t)
+ * @param[out]  年月日時分秒 (tm)
+ * @return      none
+ */
+void localtime_jst(time_t ts, struct tm& t) {
+  time_t ts_j = ts + time_t(kJstOffset * kSecHour);
+
+  gmtime_r(&ts_j, &t);
+}
+
 /*
  * @brief      日時文字列生成
  *
@@ -38,7 +66,7 @@ std::string gen_time_str(struct timespec ts) {
   std::string str_tm;
 
   try {
-    localtime_r(&ts.tv_sec, &t);
+    localtime_jst(ts.tv_sec, t);
     ss << std::setfill('0')
        << std::setw(4) << t.tm_year + 1900 << "-"
        << std::setw(2) << t.tm_mon + 1     << "-"
@@ -58,20 +86,38 @@ std::string gen_time_str(struct timespec ts) {
  *
  * @param  none
  */
-Time::Time() {
+Time::Time() : Time(nullptr) {}
+
+/*
+ * @brief      コンストラクタ（EOP 一覧指定）
+ *
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ */
+Time::Time(std::shared_ptr<const EopTable> eop) {
   try {
     // うるう秒, DUT1 一覧取得
-    l_ls.reserve(50);    // 予めメモリ確保
-    l_dut.reserve(250);  // 予めメモリ確保
-    File o_f;
-    if (!o_f.get_leap_sec_list(l_ls)) throw;
-    if (!o_f.get_dut1_list(l_dut))    throw;
+    if (!eop) {
+      auto tbl = std::make_shared<EopTable>();
+      if (!load_eop(*tbl)) throw std::runtime_error("EOP files could not be read");
+      eop = tbl;
+    }
+    this->eop = eop;
     dlt_t = 0.0;
   } catch (...) {
     throw;
   }
 }
 
+/*
+ * @brief   取得: EOP 一覧の版数
+ *
+ * @param   none
+ * @return  版数 (uint64_t)
+ */
+std::uint64_t Time::get_eop_ver() {
+  return eop->ver;
+}
+
 /*
  * @brief       UTC - TAI (協定世界時と国際原子時の差 = うるう秒の総和) 取得
  *
@@ -88,7 +134,7 @@ int Time::get_utc_tai(struct timespec ts) {
 
   try {
     // 対象年月日
-    localtime_r(&ts.tv_sec, &t);
+    localtime_jst(ts.tv_sec, t);
     ss << std::setw(4) << std::setfill('0') << std::right
        << t.tm_year + 1900
        << std::setw(2) << std::setfill('0') << std::right
@@ -98,9 +144,9 @@ int Time::get_utc_tai(struct timespec ts) {
     dt_t = ss.str();
 
     // うるう秒取得
-    for (i = l_ls.size() - 1; i >= 0; --i) {
-      if (l_ls[i][0] <= dt_t) {
-        utc_tai = stoi(l_ls[i][1]);
+    for (i = eop->l_ls.size() - 1; i >= 0; --i) {
+      if (eop->l_ls[i][0] <= dt_t) {
+        utc_tai = stoi(eop->l_ls[i][1]);
         break;
       }
     }
@@ -127,7 +173,7 @@ float Time::get_dut1(struct timespec ts) {
 
   try {
     // 対象年月日
-    localtime_r(&ts.tv_sec, &t);
+    localtime_jst(ts.tv_sec, t);
     ss << std::setw(4) << std::setfill('0') << std::right
        << t.tm_year + 1900
        << std::setw(2) << std::setfill('0') << std::right
@@ -137,9 +183,9 @@ float Time::get_dut1(struct timespec ts) {
     dt_t = ss.str();
 
     // DUT1 取得
-    for (i = l_dut.size() - 1; i >= 0; --i) {
-      if (l_dut[i][0] <= dt_t) {
-        dut1 = stod(l_dut[i][1]);
+    for (i = eop->l_dut.size() - 1; i >= 0; --i) {
+      if (eop->l_dut[i][0] <= dt_t) {
+        dut1 = stod(eop->l_dut[i][1]);
         break;
       }
     }
@@ -166,7 +212,7 @@ float Time::calc_dlt_t(struct timespec ts, int utc_tai, float dut1) {
   try {
     if (dlt_t != 0.0) return dlt_t;
     if (utc_tai != 0) return kTtTai - utc_tai - dut1;
-    localtime_r(&ts.tv_sec, &t);
+    localtime_jst(ts.tv_sec, t);
     year = t.tm_year + 1900;
     y = year + (t.tm_mon + 1 - 0.5) / 12;
 
@@ -2,12 +2,14 @@
 #define SUN_MOON_TIME_HPP_
 
 #include "delta_t.hpp"
+#include "eop.hpp"
 #include "file.hpp"
 
 #include <cmath>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -15,17 +17,20 @@
 namespace sun_moon {
 
 struct timespec jst2utc(struct timespec);   // 変換: JST -> UTC
+time_t mktime_jst(struct tm&);              // 変換: JST の年月日時分秒 -> UNIX 秒（TZ によらない）
+void localtime_jst(time_t, struct tm&);     // 変換: UNIX 秒 -> JST の年月日時分秒（TZ によらない）
 std::string gen_time_str(struct timespec);  // 日時文字列生成
 
 class Time {
-  std::vector<std::vector<std::string>> l_ls;   // List of Leap Second
-  std::vector<std::vector<std::string>> l_dut;  // List of DUT1
+  std::shared_ptr<const EopTable> eop;  // EOP(うるう秒, DUT1)一覧
   float  dut1;     // UTC - TAI (協定世界時と国際原子時の差 = うるう秒の総和)
   int    utc_tai;  // UTC - TAI (協定世界時と国際原子時の差 = うるう秒の総和)
   float  dlt_t;    // ΔT (TT(地球時) と UT1(世界時1)の差)
 
 public:
-  Time();  // コンストラクタ
+  Time();                                 // コンストラクタ
+  Time(std::shared_ptr<const EopTable>);  // コンストラクタ（EOP 一覧指定）
+  std::uint64_t get_eop_ver();            // 取得: EOP 一覧の版数
   int   get_utc_tai(struct timespec);  // UTC -> UTC - TAI
   float get_dut1(struct timespec);     // UTC -> DUT1
   float calc_dlt_t(struct timespec, int, float);  // 計算: ΔT  (TT(地球時) と UT1(世界時1)の差)
@@ -0,0 +1,352 @@
+#include "track.hpp"
+#include "ephem.hpp"
+#include "time.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sun_moon {
+
+// 定数
+static constexpr unsigned int kJstOffset = 32400;            // JST - UTC (secs)
+static constexpr unsigned int kSecDay    = 86400;            // Seconds in a day (secs)
+static constexpr double       kPi        = atan(1.0) * 4.0;  // 円周率
+static constexpr double       kPi180     = kPi / 180.0;      // 円周率 / 180
+static constexpr std::size_t  kReseed    = 4096;             // 逐次評価の初期化間隔(点)
+
+/*
+ * @brief      変換: 名称 -> 天体
+ *
+ * @param[in]  名称 ("sun", "moon") (string)
+ * @param[ref] 天体 (Body)
+ * @return     成否 (bool)
+ */
+bool parse_body(const std::string& s, Body& bd) {
+  if (s == "sun") {
+    bd = kBdSun;
+  } else if (s == "moon") {
+    bd = kBdMoon;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * @brief      コンストラクタ
+ *
+ * @param[in]  天体 (Body)
+ * @param[in]  緯度 (double)
+ * @param[in]  経度 (double)
+ * @param[in]  EOP 一覧 (shared_ptr<const EopTable>, nullptr の場合はファイルから読込)
+ */
+Track::Track(Body bd, double lat, double lng, std::shared_ptr<const EopTable> eop)
+    : bd(bd), lat_o(lat), lng_o(lng), eop(eop) {
+  try {
+    sin_lat = std::sin(kPi180 * lat);
+    cos_lat = std::cos(kPi180 * lat);
+    if (!this->eop) {
+      Eop o_eop;
+      this->eop = o_eop.get();
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 1 時刻の視高度・方位角（級数を直接評価）
+ *
+ * @param[in]  時刻 (timespec)
+ * @return     視位置 (AltAz)
+ */
+struct AltAz Track::at(const struct timespec& ts) {
+  try {
+    return at(ecl(ts));
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 1 時刻の黄道座標・黄道傾角等（観測者によらない部分）
+ *
+ * @param[in]  時刻 (timespec)
+ * @return     黄道座標等 (EclPos)
+ */
+struct EclPos Track::ecl(const struct timespec& ts) {
+  struct EclPos ep;
+  double eps;            // 黄道傾角(rad)
+
+  try {
+    ep.jy  = calc_jy(ts, ep.dd);
+    ep.bet = 0.0;
+    ep.prl = 0.0;
+    if (bd == kBdSun) {
+      ep.lmd = lmd_sun(ep.jy);
+    } else {
+      ep.lmd = lmd_moon(ep.jy);
+      ep.bet = bet_moon(ep.jy);
+      ep.prl = diff_moon(ep.jy);
+    }
+    eps        = kPi180 * obliquity(ep.jy);
+    ep.sin_eps = std::sin(eps);
+    ep.cos_eps = std::cos(eps);
+  } catch (...) {
+    throw;
+  }
+
+  return ep;
+}
+
+/*
+ * @brief      計算: 黄道座標等からの視高度・方位角（観測者の恒星時以降のみ）
+ *
+ * @param[in]  黄道座標等 (EclPos, 同じ天体の ecl の結果)
+ * @return     視位置 (AltAz)
+ */
+struct AltAz Track::at(const struct EclPos& ep) {
+  double tm_sd;          // 恒星時(度)
+
+  try {
+    tm_sd = norm_ang(325.4606
+                   + 360.007700536 * ep.jy
+                   + 0.00000003879 * ep.jy * ep.jy
+                   + 360.0 * ep.dd + lng_o);
+    return to_altaz(ep.lmd, ep.bet, ep.prl, ep.sin_eps, ep.cos_eps,
+                    std::sin(kPi180 * tm_sd), std::cos(kPi180 * tm_sd));
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief      計算: 天体直下点
+ *             (赤経・赤緯とグリニッジの恒星時（at の恒星時の観測者経度を 0 としたもの）
+ *              から求める)
+ *
+ * @param[in]  時刻 (timespec)
+ * @return     天体直下点 (SubPoint)
+ */
+struct SubPoint Track::sub_point(const struct timespec& ts) {
+  double dd;             // 日内時刻(日)
+  double jy;             // 経過ユリウス年
+  double tm_sd;          // グリニッジ恒星時(度)
+  Coord  cd_k = {0.0, 0.0};  // 黄道座標
+  Coord  cd_s;           // 赤道座標
+  struct SubPoint sp;
+
+  try {
+    jy = calc_jy(ts, dd);
+    sp.prl = 0.0;
+    if (bd == kBdSun) {
+      cd_k.lng = lmd_sun(jy);
+    } else {
+      cd_k.lng = lmd_moon(jy);
+      cd_k.lat = bet_moon(jy);
+      sp.prl   = diff_moon(jy);
+    }
+    cd_s  = ko2se(jy, cd_k);
+    tm_sd = norm_ang(325.4606
+                   + 360.007700536 * jy
+                   + 0.00000003879 * jy * jy
+                   + 360.0 * dd);
+    sp.lat = cd_s.lat;
+    sp.lng = std::remainder(cd_s.lng - tm_sd, 360.0);
+  } catch (...) {
+    throw;
+  }
+
+  return sp;
+}
+
+/*
+ * @brief       計算: 開始時刻から一定間隔で n 点の視高度・方位角
+ *              (級数の各項・恒星時を加法定理で逐次回転させる。kReseed 点毎に
+ *               厳密値で初期化し直すため、誤差は累積しない)
+ *
+ * @param[in]   開始時刻 (timespec)
+ * @param[in]   間隔(ns) (int64_t)
+ * @param[in]   点数 (size_t)
+ * @param[out]  視位置 (AltAz[n])
+ * @return      none
+ */
+void Track::run(const struct timespec& t_0, std::int64_t step_ns,
+                std::size_t n, struct AltAz* out) {
+  TermIter it_p;   // 周期項（太陽: 黄経, 月: 黄経）
+  TermIter it_pm;  // 主項（太陽: 黄経の主項, 月: 黄経の主項）
+  TermIter it_a;   // 月: 黄経の主項の引数補正
+  TermIter it_b;   // 月: 黄緯の周期項
+  TermIter it_bm;  // 月: 黄緯の主項
+  TermIter it_bb;  // 月: 黄緯の主項の引数補正
+  TermIter it_d;   // 月: 視差
+  struct timespec ts;
+  double step_d = step_ns * 1.0e-9 / kSecDay;  // 間隔(日)
+  double djy = step_d / 365.25;                // 間隔(ユリウス年)
+  double dd;        // 日内時刻(日)
+  double jy_0;      // 初期化時の経過ユリウス年
+  double jy;        // 経過ユリウス年
+  double eps;       // 黄道傾角(rad)
+  double sin_eps;
+  double cos_eps;
+  double th;        // 恒星時(rad)
+  double dth;       // 恒星時の 1 刻みの増分(rad)
+  double sin_th;
+  double cos_th;
+  double sin_dth;
+  double cos_dth;
+  double lmd;       // 黄経
+  double bet = 0.0; // 黄緯
+  double prl = 0.0; // 視差
+  double x;         // 引数補正(rad, 微小角のため多項式で sin/cos を求める)
+  double s1;
+  std::size_t k;
+  std::size_t j;
+  std::size_t m;
+
+  try {
+    for (k = 0; k < n; k += kReseed) {
+      // 初期化（厳密値）
+      ts.tv_sec  = t_0.tv_sec + (t_0.tv_nsec + std::int64_t(k) * step_ns) / 1000000000;
+      ts.tv_nsec = (t_0.tv_nsec + std::int64_t(k) * step_ns) % 1000000000;
+      jy_0 = calc_jy(ts, dd);
+      eps  = kPi180 * obliquity(jy_0);
+      sin_eps = std::sin(eps);
+      cos_eps = std::cos(eps);
+      th  = kPi180 * norm_ang(325.4606
+                            + 360.007700536 * jy_0
+                            + 0.00000003879 * jy_0 * jy_0
+                            + 360.0 * dd + lng_o);
+      dth = kPi180 * (360.007700536 * djy + 360.0 * step_d);
+      sin_th  = std::sin(th);
+      cos_th  = std::cos(th);
+      sin_dth = std::sin(dth);
+      cos_dth = std::cos(dth);
+      if (bd == kBdSun) {
+        it_p.init(kLmdSun, jy_0, djy);
+        it_pm.init(&kLmdSunMain, 1, jy_0, djy);
+      } else {
+        it_p.init(kLmdMoon, jy_0, djy);
+        it_pm.init(&kLmdMoonMain, 1, jy_0, djy);
+        it_a.init(kLmdMoonA, jy_0, djy);
+        it_b.init(kBetMoon, jy_0, djy);
+        it_bm.init(&kBetMoonMain, 1, jy_0, djy);
+        it_bb.init(kBetMoonB, jy_0, djy);
+        it_d.init(kDiffMoon, jy_0, djy);
+      }
+      // 逐次評価
+      m = std::min(kReseed, n - k);
+      for (j = 0; j < m; ++j) {
+        jy = jy_0 + djy * j;
+        if (bd == kBdSun) {
+          lmd = it_p.sum()
+              + (kLmdSunMain.amp - kLmdSunMainT * jy) * it_pm.get_sin(0)
+              + kLmdSunMean.ph + kLmdSunMean.rt * jy;
+          it_p.next();
+          it_pm.next();
+        } else {
+          // sin(主項 + 引数補正) を加法定理で
+          x   = kPi180 * it_a.sum();
+          lmd = it_p.sum()
+              + kLmdMoonMain.amp * (it_pm.get_sin(0) * (1.0 - x * x / 2.0)
+                                  + it_pm.get_cos(0) * (x - x * x * x / 6.0))
+              + kLmdMoonMean.ph + kLmdMoonMean.rt * jy;
+          x   = kPi180 * it_bb.sum();
+          bet = it_b.sum()
+              + kBetMoonMain.amp * (it_bm.get_sin(0) * (1.0 - x * x / 2.0)
+                                  + it_bm.get_cos(0) * (x - x * x * x / 6.0));
+          prl = it_d.sum();
+          it_p.next();
+          it_pm.next();
+          it_a.next();
+          it_b.next();
+          it_bm.next();
+          it_bb.next();
+          it_d.next();
+        }
+        out[k + j] = to_altaz(lmd, bet, prl, sin_eps, cos_eps, sin_th, cos_th);
+        s1     = sin_th * cos_dth + cos_th * sin_dth;
+        cos_th = cos_th * cos_dth - sin_th * sin_dth;
+        sin_th = s1;
+      }
+    }
+  } catch (...) {
+    throw;
+  }
+}
+
+/*
+ * @brief       計算: 経過ユリウス年（Calc と同じ基準。ΔT は当該時刻で取得）
+ *
+ * @param[in]   時刻 (timespec)
+ * @param[out]  JST 日付の 00:00:00 からの経過時間(日) (double)
+ * @return      2000年1月1日力学時正午からの経過ユリウス年 (double)
+ */
+double Track::calc_jy(const struct timespec& ts, double& dd) {
+  struct timespec utc;  // UTC（Calc と同じく JST から 9 時間戻した値）
+  struct tm t;
+  double dlt_t;         // ΔT
+
+  try {
+    localtime_jst(ts.tv_sec, t);
+    dd = (t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec + ts.tv_nsec * 1.0e-9)
+       / kSecDay;
+    utc.tv_sec  = ts.tv_sec - kJstOffset;
+    utc.tv_nsec = 0;
+    Time o_tm(eop);
+    int   utc_tai = o_tm.get_utc_tai(utc);
+    float dut1    = o_tm.get_dut1(utc);
+    dlt_t = o_tm.calc_dlt_t(utc, utc_tai, dut1);
+  } catch (...) {
+    throw;
+  }
+
+  return (day_progress(ts.tv_sec) + dd + dlt_t / kSecDay) / 365.25;
+}
+
+/*
+ * @brief      変換: 黄道座標 -> 視高度・方位角
+ *             (月は地平視差 × cos(高度) を引いて測心高度とする。
+ *              大気差は Saemundsson の式（高度 -1° 未満は補正なし）)
+ *
+ * @param[in]  黄経(度) (double)
+ * @param[in]  黄緯(度) (double)
+ * @param[in]  地平視差(度) (double)
+ * @param[in]  sin(黄道傾角) (double)
+ * @param[in]  cos(黄道傾角) (double)
+ * @param[in]  sin(恒星時) (double)
+ * @param[in]  cos(恒星時) (double)
+ * @return     視位置 (AltAz)
+ */
+struct AltAz Track::to_altaz(double lmd, double bet, double prl,
+                             double sin_eps, double cos_eps,
+                             double sin_th, double cos_th) {
+  double cb = bd == kBdSun ? 1.0 : std::cos(kPi180 * bet);  // 太陽の黄緯は 0
+  double sb = bd == kBdSun ? 0.0 : std::sin(kPi180 * bet);
+  double sl = std::sin(kPi180 * lmd);
+  double x  = cb * std::cos(kPi180 * lmd);  // 赤道座標（単位ベクトル）
+  double y  = cb * sl * cos_eps - sb * sin_eps;
+  double z  = cb * sl * sin_eps + sb * cos_eps;
+  double ch = x * cos_th + y * sin_th;      // cos(赤緯) × cos(時角)
+  double sh = x * sin_th - y * cos_th;      // cos(赤緯) × sin(時角)
+  double sa = z * sin_lat + ch * cos_lat;   // sin(高度)
+  struct AltAz aa;
+
+  aa.az = std::atan2(-sh, z * cos_lat - ch * sin_lat) / kPi180;
+  if (aa.az < 0.0) aa.az += 360.0;
+  aa.alt = std::asin(std::max(-1.0, std::min(1.0, sa))) / kPi180;
+  if (prl != 0.0) aa.alt -= prl * std::sqrt(std::max(0.0, 1.0 - sa * sa));
+  if (aa.alt > -1.0) {
+    aa.alt += 1.02 / std::tan(kPi180 * (aa.alt + 10.3 / (aa.alt + 5.11))) / 60.0;
+  } else if (aa.alt > -3.0) {
+    // 追尾制御で値が跳ばないよう、-1° での補正量から -3° で 0 まで線形に減らす
+    aa.alt += 1.02 / std::tan(kPi180 * (-1.0 + 10.3 / 4.11)) / 60.0
+            * (aa.alt + 3.0) / 2.0;
+  }
+
+  return aa;
+}
+
+}  // namespace sun_moon
+
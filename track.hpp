@@ -0,0 +1,85 @@
+#ifndef SUN_MOON_TRACK_HPP_
+#define SUN_MOON_TRACK_HPP_
+
+#include "eop.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+
+namespace sun_moon {
+
+// 天体
+enum Body : unsigned int {
+  kBdSun = 0,  // 太陽
+  kBdMoon,     // 月
+};
+
+bool parse_body(const std::string&, Body&);  // 変換: 名称("sun", "moon") -> 天体
+
+// 視位置
+struct AltAz {
+  double alt;  // 高度(度, 大気差補正済み。月は視差補正済み)
+  double az;   // 方位角(度, 北 = 0, 東回り)
+};
+
+// 天体直下点（天体を天頂に見る地点）
+struct SubPoint {
+  double lat;  // 緯度(度, = 赤緯)
+  double lng;  // 経度(度, -180 〜 180)
+  double prl;  // 地平視差(度, 太陽は 0)
+};
+
+// 1 時刻の黄道座標等（観測者によらない部分。複数地点で共用する）
+struct EclPos {
+  double dd;       // 日内時刻(日)
+  double jy;       // 経過ユリウス年
+  double lmd;      // 黄経
+  double bet;      // 黄緯
+  double prl;      // 地平視差
+  double sin_eps;  // sin(黄道傾角)
+  double cos_eps;  // cos(黄道傾角)
+};
+
+// 時系列: 一定間隔の視高度・方位角
+// * 級数は TermIter で逐次評価し、kReseed 点毎に厳密値から初期化し直す
+// * 黄道傾角・ΔT は初期化時の値を使用（kReseed 点の間の変化は無視できる）
+class Track {
+  Body          bd;       // 天体
+  double        lat_o;    // 観測者: 緯度
+  double        lng_o;    // 観測者: 経度
+  double        sin_lat;  // sin(緯度)
+  double        cos_lat;  // cos(緯度)
+  std::shared_ptr<const EopTable> eop;  // EOP 一覧
+
+public:
+  Track(Body, double, double, std::shared_ptr<const EopTable>);  // コンストラクタ
+  struct AltAz at(const struct timespec&);  // 計算: 1 時刻（級数を直接評価）
+  struct EclPos ecl(const struct timespec&);  // 計算: 1 時刻の黄道座標等（観測者によらない）
+  struct AltAz at(const struct EclPos&);    // 計算: 黄道座標等からの視位置（観測者毎）
+  struct SubPoint sub_point(const struct timespec&);  // 計算: 天体直下点（観測者によらない）
+  void run(const struct timespec&, std::int64_t, std::size_t, struct AltAz*);
+                                            // 計算: 開始時刻から一定間隔(ns)で n 点
+
+private:
+  double calc_jy(const struct timespec&, double&);  // 計算: 経過ユリウス年, 日内時刻
+  struct AltAz to_altaz(double, double, double, double, double, double, double);
+                                            // 変換: 黄道座標 -> 視高度・方位角
+};
+
+// 時系列の範囲
+struct TrackSpec {
+  Body            bd;       // 天体
+  struct timespec t_0;      // 開始時刻（含む）
+  struct timespec t_1;      // 終了時刻（含まない）
+  std::int64_t    step_ns;  // 間隔(ns)
+  double          lat;      // 緯度
+  double          lng;      // 経度
+};
+
+}  // namespace sun_moon
+
+#endif
+